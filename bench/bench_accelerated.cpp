@@ -0,0 +1,80 @@
+/**
+ * @file bench_accelerated.cpp
+ * @author Reza Namazi (namazir@mcmaster.ca)
+ * @brief A benchmark comparing Lloyd, Hamerly and Elkan assignment in fit and
+ * checking that they give the same assignments
+ * @version 1.0
+ * @date 2026-10-16
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+
+#include <chrono>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "../src/dataset.hpp"
+#include "../src/kmeans.hpp"
+
+/**
+ * @brief Usage: bench_accelerated [num_points] [num_dimensions]
+ * [num_clusters] [max_iterations]
+ *
+ */
+int main(int argc, char *argv[]) {
+    uint64_t numPoints = argc > 1 ? std::stoul(argv[1]) : 100000;
+    uint64_t numDims = argc > 2 ? std::stoul(argv[2]) : 8;
+    uint64_t numClusters = argc > 3 ? std::stoul(argv[3]) : 256;
+    uint64_t maxIterations = argc > 4 ? std::stoul(argv[4]) : 50;
+
+    // Points around numClusters random centers so that the clustering
+    // converges like it does on real data
+    std::mt19937_64 gen(42);
+    std::uniform_real_distribution<double> uniform(0, 1);
+    std::normal_distribution<double> normal(0, 0.05);
+    std::vector<double> centers(numClusters * numDims);
+    for (double &x : centers) {
+        x = uniform(gen);
+    }
+    Dataset dataset(numPoints, numDims);
+    for (uint64_t i = 0; i < numPoints; i++) {
+        uint64_t center = gen() % numClusters;
+        for (uint64_t j = 0; j < numDims; j++) {
+            dataset.row(i)[j] = centers[center * numDims + j] + normal(gen);
+        }
+    }
+
+    std::cout << "points=" << numPoints << " dims=" << numDims
+              << " clusters=" << numClusters << std::endl;
+    std::cout << "algorithm    ms    distances    skipped    same_labels"
+              << std::endl;
+
+    std::vector<uint64_t> reference;
+    const char *names[] = {"lloyd", "hamerly", "elkan"};
+    bool allSame = true;
+    for (Algorithm algorithm :
+         {Algorithm::Lloyd, Algorithm::Hamerly, Algorithm::Elkan}) {
+        KMeans kmeans(numClusters, numDims, numPoints, dataset);
+        kmeans.algorithm = algorithm;
+
+        // Every model has the same seed, so the same initial centroids
+        auto start = std::chrono::steady_clock::now();
+        kmeans.fit(maxIterations, 1e-12);
+        std::chrono::duration<double, std::milli> time =
+            std::chrono::steady_clock::now() - start;
+
+        if (algorithm == Algorithm::Lloyd) {
+            reference = kmeans.points.labels;
+        }
+        bool same = kmeans.points.labels == reference;
+        allSame = allSame && same;
+        std::cout << names[int(algorithm)] << "    " << time.count() << "    "
+                  << kmeans.distanceComputations << "    "
+                  << kmeans.skippedDistanceComputations << "    "
+                  << (same ? "yes" : "no") << std::endl;
+    }
+    return allSame ? 0 : 1;
+}
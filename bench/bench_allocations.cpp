@@ -0,0 +1,143 @@
+/**
+ * @file bench_allocations.cpp
+ * @author Reza Namazi (namazir@mcmaster.ca)
+ * @brief A check that the training loop does no heap allocation once its
+ * first iteration has run, and that constructing a model does not copy the
+ * dataset
+ * @version 1.0
+ * @date 2026-10-16
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+
+#include <atomic>
+#include <cstdlib>
+#include <iostream>
+#include <new>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "../src/dataset.hpp"
+#include "../src/kmeans.hpp"
+
+std::atomic<uint64_t> numAllocations{0};  // calls to operator new
+std::atomic<uint64_t> allocatedBytes{0};   // bytes requested from it
+
+// Every form of operator new ends up in one of these two
+void *operator new(std::size_t size) {
+    numAllocations++;
+    allocatedBytes += size;
+    void *memory = std::malloc(size > 0 ? size : 1);
+    if (memory == nullptr) {
+        throw std::bad_alloc();
+    }
+    return memory;
+}
+
+void *operator new(std::size_t size, std::align_val_t alignment) {
+    numAllocations++;
+    allocatedBytes += size;
+    std::size_t align = std::size_t(alignment);
+    void *memory =
+        std::aligned_alloc(align, (size + align - 1) / align * align);
+    if (memory == nullptr) {
+        throw std::bad_alloc();
+    }
+    return memory;
+}
+
+// Kept out of line so that the compiler does not pair the operator new of
+// the code under test with std::free and warn about the mismatch
+[[gnu::noinline]] void release(void *memory) { std::free(memory); }
+
+void operator delete(void *memory) noexcept { release(memory); }
+void operator delete(void *memory, std::size_t) noexcept { release(memory); }
+void operator delete(void *memory, std::align_val_t) noexcept {
+    release(memory);
+}
+void operator delete(void *memory, std::size_t, std::align_val_t) noexcept {
+    release(memory);
+}
+
+const char *algorithmNames[] = {"lloyd", "hamerly", "elkan", "gemm"};
+
+/**
+ * @brief Usage: bench_allocations [num_points] [num_dimensions]
+ * [num_clusters] [iterations]
+ *
+ * Reports the bytes allocated by constructing a model and the heap
+ * allocations of a first fit, then of a fit of one iteration and of a fit of
+ * many from the same centroids. Exits with 1 if the latter two differ (an
+ * iteration after the first allocated), or if constructing a model allocates
+ * as much as its labels and a copy of the coordinates (the dataset was
+ * copied).
+ */
+int main(int argc, char *argv[]) {
+    uint64_t numPoints = argc > 1 ? std::stoul(argv[1]) : 100000;
+    uint64_t numDims = argc > 2 ? std::stoul(argv[2]) : 16;
+    uint64_t numClusters = argc > 3 ? std::stoul(argv[3]) : 32;
+    uint64_t iterations = argc > 4 ? std::stoul(argv[4]) : 10;
+
+    std::mt19937_64 gen(42);
+    std::uniform_real_distribution<double> uniform(0, 1);
+    Dataset dataset(numPoints, numDims);
+    for (uint64_t i = 0; i < numPoints * numDims; i++) {
+        dataset.coordinates[i] = uniform(gen);
+    }
+    uint64_t datasetBytes = numPoints * numDims * sizeof(double);
+    uint64_t labelBytes = numPoints * sizeof(uint64_t);
+
+    std::cout << "points=" << numPoints << " dims=" << numDims
+              << " clusters=" << numClusters << " iterations=" << iterations
+              << " dataset_bytes=" << datasetBytes << std::endl;
+    std::cout << "algorithm    threads    construct_bytes    first_fit    "
+                 "one_iteration    "
+              << iterations << "_iterations" << std::endl;
+
+    bool passed = true;
+    for (Algorithm algorithm : {Algorithm::Lloyd, Algorithm::Hamerly,
+                                Algorithm::Elkan, Algorithm::Gemm}) {
+        for (uint64_t threads : {uint64_t(1), uint64_t(4)}) {
+            uint64_t bytesBefore = allocatedBytes;
+            KMeans kmeans(numClusters, numDims, numPoints, dataset);
+            uint64_t constructBytes = allocatedBytes - bytesBefore;
+            bool copied = constructBytes >= labelBytes + datasetBytes;
+            kmeans.setNumThreads(threads);
+            kmeans.algorithm = algorithm;
+            kmeans.initializeCentroids();
+            Dataset initial = kmeans.centroids.clone();
+            auto restart = [&] {
+                std::copy(initial.coordinates,
+                          initial.coordinates + numClusters * numDims,
+                          kmeans.centroids.coordinates);
+            };
+
+            // The first fit sizes the scratch buffers. After that, a fit of
+            // one iteration and a fit of many from the same centroids have
+            // to allocate the same: the later iterations allocate nothing.
+            uint64_t before = numAllocations;
+            kmeans.fitFromCentroids(iterations, -1);
+            uint64_t first = numAllocations - before;
+            restart();
+            before = numAllocations;
+            kmeans.fitFromCentroids(1, -1);
+            uint64_t single = numAllocations - before;
+            restart();
+            before = numAllocations;
+            kmeans.fitFromCentroids(iterations, -1);
+            uint64_t many = numAllocations - before;
+            passed = passed && many == single && !copied;
+
+            std::cout << algorithmNames[int(algorithm)] << "    " << threads
+                      << "    " << constructBytes << "    " << first << "    "
+                      << single << "    " << many << std::endl;
+        }
+    }
+    if (!passed) {
+        std::cout << "A model copied the dataset or an iteration allocated"
+                  << std::endl;
+    }
+    return passed ? 0 : 1;
+}
@@ -0,0 +1,99 @@
+/**
+ * @file bench_distance.cpp
+ * @author Reza Namazi (namazir@mcmaster.ca)
+ * @brief A benchmark of the nearest centroid search for each instruction set,
+ * precision and number of dimensions
+ * @version 1.0
+ * @date 2026-10-16
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+
+#include <chrono>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "../src/dataset.hpp"
+#include "../src/distance.hpp"
+
+const char *levelNames[] = {"scalar", "avx2", "avx512"};
+
+/**
+ * @brief Time the nearest centroid search of every instruction set for one
+ * number of dimensions, with the coordinates stored as Scalar
+ *
+ */
+template <typename Scalar>
+void benchmark(const std::vector<SimdLevel> &levels,
+               const std::vector<double> &points,
+               const std::vector<double> &centroids, uint64_t numPoints,
+               uint64_t numClusters, uint64_t numDims) {
+    std::vector<Scalar> scalarPoints(points.begin(), points.end());
+    std::vector<Scalar> scalarCentroids(centroids.begin(), centroids.end());
+    std::vector<uint64_t> reference(numPoints);
+    for (SimdLevel level : levels) {
+        DistanceKernel<Scalar> kernel =
+            selectDistanceKernel<Scalar>(numDims, level);
+        std::vector<uint64_t> labels(numPoints);
+        auto start = std::chrono::steady_clock::now();
+        for (uint64_t i = 0; i < numPoints; i++) {
+            double minDistance = 1e9;
+            labels[i] = kernel.nearestCentroid(
+                scalarPoints.data() + i * numDims, scalarCentroids.data(),
+                numClusters, numDims, minDistance);
+        }
+        std::chrono::duration<double, std::nano> time =
+            std::chrono::steady_clock::now() - start;
+        if (level == SimdLevel::Scalar) {
+            reference = labels;
+        }
+        std::cout << numDims << "    " << precisionName(precisionOf<Scalar>)
+                  << "    " << levelNames[int(level)] << "    "
+                  << time.count() / double(numPoints * numClusters) << "    "
+                  << (labels == reference ? "yes" : "no") << std::endl;
+    }
+}
+
+/**
+ * @brief Usage: bench_distance [num_points] [num_clusters]
+ *
+ */
+int main(int argc, char *argv[]) {
+    uint64_t numPoints = argc > 1 ? std::stoul(argv[1]) : 100000;
+    uint64_t numClusters = argc > 2 ? std::stoul(argv[2]) : 64;
+
+    std::vector<SimdLevel> levels = {SimdLevel::Scalar};
+    if (detectSimdLevel() != SimdLevel::Scalar) {
+        levels.push_back(SimdLevel::Avx2);
+    }
+    if (detectSimdLevel() == SimdLevel::Avx512) {
+        levels.push_back(SimdLevel::Avx512);
+    }
+
+    std::cout << "points=" << numPoints << " clusters=" << numClusters
+              << std::endl;
+    std::cout << "dims    precision    kernel    ns_per_distance    same_labels"
+              << std::endl;
+
+    std::mt19937_64 gen(42);
+    std::uniform_real_distribution<double> uniform(0, 1);
+    for (uint64_t numDims :
+         std::vector<uint64_t>{2, 3, 4, 5, 8, 16, 32, 50, 128}) {
+        std::vector<double> points(numPoints * numDims);
+        std::vector<double> centroids(numClusters * numDims);
+        for (double &x : points) {
+            x = uniform(gen);
+        }
+        for (double &x : centroids) {
+            x = uniform(gen);
+        }
+        benchmark<double>(levels, points, centroids, numPoints, numClusters,
+                          numDims);
+        benchmark<float>(levels, points, centroids, numPoints, numClusters,
+                         numDims);
+    }
+    return 0;
+}
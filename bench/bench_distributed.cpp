@@ -0,0 +1,182 @@
+/**
+ * @file bench_distributed.cpp
+ * @author Reza Namazi (namazir@mcmaster.ca)
+ * @brief A benchmark of distributed training against single-process training,
+ * checking that both give the same model bitwise
+ * @version 1.0
+ * @date 2026-10-16
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <memory>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <sys/socket.h>
+
+#include "../src/dataset.hpp"
+#include "../src/distributed.hpp"
+#include "../src/kmeans.hpp"
+
+/**
+ * @brief Read a whole file
+ *
+ */
+std::string readFile(const std::string &filename) {
+    std::ifstream file(filename, std::ios::binary);
+    return std::string(std::istreambuf_iterator<char>(file),
+                       std::istreambuf_iterator<char>());
+}
+
+/**
+ * @brief Train a dataset in a single process and over workers that own shards
+ * cut at partition boundaries (like the shard command), each worker on a
+ * thread of its own connected to the coordinator by a socket pair
+ *
+ * @param name Name of the case
+ * @param points The dataset
+ * @param numClusters Number of clusters
+ * @param numShards Number of shards
+ * @param policy What to do with an empty cluster
+ * @param inertiaTolerance Relative inertia improvement to go on
+ * @param prefix Prefix of the model files
+ * @return Whether the binary models are the same
+ */
+bool compare(const std::string &name, const Dataset &points,
+             uint64_t numClusters, uint64_t numShards,
+             EmptyClusterPolicy policy, double inertiaTolerance,
+             const std::string &prefix) {
+    uint64_t numPoints = points.numPoints;
+    uint64_t numDims = points.numDims;
+    uint64_t maxIterations = 50;
+    uint64_t seed = 5;
+    std::string singleFile = prefix + "_single.kmm";
+    std::string distributedFile = prefix + "_distributed.kmm";
+
+    auto start = std::chrono::steady_clock::now();
+    KMeans single(numClusters, numDims, numPoints, points);
+    single.setSeed(seed);
+    single.emptyClusterPolicy = policy;
+    single.inertiaTolerance = inertiaTolerance;
+    single.fit(maxIterations, 0);
+    single.saveModel(singleFile, ModelFormat::Binary);
+    std::chrono::duration<double> singleTime =
+        std::chrono::steady_clock::now() - start;
+
+    // Shard s holds the partitions from s * partitions / numShards
+    start = std::chrono::steady_clock::now();
+    uint64_t partitions =
+        KMeans::numPartitionsFor(numPoints, numClusters, numDims);
+    std::vector<std::unique_ptr<Transport>> connections;
+    std::vector<std::thread> workers;
+    for (uint64_t s = 0; s < numShards; s++) {
+        uint64_t begin = s * partitions / numShards * numPoints / partitions;
+        uint64_t end =
+            (s + 1) * partitions / numShards * numPoints / partitions;
+        Dataset shard(end - begin, numDims);
+        std::copy(points.row(begin), points.row(end), shard.coordinates);
+        int fds[2];
+        if (socketpair(AF_UNIX, SOCK_STREAM, 0, fds) != 0) {
+            std::cout << "Could not create a socket pair" << std::endl;
+            return false;
+        }
+        connections.push_back(std::make_unique<SocketTransport>(fds[0]));
+        workers.emplace_back([s, shard, fd = fds[1]] {
+            SocketTransport transport(fd);
+            runWorker(transport, s, shard, 1);
+        });
+    }
+    StopReason stopReason;
+    uint64_t iterations;
+    {
+        DistributedCoordinator<double> coordinator(numClusters,
+                                                   std::move(connections));
+        coordinator.model.emptyClusterPolicy = policy;
+        coordinator.model.inertiaTolerance = inertiaTolerance;
+        coordinator.initializeRandom(seed);
+        coordinator.fit(maxIterations, 0);
+        coordinator.model.saveModel(distributedFile, ModelFormat::Binary);
+        stopReason = coordinator.model.stopReason;
+        iterations = coordinator.model.iterationsRun;
+    }
+    for (std::thread &worker : workers) {
+        worker.join();
+    }
+    std::chrono::duration<double> distributedTime =
+        std::chrono::steady_clock::now() - start;
+
+    bool identical = readFile(singleFile) == readFile(distributedFile) &&
+                     stopReason == single.stopReason &&
+                     iterations == single.iterationsRun;
+    std::cout << name << "    " << numShards << "    " << iterations << "    "
+              << singleTime.count() << "    " << distributedTime.count()
+              << "    " << (identical ? "yes" : "no") << std::endl;
+    std::remove(singleFile.c_str());
+    std::remove(distributedFile.c_str());
+    return identical;
+}
+
+/**
+ * @brief Usage: bench_distributed [num_points] [num_dimensions] [num_clusters]
+ * [num_shards] [file_prefix]
+ *
+ * Trains a random dataset, the same with an inertia tolerance, and a dataset
+ * of few distinct points where clusters empty (reseeded by the farthest and
+ * the split policies), in a single process and over num_shards workers. It
+ * reports the iterations and the time of both, and exits with 1 if a
+ * distributed model is not bitwise identical to the single-process one.
+ */
+int main(int argc, char *argv[]) {
+    uint64_t numPoints = argc > 1 ? std::stoul(argv[1]) : 300000;
+    uint64_t numDims = argc > 2 ? std::stoul(argv[2]) : 8;
+    uint64_t numClusters = argc > 3 ? std::stoul(argv[3]) : 16;
+    uint64_t numShards = argc > 4 ? std::stoul(argv[4]) : 2;
+    std::string prefix = argc > 5 ? argv[5] : "bench_distributed";
+
+    std::mt19937_64 gen(42);
+    std::uniform_real_distribution<double> uniform(-100, 100);
+    Dataset random(numPoints, numDims);
+    for (uint64_t i = 0; i < numPoints * numDims; i++) {
+        random.coordinates[i] = uniform(gen);
+    }
+    // Four distinct 2-D points: some of the six initial centroids coincide,
+    // and the clusters of the duplicates are empty
+    std::uniform_int_distribution<uint64_t> corner(0, 3);
+    Dataset duplicates(numPoints, 2);
+    for (uint64_t i = 0; i < numPoints; i++) {
+        uint64_t c = corner(gen);
+        duplicates.row(i)[0] = double(c % 2) * 10;
+        duplicates.row(i)[1] = double(c / 2) * 10;
+    }
+
+    std::cout << "points=" << numPoints << " dims=" << numDims
+              << " clusters=" << numClusters << std::endl;
+    std::cout << "case    shards    iterations    single_s    distributed_s    "
+                 "identical"
+              << std::endl;
+    bool identical = true;
+    identical &= compare("random", random, numClusters, numShards,
+                         EmptyClusterPolicy::Farthest, 0, prefix);
+    identical &= compare("random+tolerance", random, numClusters, numShards,
+                         EmptyClusterPolicy::Farthest, 1e-3, prefix);
+    identical &= compare("duplicates+farthest", duplicates, 6, numShards,
+                         EmptyClusterPolicy::Farthest, 0, prefix);
+    identical &= compare("duplicates+split", duplicates, 6, numShards,
+                         EmptyClusterPolicy::SplitLargest, 0, prefix);
+    identical &= compare("duplicates+keep", duplicates, 6, numShards,
+                         EmptyClusterPolicy::Keep, 0, prefix);
+    if (!identical) {
+        std::cout << "A distributed model differs from the single-process one"
+                  << std::endl;
+    }
+    return identical ? 0 : 1;
+}
@@ -0,0 +1,78 @@
+/**
+ * @file bench_elbow.cpp
+ * @author Reza Namazi (namazir@mcmaster.ca)
+ * @brief A benchmark of the elbow method trained one k at a time, with the
+ * values of k trained concurrently, and warm-started, with and without
+ * stopping early
+ * @version 1.0
+ * @date 2026-10-16
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+
+#include <chrono>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "../src/dataset.hpp"
+#include "../src/utils.hpp"
+
+/**
+ * @brief Usage: bench_elbow [num_points] [num_dimensions] [num_clusters]
+ * [max_k] [num_threads]
+ *
+ */
+int main(int argc, char *argv[]) {
+    uint64_t numPoints = argc > 1 ? std::stoul(argv[1]) : 200000;
+    uint64_t numDims = argc > 2 ? std::stoul(argv[2]) : 8;
+    uint64_t numClusters = argc > 3 ? std::stoul(argv[3]) : 6;
+    uint64_t maxK = argc > 4 ? std::stoul(argv[4]) : 20;
+    uint64_t numThreads = argc > 5 ? std::stoul(argv[5]) : 4;
+
+    std::mt19937_64 gen(42);
+    std::uniform_real_distribution<double> uniform(0, 1);
+    std::normal_distribution<double> normal(0, 0.05);
+    std::vector<double> centers(numClusters * numDims);
+    for (double &x : centers) {
+        x = uniform(gen);
+    }
+    Dataset dataset(numPoints, numDims);
+    for (uint64_t i = 0; i < numPoints; i++) {
+        uint64_t center = gen() % numClusters;
+        for (uint64_t j = 0; j < numDims; j++) {
+            dataset.row(i)[j] = centers[center * numDims + j] + normal(gen);
+        }
+    }
+
+    std::cout << "points=" << numPoints << " dims=" << numDims
+              << " clusters=" << numClusters << " k=[2, " << maxK << "]"
+              << std::endl;
+    std::cout << "search    threads    patience    ms    elbow" << std::endl;
+
+    struct Run {
+        const char *name;
+        uint64_t threads;
+        bool warmStart;
+        uint64_t patience;
+    };
+    for (const Run &run : std::vector<Run>{{"sequential", 1, false, 0},
+                                           {"parallel", numThreads, false, 0},
+                                           {"parallel", numThreads, false, 3},
+                                           {"warm", numThreads, true, 0},
+                                           {"warm", numThreads, true, 3}}) {
+        auto start = std::chrono::steady_clock::now();
+        uint64_t elbow = elbowMethod(numPoints, numDims, dataset, 2, maxK,
+                                     run.threads, Algorithm::Lloyd,
+                                     InitMethod::KMeansPlusPlus, 0,
+                                     run.warmStart, run.patience);
+        std::chrono::duration<double, std::milli> time =
+            std::chrono::steady_clock::now() - start;
+        std::cout << run.name << "    " << run.threads << "    "
+                  << run.patience << "    " << time.count() << "    " << elbow
+                  << std::endl;
+    }
+    return 0;
+}
@@ -0,0 +1,78 @@
+/**
+ * @file bench_gemm.cpp
+ * @author Reza Namazi (namazir@mcmaster.ca)
+ * @brief A benchmark of one assignment pass of the direct distance loop
+ * against the blocked matrix product over a grid of dimensions and clusters
+ * @version 1.0
+ * @date 2026-10-16
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+
+#include <chrono>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "../src/dataset.hpp"
+#include "../src/kmeans.hpp"
+
+/**
+ * @brief Time one assignment pass of both methods with the coordinates
+ * stored as Scalar
+ *
+ */
+template <typename Scalar>
+void benchmark(uint64_t numPoints, uint64_t numDims, uint64_t numClusters) {
+    std::mt19937_64 gen(42);
+    std::normal_distribution<double> normal(0, 1);
+    BasicDataset<Scalar> dataset(numPoints, numDims);
+    for (uint64_t i = 0; i < numPoints * numDims; i++) {
+        dataset.coordinates[i] = Scalar(normal(gen));
+    }
+    BasicKMeans<Scalar> kmeans(numClusters, numDims, numPoints, dataset);
+    kmeans.initializeCentroids();
+
+    auto start = std::chrono::steady_clock::now();
+    kmeans.assignPointsToCentroids();
+    std::chrono::duration<double, std::milli> direct =
+        std::chrono::steady_clock::now() - start;
+    std::vector<uint64_t> reference = kmeans.points.labels;
+
+    // The point norms are computed once per fit, so they are left out
+    kmeans.assignPointsGemm(true);
+    start = std::chrono::steady_clock::now();
+    kmeans.assignPointsGemm(false);
+    std::chrono::duration<double, std::milli> gemm =
+        std::chrono::steady_clock::now() - start;
+
+    std::cout << numDims << "    " << numClusters << "    "
+              << precisionName(precisionOf<Scalar>) << "    " << direct.count()
+              << "    " << gemm.count() << "    "
+              << direct.count() / gemm.count() << "    "
+              << kmeans.gemm.fallbacks << "    "
+              << (kmeans.points.labels == reference ? "yes" : "no")
+              << std::endl;
+}
+
+/**
+ * @brief Usage: bench_gemm [num_points]
+ *
+ */
+int main(int argc, char *argv[]) {
+    uint64_t numPoints = argc > 1 ? std::stoul(argv[1]) : 20000;
+
+    std::cout << "points=" << numPoints << std::endl;
+    std::cout << "dims    clusters    precision    direct_ms    gemm_ms    "
+                 "speedup    fallbacks    same_labels"
+              << std::endl;
+    for (uint64_t numDims : std::vector<uint64_t>{16, 64, 256, 768}) {
+        for (uint64_t numClusters : std::vector<uint64_t>{16, 128, 1024}) {
+            benchmark<double>(numPoints, numDims, numClusters);
+            benchmark<float>(numPoints, numDims, numClusters);
+        }
+    }
+    return 0;
+}
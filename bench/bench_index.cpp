@@ -0,0 +1,93 @@
+/**
+ * @file bench_index.cpp
+ * @author Reza Namazi (namazir@mcmaster.ca)
+ * @brief A benchmark of the recall and throughput of prediction through the
+ * centroid index against the exact scan of all centroids
+ * @version 1.0
+ * @date 2026-10-16
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+
+#include <chrono>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "../src/dataset.hpp"
+#include "../src/kmeans.hpp"
+
+/**
+ * @brief Usage: bench_index [num_points] [num_dimensions] [num_clusters]
+ * [num_lists] [num_threads]
+ *
+ * The centroids are a codebook of num_clusters points drawn from a mixture of
+ * Gaussian blobs, and the points to predict are drawn from the same mixture.
+ */
+int main(int argc, char *argv[]) {
+    uint64_t numPoints = argc > 1 ? std::stoul(argv[1]) : 20000;
+    uint64_t numDims = argc > 2 ? std::stoul(argv[2]) : 32;
+    uint64_t numClusters = argc > 3 ? std::stoul(argv[3]) : 16384;
+    uint64_t numLists = argc > 4 ? std::stoul(argv[4]) : 0;
+    uint64_t numThreads = argc > 5 ? std::stoul(argv[5]) : 1;
+
+    std::mt19937_64 gen(42);
+    std::uniform_real_distribution<double> uniform(0, 1);
+    std::normal_distribution<double> normal(0, 0.15);
+    uint64_t numBlobs = 256;
+    std::vector<double> centers(numBlobs * numDims);
+    for (double &x : centers) {
+        x = uniform(gen);
+    }
+    auto draw = [&](double *point) {
+        uint64_t blob = gen() % numBlobs;
+        for (uint64_t j = 0; j < numDims; j++) {
+            point[j] = centers[blob * numDims + j] + normal(gen);
+        }
+    };
+    Dataset dataset(numPoints, numDims);
+    for (uint64_t i = 0; i < numPoints; i++) {
+        draw(dataset.row(i));
+    }
+    KMeans kmeans(numClusters, numDims, numPoints, dataset);
+    for (uint64_t i = 0; i < numClusters; i++) {
+        draw(kmeans.centroids.row(i));
+    }
+    kmeans.setNumThreads(numThreads);
+
+    auto start = std::chrono::steady_clock::now();
+    kmeans.predictPoints();
+    std::chrono::duration<double> exactTime =
+        std::chrono::steady_clock::now() - start;
+    std::vector<uint64_t> exact = kmeans.points.labels;
+
+    start = std::chrono::steady_clock::now();
+    kmeans.buildIndex(numLists, 1);
+    std::chrono::duration<double, std::milli> buildTime =
+        std::chrono::steady_clock::now() - start;
+    numLists = kmeans.centroidIndex->numLists;
+
+    std::cout << "points=" << numPoints << " dims=" << numDims
+              << " clusters=" << numClusters << " lists=" << numLists
+              << " build_ms=" << buildTime.count() << std::endl;
+    std::cout << "probes    recall    points_per_s    speedup" << std::endl;
+    std::cout << "exact    1    " << double(numPoints) / exactTime.count()
+              << "    1" << std::endl;
+    for (uint64_t probes = 1; probes <= numLists; probes *= 2) {
+        kmeans.centroidIndex->probes = probes;
+        start = std::chrono::steady_clock::now();
+        kmeans.predictPoints();
+        std::chrono::duration<double> time =
+            std::chrono::steady_clock::now() - start;
+        uint64_t same = 0;
+        for (uint64_t i = 0; i < numPoints; i++) {
+            same += kmeans.points.labels[i] == exact[i];
+        }
+        std::cout << probes << "    " << double(same) / double(numPoints)
+                  << "    " << double(numPoints) / time.count() << "    "
+                  << exactTime.count() / time.count() << std::endl;
+    }
+    return 0;
+}
@@ -0,0 +1,78 @@
+/**
+ * @file bench_init.cpp
+ * @author Reza Namazi (namazir@mcmaster.ca)
+ * @brief A benchmark of the number of iterations, the training time and the
+ * final inertia for each initialization method
+ * @version 1.0
+ * @date 2026-10-16
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+
+#include <chrono>
+#include <cstdio>
+#include <iostream>
+#include <string>
+
+#include "../src/blob_generator.hpp"
+#include "../src/dataset.hpp"
+#include "../src/kmeans.hpp"
+#include "../src/utils.hpp"
+
+/**
+ * @brief Usage: bench_init [num_points] [num_dimensions] [num_clusters]
+ * [radius] [num_seeds] [dataset_file]
+ *
+ */
+int main(int argc, char *argv[]) {
+    uint64_t numPoints = argc > 1 ? std::stoul(argv[1]) : 100000;
+    uint64_t numDims = argc > 2 ? std::stoul(argv[2]) : 8;
+    uint64_t numClusters = argc > 3 ? std::stoul(argv[3]) : 32;
+    double radius = argc > 4 ? std::stod(argv[4]) : 0.05;
+    uint64_t numSeeds = argc > 5 ? std::stoul(argv[5]) : 5;
+    std::string fileName = argc > 6 ? argv[6] : "bench_init_blobs.txt";
+
+    generateBlob(fileName.data(), numPoints, numDims, numClusters, radius);
+    Dataset dataset;
+    readDataset(dataset, fileName.data(), numPoints, numDims);
+
+    std::cout << "points=" << numPoints << " dims=" << numDims
+              << " clusters=" << numClusters << " seeds=" << numSeeds
+              << std::endl;
+    std::cout << "init    mean_iterations    mean_init_ms    mean_total_ms    "
+                 "mean_inertia"
+              << std::endl;
+
+    const char *names[] = {"random", "kmeans++", "kmeans||"};
+    for (InitMethod initMethod : {InitMethod::Random, InitMethod::KMeansPlusPlus,
+                                  InitMethod::KMeansParallel}) {
+        double iterations = 0, initTime = 0, totalTime = 0, inertia = 0;
+        for (uint64_t seed = 0; seed < numSeeds; seed++) {
+            KMeans kmeans(numClusters, numDims, numPoints, dataset);
+            kmeans.initMethod = initMethod;
+
+            kmeans.setSeed(seed);
+            auto start = std::chrono::steady_clock::now();
+            kmeans.initializeCentroids();
+            std::chrono::duration<double, std::milli> time =
+                std::chrono::steady_clock::now() - start;
+            initTime += time.count();
+
+            // fit initializes again from the same seed
+            kmeans.setSeed(seed);
+            start = std::chrono::steady_clock::now();
+            kmeans.fit(1000, 1e-10);
+            time = std::chrono::steady_clock::now() - start;
+            totalTime += time.count();
+            iterations += double(kmeans.iterationsRun);
+            inertia += kmeans.inertia();
+        }
+        double n = double(numSeeds);
+        std::cout << names[int(initMethod)] << "    " << iterations / n << "    "
+                  << initTime / n << "    " << totalTime / n << "    "
+                  << inertia / n << std::endl;
+    }
+    std::remove(fileName.data());
+    return 0;
+}
@@ -0,0 +1,164 @@
+/**
+ * @file bench_layout.cpp
+ * @author Reza Namazi (namazir@mcmaster.ca)
+ * @brief A benchmark comparing the memory usage and the time per iteration of
+ * the contiguous Dataset layout against one heap-allocated vector per point
+ * @version 1.0
+ * @date 2026-10-16
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+
+#include <chrono>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+#if defined(__GLIBC__)
+#include <malloc.h>
+#endif
+
+#include "../src/dataset.hpp"
+#include "../src/kmeans.hpp"
+
+/**
+ * @brief The previous layout of a point: every point owns its coordinates
+ */
+struct LegacyPoint {
+    uint64_t numDims;
+    std::vector<double> coordinates;
+    uint64_t cluster;
+};
+
+/**
+ * @brief Number of bytes currently allocated on the heap
+ *
+ * @return The allocated bytes, or 0 if it cannot be measured on this platform
+ */
+uint64_t heapInUse() {
+#if defined(__GLIBC__)
+    struct mallinfo2 info = mallinfo2();
+    return uint64_t(info.uordblks + info.hblkhd);
+#else
+    return 0;
+#endif
+}
+
+/**
+ * @brief One Lloyd iteration (assignment and update) over the legacy layout,
+ * written the same way as the KMeans methods
+ *
+ */
+void legacyIteration(std::vector<LegacyPoint> &points,
+                     std::vector<LegacyPoint> &centroids) {
+    uint64_t numDims = centroids[0].numDims;
+    for (LegacyPoint &point : points) {
+        double minDistance = 1e9;
+        uint64_t cluster = 0;
+        for (uint64_t j = 0; j < centroids.size(); j++) {
+            double distance = 0;
+            for (uint64_t l = 0; l < numDims; l++) {
+                double _distance =
+                    point.coordinates[l] - centroids[j].coordinates[l];
+                distance += _distance * _distance;
+            }
+            if (distance < minDistance) {
+                minDistance = distance;
+                cluster = j;
+            }
+        }
+        point.cluster = cluster;
+    }
+
+    std::vector<uint64_t> numPointsInCluster(centroids.size(), 0);
+    for (LegacyPoint &centroid : centroids) {
+        for (uint64_t j = 0; j < numDims; j++) {
+            centroid.coordinates[j] = 0;
+        }
+    }
+    for (LegacyPoint &point : points) {
+        numPointsInCluster[point.cluster]++;
+        for (uint64_t j = 0; j < numDims; j++) {
+            centroids[point.cluster].coordinates[j] += point.coordinates[j];
+        }
+    }
+    for (uint64_t i = 0; i < centroids.size(); i++) {
+        for (uint64_t j = 0; j < numDims; j++) {
+            centroids[i].coordinates[j] /= double(numPointsInCluster[i]);
+        }
+    }
+}
+
+/**
+ * @brief Usage: bench_layout [num_points] [num_dimensions] [num_clusters]
+ * [iterations]
+ *
+ */
+int main(int argc, char *argv[]) {
+    uint64_t numPoints = argc > 1 ? std::stoul(argv[1]) : 1000000;
+    uint64_t numDims = argc > 2 ? std::stoul(argv[2]) : 8;
+    uint64_t numClusters = argc > 3 ? std::stoul(argv[3]) : 16;
+    uint64_t iterations = argc > 4 ? std::stoul(argv[4]) : 10;
+
+    std::mt19937_64 gen(42);
+    std::uniform_real_distribution<double> uniform(0, 1);
+
+    // Contiguous layout
+    uint64_t before = heapInUse();
+    Dataset dataset(numPoints, numDims);
+    for (uint64_t i = 0; i < numPoints * numDims; i++) {
+        dataset.coordinates[i] = uniform(gen);
+    }
+    dataset.labels.resize(numPoints);
+    uint64_t contiguousBytes = heapInUse() - before;
+
+    // Legacy layout with the same coordinates
+    before = heapInUse();
+    std::vector<LegacyPoint> legacy(numPoints);
+    for (uint64_t i = 0; i < numPoints; i++) {
+        legacy[i].numDims = numDims;
+        legacy[i].coordinates.assign(dataset.row(i), dataset.row(i) + numDims);
+    }
+    uint64_t legacyBytes = heapInUse() - before;
+
+    std::vector<LegacyPoint> legacyCentroids(numClusters);
+    for (uint64_t i = 0; i < numClusters; i++) {
+        legacyCentroids[i].numDims = numDims;
+        legacyCentroids[i].coordinates.assign(dataset.row(i),
+                                              dataset.row(i) + numDims);
+    }
+
+    KMeans kmeans(numClusters, numDims, numPoints, dataset);
+    for (uint64_t i = 0; i < numClusters; i++) {
+        for (uint64_t j = 0; j < numDims; j++) {
+            kmeans.centroids.row(i)[j] = dataset.row(i)[j];
+        }
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    for (uint64_t it = 0; it < iterations; it++) {
+        legacyIteration(legacy, legacyCentroids);
+    }
+    std::chrono::duration<double, std::milli> legacyTime =
+        std::chrono::steady_clock::now() - start;
+
+    start = std::chrono::steady_clock::now();
+    for (uint64_t it = 0; it < iterations; it++) {
+        kmeans.assignPointsToCentroids();
+        kmeans.updateCentroids();
+    }
+    std::chrono::duration<double, std::milli> contiguousTime =
+        std::chrono::steady_clock::now() - start;
+
+    std::cout << "points=" << numPoints << " dims=" << numDims
+              << " clusters=" << numClusters << " iterations=" << iterations
+              << std::endl;
+    std::cout << "layout       heap_bytes    ms_per_iteration" << std::endl;
+    std::cout << "legacy       " << legacyBytes << "    "
+              << legacyTime.count() / double(iterations) << std::endl;
+    std::cout << "contiguous   " << contiguousBytes << "    "
+              << contiguousTime.count() / double(iterations) << std::endl;
+    return 0;
+}
@@ -0,0 +1,116 @@
+/**
+ * @file bench_load.cpp
+ * @author Reza Namazi (namazir@mcmaster.ca)
+ * @brief A benchmark of the time to load a dataset from the text format and
+ * from the memory-mapped binary format
+ * @version 1.0
+ * @date 2026-10-16
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+
+#include <chrono>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <random>
+#include <string>
+
+#include "../src/binary_dataset.hpp"
+#include "../src/dataset.hpp"
+#include "../src/utils.hpp"
+
+volatile double sink;  // keeps the compiler from dropping touch()
+
+/**
+ * @brief Add up all coordinates, so that every page of a memory-mapped
+ * dataset is actually read
+ *
+ */
+double touch(const Dataset &points) {
+    double sum = 0;
+    for (uint64_t i = 0; i < points.numPoints * points.numDims; i++) {
+        sum += points.coordinates[i];
+    }
+    return sum;
+}
+
+/**
+ * @brief Parse a text dataset one value at a time with iostreams, the way
+ * readDataset did before the parallel parser
+ *
+ */
+Dataset readWithStreams(const std::string &filename) {
+    std::ifstream file(filename);
+    uint64_t numPoints, numDims;
+    file >> numPoints >> numDims;
+    Dataset points(numPoints, numDims);
+    for (uint64_t i = 0; i < numPoints * numDims; i++) {
+        file >> points.coordinates[i];
+    }
+    return points;
+}
+
+/**
+ * @brief Usage: bench_load [num_points] [num_dimensions] [file_prefix]
+ * [num_threads]
+ *
+ */
+int main(int argc, char *argv[]) {
+    uint64_t numPoints = argc > 1 ? std::stoul(argv[1]) : 1000000;
+    uint64_t numDims = argc > 2 ? std::stoul(argv[2]) : 16;
+    std::string prefix = argc > 3 ? argv[3] : "bench_load";
+    uint64_t numThreads = argc > 4 ? std::stoul(argv[4]) : 1;
+    std::string textFile = prefix + ".txt";
+    std::string binaryFile = prefix + ".kmd";
+
+    std::mt19937_64 gen(42);
+    std::uniform_real_distribution<double> uniform(-100, 100);
+    Dataset dataset(numPoints, numDims);
+    for (uint64_t i = 0; i < numPoints * numDims; i++) {
+        dataset.coordinates[i] = uniform(gen);
+    }
+    {
+        std::ofstream file(textFile);
+        file << numPoints << "\n" << numDims << "\n";
+        for (uint64_t i = 0; i < numPoints; i++) {
+            for (uint64_t j = 0; j < numDims; j++) {
+                file << dataset.row(i)[j] << " ";
+            }
+            file << "\n";
+        }
+    }
+    saveBinaryDataset(dataset, binaryFile);
+
+    std::cout << "points=" << numPoints << " dims=" << numDims
+              << " threads=" << numThreads << std::endl;
+    std::cout << "loader    load_ms    load_and_read_ms    MB/s" << std::endl;
+    for (const std::string loader : {"iostream", "text", "binary"}) {
+        std::string file = loader == "binary" ? binaryFile : textFile;
+        uint64_t n, d;
+        Dataset loaded;
+        auto start = std::chrono::steady_clock::now();
+        if (loader == "iostream") {
+            loaded = readWithStreams(file);
+        } else {
+            readDataset(loaded, const_cast<char *>(file.c_str()), n, d,
+                        numThreads);
+        }
+        std::chrono::duration<double, std::milli> loadTime =
+            std::chrono::steady_clock::now() - start;
+        sink = touch(loaded);
+        std::chrono::duration<double, std::milli> totalTime =
+            std::chrono::steady_clock::now() - start;
+        double megabytes =
+            double(std::filesystem::file_size(file)) / (1 << 20);
+        std::cout << loader << "    " << loadTime.count() << "    "
+                  << totalTime.count() << "    "
+                  << megabytes / totalTime.count() * 1000 << std::endl;
+    }
+
+    std::remove(textFile.c_str());
+    std::remove(binaryFile.c_str());
+    return 0;
+}
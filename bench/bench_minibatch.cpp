@@ -0,0 +1,81 @@
+/**
+ * @file bench_minibatch.cpp
+ * @author Reza Namazi (namazir@mcmaster.ca)
+ * @brief A benchmark comparing the inertia reached against the training time
+ * of mini-batch and full-batch k-means
+ * @version 1.0
+ * @date 2026-10-16
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+
+#include <chrono>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "../src/dataset.hpp"
+#include "../src/kmeans.hpp"
+
+/**
+ * @brief Usage: bench_minibatch [num_points] [num_dimensions] [num_clusters]
+ * [batch_size]
+ *
+ */
+int main(int argc, char *argv[]) {
+    uint64_t numPoints = argc > 1 ? std::stoul(argv[1]) : 1000000;
+    uint64_t numDims = argc > 2 ? std::stoul(argv[2]) : 8;
+    uint64_t numClusters = argc > 3 ? std::stoul(argv[3]) : 32;
+    uint64_t batchSize = argc > 4 ? std::stoul(argv[4]) : 4096;
+
+    std::mt19937_64 gen(42);
+    std::uniform_real_distribution<double> uniform(0, 1);
+    std::normal_distribution<double> normal(0, 0.05);
+    std::vector<double> centers(numClusters * numDims);
+    for (double &x : centers) {
+        x = uniform(gen);
+    }
+    Dataset dataset(numPoints, numDims);
+    for (uint64_t i = 0; i < numPoints; i++) {
+        uint64_t center = gen() % numClusters;
+        for (uint64_t j = 0; j < numDims; j++) {
+            dataset.row(i)[j] = centers[center * numDims + j] + normal(gen);
+        }
+    }
+
+    std::cout << "points=" << numPoints << " dims=" << numDims
+              << " clusters=" << numClusters << " batch=" << batchSize
+              << std::endl;
+    std::cout << "mode    limit    steps    ms    inertia" << std::endl;
+
+    // Full-batch k-means stopped after a growing number of iterations
+    for (uint64_t maxIterations :
+         std::vector<uint64_t>{1, 2, 5, 10, 20, 50, 100}) {
+        KMeans kmeans(numClusters, numDims, numPoints, dataset);
+        kmeans.initMethod = InitMethod::KMeansPlusPlus;
+        auto start = std::chrono::steady_clock::now();
+        kmeans.fit(maxIterations, 1e-10);
+        std::chrono::duration<double, std::milli> time =
+            std::chrono::steady_clock::now() - start;
+        std::cout << "full    " << maxIterations << "    "
+                  << kmeans.iterationsRun << "    " << time.count() << "    "
+                  << kmeans.inertia() << std::endl;
+    }
+
+    // Mini-batch k-means with a growing number of steps (the time includes
+    // the final labeling pass)
+    for (uint64_t maxSteps : std::vector<uint64_t>{10, 30, 100, 300, 1000}) {
+        KMeans kmeans(numClusters, numDims, numPoints, dataset);
+        kmeans.initMethod = InitMethod::KMeansPlusPlus;
+        auto start = std::chrono::steady_clock::now();
+        kmeans.fitMiniBatch(batchSize, maxSteps, 1e-4, 10);
+        std::chrono::duration<double, std::milli> time =
+            std::chrono::steady_clock::now() - start;
+        std::cout << "minibatch    " << maxSteps << "    "
+                  << kmeans.iterationsRun << "    " << time.count() << "    "
+                  << kmeans.inertia() << std::endl;
+    }
+    return 0;
+}
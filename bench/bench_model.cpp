@@ -0,0 +1,77 @@
+/**
+ * @file bench_model.cpp
+ * @author Reza Namazi (namazir@mcmaster.ca)
+ * @brief A benchmark of the time to load a model from the text format and
+ * from the memory-mapped binary format
+ * @version 1.0
+ * @date 2026-10-16
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+
+#include <chrono>
+#include <cstdio>
+#include <filesystem>
+#include <iostream>
+#include <random>
+#include <string>
+
+#include "../src/dataset.hpp"
+#include "../src/kmeans.hpp"
+
+/**
+ * @brief Usage: bench_model [num_clusters] [num_dimensions] [file_prefix]
+ *
+ * Saves a random model in both formats, reports the time to load each and
+ * exits with 1 if the binary model does not load back exactly.
+ */
+int main(int argc, char *argv[]) {
+    uint64_t numClusters = argc > 1 ? std::stoul(argv[1]) : 65536;
+    uint64_t numDims = argc > 2 ? std::stoul(argv[2]) : 64;
+    std::string prefix = argc > 3 ? argv[3] : "bench_model";
+    std::string textFile = prefix + ".txt";
+    std::string binaryFile = prefix + ".kmm";
+
+    std::mt19937_64 gen(42);
+    std::uniform_real_distribution<double> uniform(-100, 100);
+    Dataset centroids(numClusters, numDims);
+    for (uint64_t i = 0; i < numClusters * numDims; i++) {
+        centroids.coordinates[i] = uniform(gen);
+    }
+    KMeans model(numClusters, numDims, 0, Dataset());
+    model.centroids = centroids;
+    model.clusterWeights.assign(numClusters, 1);
+    model.saveModel(textFile, ModelFormat::Text);
+    model.saveModel(binaryFile, ModelFormat::Binary);
+
+    std::cout << "clusters=" << numClusters << " dims=" << numDims
+              << std::endl;
+    std::cout << "format    load_ms    MB" << std::endl;
+    bool exact = true;
+    for (const std::string format : {"text", "binary"}) {
+        std::string file = format == "binary" ? binaryFile : textFile;
+        auto start = std::chrono::steady_clock::now();
+        KMeans loaded(0, Dataset(), file);
+        std::chrono::duration<double, std::milli> loadTime =
+            std::chrono::steady_clock::now() - start;
+        double megabytes =
+            double(std::filesystem::file_size(file)) / (1 << 20);
+        std::cout << format << "    " << loadTime.count() << "    "
+                  << megabytes << std::endl;
+        if (format == "binary") {
+            for (uint64_t i = 0; i < numClusters * numDims; i++) {
+                exact = exact && loaded.centroids.coordinates[i] ==
+                                     centroids.coordinates[i];
+            }
+            exact = exact && loaded.clusterWeights == model.clusterWeights;
+        }
+    }
+    if (!exact) {
+        std::cout << "The binary model did not load back exactly" << std::endl;
+    }
+
+    std::remove(textFile.c_str());
+    std::remove(binaryFile.c_str());
+    return exact ? 0 : 1;
+}
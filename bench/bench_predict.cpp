@@ -0,0 +1,107 @@
+/**
+ * @file bench_predict.cpp
+ * @author Reza Namazi (namazir@mcmaster.ca)
+ * @brief A benchmark of the throughput of prediction to a file, with the
+ * line-flushing writer that savePredictions used before and with the
+ * pipelined prediction writer in its formats
+ * @version 1.0
+ * @date 2026-10-16
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <random>
+#include <string>
+
+#include "../src/dataset.hpp"
+#include "../src/kmeans.hpp"
+
+/**
+ * @brief Predict every point, then write one line per label with std::endl,
+ * the way savePredictions did before the prediction writer
+ *
+ */
+void savePredictionsFlushing(KMeans &kmeans, const std::string &filename) {
+    kmeans.assignPointsToCentroids();
+    std::ofstream file(filename);
+    writePrecisionHeader(file, Precision::Float64);
+    for (uint64_t i = 0; i < kmeans.numPoints; i++) {
+        file << kmeans.points.labels[i] << std::endl;
+    }
+}
+
+/**
+ * @brief Usage: bench_predict [num_points] [num_dimensions] [num_clusters]
+ * [num_threads] [file_prefix]
+ *
+ * Reports the time and the points per second of predicting a random dataset
+ * with a random model and writing the predictions, for every writer, in
+ * memory and with the dataset streamed from a text file.
+ */
+int main(int argc, char *argv[]) {
+    uint64_t numPoints = argc > 1 ? std::stoul(argv[1]) : 1000000;
+    uint64_t numDims = argc > 2 ? std::stoul(argv[2]) : 8;
+    uint64_t numClusters = argc > 3 ? std::stoul(argv[3]) : 16;
+    uint64_t numThreads = argc > 4 ? std::stoul(argv[4]) : 1;
+    std::string prefix = argc > 5 ? argv[5] : "bench_predict";
+    std::string datasetFile = prefix + "_points.txt";
+    std::string predictionFile = prefix + "_predictions";
+
+    std::mt19937_64 gen(42);
+    std::uniform_real_distribution<double> uniform(-100, 100);
+    Dataset points(numPoints, numDims);
+    for (uint64_t i = 0; i < numPoints * numDims; i++) {
+        points.coordinates[i] = uniform(gen);
+    }
+    {
+        std::ofstream file(datasetFile);
+        file << numPoints << "\n" << numDims << "\n";
+        for (uint64_t i = 0; i < numPoints; i++) {
+            for (uint64_t j = 0; j < numDims; j++) {
+                file << points.row(i)[j] << " ";
+            }
+            file << "\n";
+        }
+    }
+    KMeans kmeans(numClusters, numDims, numPoints, points);
+    kmeans.setNumThreads(numThreads);
+    for (uint64_t i = 0; i < numClusters * numDims; i++) {
+        kmeans.centroids.coordinates[i] = uniform(gen);
+    }
+
+    std::cout << "points=" << numPoints << " dims=" << numDims
+              << " clusters=" << numClusters << " threads=" << numThreads
+              << std::endl;
+    std::cout << "writer    seconds    points/s" << std::endl;
+    for (const std::string writer :
+         {"endl", "text", "text+distances", "binary", "binary+distances",
+          "streamed_text", "streamed_binary"}) {
+        PredictionOptions options;
+        options.format = writer.find("binary") != std::string::npos
+                             ? PredictionFormat::Binary
+                             : PredictionFormat::Text;
+        options.distances = writer.find("distances") != std::string::npos;
+        auto start = std::chrono::steady_clock::now();
+        if (writer == "endl") {
+            savePredictionsFlushing(kmeans, predictionFile);
+        } else if (writer.rfind("streamed", 0) == 0) {
+            ChunkReader reader(datasetFile, 65536);
+            kmeans.savePredictionsStreaming(reader, predictionFile, options);
+        } else {
+            kmeans.savePredictions(predictionFile, options);
+        }
+        std::chrono::duration<double> time =
+            std::chrono::steady_clock::now() - start;
+        std::cout << writer << "    " << time.count() << "    "
+                  << double(numPoints) / time.count() << std::endl;
+    }
+
+    std::remove(datasetFile.c_str());
+    std::remove(predictionFile.c_str());
+    return 0;
+}
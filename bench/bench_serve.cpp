@@ -0,0 +1,163 @@
+/**
+ * @file bench_serve.cpp
+ * @author Reza Namazi (namazir@mcmaster.ca)
+ * @brief A load generator for the prediction server that reports the latency
+ * percentiles and the throughput for several numbers of clients and points
+ * per request
+ * @version 1.0
+ * @date 2026-10-16
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <iostream>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include "../src/kmeans.hpp"
+#include "../src/serve.hpp"
+
+/**
+ * @brief Connect to the server, retrying until it listens
+ *
+ */
+int connectTo(const std::string &path) {
+    sockaddr_un address{};
+    address.sun_family = AF_UNIX;
+    std::memcpy(address.sun_path, path.c_str(), path.size() + 1);
+    while (true) {
+        int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+        if (connect(fd, reinterpret_cast<sockaddr *>(&address),
+                    sizeof(address)) == 0) {
+            return fd;
+        }
+        close(fd);
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+}
+
+/**
+ * @brief Send requests of a number of points one after the other and record
+ * the time until the reply of every point is read
+ *
+ * @param path Path of the socket
+ * @param request Text of one request
+ * @param numPoints Number of points (lines) in the request
+ * @param numRequests Number of requests to send
+ * @param latencies Receives the latency of every request in microseconds
+ */
+void runClient(const std::string &path, const std::string &request,
+               uint64_t numPoints, uint64_t numRequests,
+               std::vector<double> &latencies) {
+    int fd = connectTo(path);
+    std::vector<char> buffer(1 << 16);
+    for (uint64_t r = 0; r < numRequests; r++) {
+        auto start = std::chrono::steady_clock::now();
+        uint64_t sent = 0;
+        while (sent < request.size()) {
+            ssize_t count = send(fd, request.data() + sent,
+                                 request.size() - sent, MSG_NOSIGNAL);
+            if (count <= 0) {
+                close(fd);
+                return;
+            }
+            sent += uint64_t(count);
+        }
+        uint64_t replies = 0;
+        while (replies < numPoints) {
+            ssize_t count = read(fd, buffer.data(), buffer.size());
+            if (count <= 0) {
+                close(fd);
+                return;
+            }
+            replies += uint64_t(
+                std::count(buffer.begin(), buffer.begin() + count, '\n'));
+        }
+        std::chrono::duration<double, std::micro> time =
+            std::chrono::steady_clock::now() - start;
+        latencies.push_back(time.count());
+    }
+    close(fd);
+}
+
+/**
+ * @brief Usage: bench_serve [num_clusters] [num_dimensions]
+ * [requests_per_client] [socket_path] [num_threads]
+ *
+ */
+int main(int argc, char *argv[]) {
+    uint64_t numClusters = argc > 1 ? std::stoul(argv[1]) : 64;
+    uint64_t numDims = argc > 2 ? std::stoul(argv[2]) : 16;
+    uint64_t numRequests = argc > 3 ? std::stoul(argv[3]) : 2000;
+    std::string path = argc > 4 ? argv[4] : "/tmp/bench_serve.sock";
+    uint64_t numThreads = argc > 5 ? std::stoul(argv[5]) : 1;
+
+    std::mt19937_64 gen(42);
+    std::uniform_real_distribution<double> uniform(0, 1);
+    KMeans kmeans(numClusters, numDims, 0, Dataset());
+    for (uint64_t i = 0; i < numClusters * numDims; i++) {
+        kmeans.centroids.coordinates[i] = uniform(gen);
+    }
+    kmeans.setNumThreads(numThreads);
+
+    std::cout << "clusters=" << numClusters << " dims=" << numDims
+              << " requests_per_client=" << numRequests
+              << " threads=" << numThreads << std::endl;
+    std::cout << "clients    points_per_request    p50_us    p99_us    "
+                 "points_per_s"
+              << std::endl;
+
+    for (uint64_t numClients : std::vector<uint64_t>{1, 4, 16}) {
+        for (uint64_t numPoints : std::vector<uint64_t>{1, 16, 256}) {
+            std::string request;
+            for (uint64_t i = 0; i < numPoints; i++) {
+                for (uint64_t j = 0; j < numDims; j++) {
+                    request += std::to_string(uniform(gen)) +
+                               (j + 1 < numDims ? " " : "\n");
+                }
+            }
+
+            PredictionServer<double> server(kmeans);
+            std::thread serving([&] { server.serveSocket(path); });
+            std::vector<std::vector<double>> latencies(numClients);
+            std::vector<std::thread> clients;
+            auto start = std::chrono::steady_clock::now();
+            for (uint64_t c = 0; c < numClients; c++) {
+                clients.emplace_back(runClient, path, std::cref(request),
+                                     numPoints, numRequests,
+                                     std::ref(latencies[c]));
+            }
+            for (std::thread &client : clients) {
+                client.join();
+            }
+            std::chrono::duration<double> time =
+                std::chrono::steady_clock::now() - start;
+            server.stop();
+            serving.join();
+
+            std::vector<double> all;
+            for (const std::vector<double> &clientLatencies : latencies) {
+                all.insert(all.end(), clientLatencies.begin(),
+                           clientLatencies.end());
+            }
+            std::sort(all.begin(), all.end());
+            double p50 = all[all.size() / 2];
+            double p99 = all[std::min(all.size() - 1, all.size() * 99 / 100)];
+            std::cout << numClients << "    " << numPoints << "    " << p50
+                      << "    " << p99 << "    "
+                      << double(all.size() * numPoints) / time.count()
+                      << std::endl;
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,294 @@
+/**
+ * @file bench_suite.cpp
+ * @author Reza Namazi (namazir@mcmaster.ca)
+ * @brief A benchmark suite that times every phase of the engine over a grid of
+ * numbers of points, dimensions and clusters and writes the results as JSON,
+ * to be compared between two builds with compare.py
+ * @version 1.0
+ * @date 2026-10-16
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "../src/binary_dataset.hpp"
+#include "../src/dataset.hpp"
+#include "../src/kmeans.hpp"
+#include "../src/utils.hpp"
+
+/**
+ * @brief Timings of one benchmark
+ */
+struct Result {
+    std::string name;        // benchmark, e.g. "assign"
+    uint64_t numPoints;      // number of points
+    uint64_t numDims;        // number of dimensions
+    uint64_t numClusters;    // number of clusters (0 when not relevant)
+    uint64_t iterations;     // number of timed runs
+    double medianTime;       // median time of a run in nanoseconds
+    double meanTime;         // mean time of a run in nanoseconds
+    double minTime;          // fastest run in nanoseconds
+};
+
+/**
+ * @brief Run a function once to warm up, then time it until it has run for
+ * minSeconds and at least three times
+ *
+ * @param function The function to time
+ * @param minSeconds Minimum total time of the timed runs
+ * @return The time of every run in nanoseconds
+ */
+template <typename Function>
+std::vector<double> measure(Function function, double minSeconds) {
+    function();
+    std::vector<double> times;
+    double total = 0;
+    while (times.size() < 3 || total < minSeconds * 1e9) {
+        auto start = std::chrono::steady_clock::now();
+        function();
+        std::chrono::duration<double, std::nano> time =
+            std::chrono::steady_clock::now() - start;
+        times.push_back(time.count());
+        total += time.count();
+    }
+    return times;
+}
+
+/**
+ * @brief Summarize the times of a benchmark
+ *
+ */
+Result summarize(const std::string &name, uint64_t numPoints, uint64_t numDims,
+                 uint64_t numClusters, std::vector<double> times) {
+    std::sort(times.begin(), times.end());
+    double sum = 0;
+    for (double time : times) {
+        sum += time;
+    }
+    Result result;
+    result.name = name;
+    result.numPoints = numPoints;
+    result.numDims = numDims;
+    result.numClusters = numClusters;
+    result.iterations = times.size();
+    result.medianTime = times[times.size() / 2];
+    result.meanTime = sum / double(times.size());
+    result.minTime = times.front();
+    std::cerr << name << " N=" << numPoints << " D=" << numDims
+              << " K=" << numClusters << ": " << result.medianTime / 1e6
+              << " ms" << std::endl;
+    return result;
+}
+
+/**
+ * @brief Generate blobs the way generateBlob does (numClusters centers drawn
+ * uniformly in the unit cube, and points drawn uniformly within radius of a
+ * random center in every coordinate), from a seed that only depends on the
+ * size, so that every run of the suite times the same data
+ *
+ */
+Dataset generateBlobs(uint64_t numPoints, uint64_t numDims,
+                      uint64_t numClusters, double radius) {
+    std::mt19937_64 gen(numPoints * 1000003 + numDims * 1009 + numClusters);
+    std::uniform_real_distribution<double> uniform(0, 1);
+    Dataset centers(numClusters, numDims);
+    for (uint64_t i = 0; i < numClusters * numDims; i++) {
+        centers.coordinates[i] = uniform(gen);
+    }
+    Dataset points(numPoints, numDims);
+    for (uint64_t i = 0; i < numPoints; i++) {
+        const double *center = centers.row(gen() % numClusters);
+        double *point = points.row(i);
+        for (uint64_t j = 0; j < numDims; j++) {
+            point[j] = center[j] + (uniform(gen) * 2 - 1) * radius;
+        }
+    }
+    return points;
+}
+
+volatile double sink;  // keeps the compiler from dropping the reads of loads
+
+/**
+ * @brief Load a dataset file with readDataset and read every coordinate, so
+ * that a memory-mapped dataset is actually paged in
+ *
+ */
+void loadAndRead(const std::string &filename, uint64_t numThreads) {
+    Dataset points;
+    uint64_t numPoints, numDims;
+    std::vector<char> name(filename.begin(), filename.end());
+    name.push_back('\0');
+    readDataset(points, name.data(), numPoints, numDims, numThreads);
+    double sum = 0;
+    for (uint64_t i = 0; i < numPoints * numDims; i++) {
+        sum += points.coordinates[i];
+    }
+    sink = sum;
+}
+
+/**
+ * @brief Parse a comma-separated list of numbers
+ *
+ */
+std::vector<uint64_t> parseList(const std::string &text) {
+    std::vector<uint64_t> values;
+    std::stringstream stream(text);
+    std::string value;
+    while (std::getline(stream, value, ',')) {
+        values.push_back(std::stoul(value));
+    }
+    return values;
+}
+
+/**
+ * @brief Usage: bench_suite [output_json] [grid] [min_seconds] [num_threads]
+ * [work_dir]
+ *
+ * grid is "small" (the default), "full", or three comma-separated lists of
+ * numbers of points, dimensions and clusters separated by slashes (e.g.
+ * "100000/2,16/8,64"). The dataset files timed by the loading benchmarks and
+ * the predictions are written to work_dir.
+ */
+int main(int argc, char *argv[]) {
+    std::string outputFile = argc > 1 ? argv[1] : "bench_suite.json";
+    std::string grid = argc > 2 ? argv[2] : "small";
+    double minSeconds = argc > 3 ? std::stod(argv[3]) : 0.5;
+    uint64_t numThreads = argc > 4 ? std::stoul(argv[4]) : 1;
+    std::string workDir = argc > 5 ? argv[5] : ".";
+
+    std::vector<uint64_t> pointCounts = {20000};
+    std::vector<uint64_t> dimCounts = {2, 16, 128};
+    std::vector<uint64_t> clusterCounts = {8, 64};
+    if (grid == "full") {
+        pointCounts = {100000, 1000000};
+        dimCounts = {2, 16, 64, 256};
+        clusterCounts = {8, 64, 256};
+    } else if (grid != "small") {
+        std::string::size_type first = grid.find('/');
+        std::string::size_type second = grid.find('/', first + 1);
+        if (first == std::string::npos || second == std::string::npos) {
+            std::cerr << "Unknown grid " << grid << std::endl;
+            return 1;
+        }
+        pointCounts = parseList(grid.substr(0, first));
+        dimCounts = parseList(grid.substr(first + 1, second - first - 1));
+        clusterCounts = parseList(grid.substr(second + 1));
+    }
+    // Iterations of the timed fit, which never stops on the threshold so that
+    // every run does the same work
+    const uint64_t fitIterations = 10;
+    const double radius = 0.1;
+
+    std::vector<Result> results;
+    std::string textFile = workDir + "/bench_suite.txt";
+    std::string binaryFile = workDir + "/bench_suite.kmd";
+    std::string predictionFile = workDir + "/bench_suite_predictions.txt";
+    for (uint64_t numPoints : pointCounts) {
+        for (uint64_t numDims : dimCounts) {
+            // Loading only depends on the size of the dataset
+            Dataset data = generateBlobs(numPoints, numDims, 8, radius);
+            {
+                std::ofstream file(textFile);
+                file << numPoints << '\n' << numDims << '\n';
+                for (uint64_t i = 0; i < numPoints; i++) {
+                    for (uint64_t j = 0; j < numDims; j++) {
+                        file << data.row(i)[j] << " ";
+                    }
+                    file << '\n';
+                }
+            }
+            saveBinaryDataset(data, binaryFile);
+            results.push_back(summarize(
+                "load_text", numPoints, numDims, 0,
+                measure([&] { loadAndRead(textFile, numThreads); },
+                        minSeconds)));
+            results.push_back(summarize(
+                "load_binary", numPoints, numDims, 0,
+                measure([&] { loadAndRead(binaryFile, numThreads); },
+                        minSeconds)));
+
+            for (uint64_t numClusters : clusterCounts) {
+                Dataset points =
+                    generateBlobs(numPoints, numDims, numClusters, radius);
+                KMeans kmeans(numClusters, numDims, numPoints, points);
+                kmeans.setNumThreads(numThreads);
+                auto bench = [&](const std::string &name, auto function) {
+                    results.push_back(
+                        summarize(name, numPoints, numDims, numClusters,
+                                  measure(function, minSeconds)));
+                };
+
+                kmeans.initMethod = InitMethod::Random;
+                bench("init_random", [&] {
+                    kmeans.setSeed(0);
+                    kmeans.initializeCentroids();
+                });
+                kmeans.initMethod = InitMethod::KMeansPlusPlus;
+                bench("init_kmeans++", [&] {
+                    kmeans.setSeed(0);
+                    kmeans.initializeCentroids();
+                });
+                Dataset initial = kmeans.centroids.clone();
+
+                bench("assign", [&] { kmeans.assignPointsToCentroids(); });
+                bench("update", [&] { kmeans.updateCentroids(); });
+                bench("assign_accumulate",
+                      [&] { kmeans.assignAndAccumulate(); });
+                bench("inertia", [&] { sink = kmeans.inertia(); });
+                for (Algorithm algorithm :
+                     {Algorithm::Lloyd, Algorithm::Hamerly}) {
+                    kmeans.algorithm = algorithm;
+                    bench(algorithm == Algorithm::Lloyd ? "fit_lloyd"
+                                                       : "fit_hamerly",
+                         [&] {
+                             std::copy(initial.coordinates,
+                                       initial.coordinates +
+                                           numClusters * numDims,
+                                       kmeans.centroids.coordinates);
+                             kmeans.fitFromCentroids(fitIterations, -1);
+                         });
+                }
+                bench("predict",
+                     [&] { kmeans.savePredictions(predictionFile); });
+            }
+        }
+    }
+    std::remove(textFile.c_str());
+    std::remove(binaryFile.c_str());
+    std::remove(predictionFile.c_str());
+
+    // The layout of the output of Google Benchmark, with the sizes as fields
+    std::ofstream out(outputFile);
+    out << "{\n  \"context\": {\"grid\": \"" << grid
+        << "\", \"min_seconds\": " << minSeconds
+        << ", \"num_threads\": " << numThreads
+        << ", \"fit_iterations\": " << fitIterations << "},\n"
+        << "  \"benchmarks\": [\n";
+    for (uint64_t r = 0; r < results.size(); r++) {
+        const Result &result = results[r];
+        out << "    {\"name\": \"" << result.name << "/N:" << result.numPoints
+            << "/D:" << result.numDims << "/K:" << result.numClusters
+            << "\", \"benchmark\": \"" << result.name
+            << "\", \"num_points\": " << result.numPoints
+            << ", \"num_dims\": " << result.numDims
+            << ", \"num_clusters\": " << result.numClusters
+            << ", \"iterations\": " << result.iterations
+            << ", \"real_time\": " << result.medianTime
+            << ", \"mean_time\": " << result.meanTime
+            << ", \"min_time\": " << result.minTime
+            << ", \"time_unit\": \"ns\"}"
+            << (r + 1 < results.size() ? "," : "") << "\n";
+    }
+    out << "  ]\n}\n";
+    return 0;
+}
@@ -0,0 +1,86 @@
+/**
+ * @file bench_threads.cpp
+ * @author Reza Namazi (namazir@mcmaster.ca)
+ * @brief A benchmark measuring how training scales with the number of threads
+ * and checking that the result does not depend on it
+ * @version 1.0
+ * @date 2026-10-16
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+
+#include <chrono>
+#include <cstring>
+#include <iostream>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "../src/dataset.hpp"
+#include "../src/kmeans.hpp"
+
+/**
+ * @brief Usage: bench_threads [num_points] [num_dimensions] [num_clusters]
+ * [iterations] [max_threads]
+ *
+ */
+int main(int argc, char *argv[]) {
+    uint64_t numPoints = argc > 1 ? std::stoul(argv[1]) : 1000000;
+    uint64_t numDims = argc > 2 ? std::stoul(argv[2]) : 8;
+    uint64_t numClusters = argc > 3 ? std::stoul(argv[3]) : 16;
+    uint64_t iterations = argc > 4 ? std::stoul(argv[4]) : 10;
+    uint64_t maxThreads =
+        argc > 5 ? std::stoul(argv[5]) : std::thread::hardware_concurrency();
+    if (maxThreads < 1) {
+        maxThreads = 1;
+    }
+
+    std::mt19937_64 gen(42);
+    std::uniform_real_distribution<double> uniform(0, 1);
+    Dataset dataset(numPoints, numDims);
+    for (uint64_t i = 0; i < numPoints * numDims; i++) {
+        dataset.coordinates[i] = uniform(gen);
+    }
+
+    std::cout << "points=" << numPoints << " dims=" << numDims
+              << " clusters=" << numClusters << " iterations=" << iterations
+              << std::endl;
+    std::cout << "threads    ms_per_fit    speedup    identical" << std::endl;
+
+    double baseTime = 0;
+    Dataset reference;
+    std::vector<uint64_t> threadCounts;
+    for (uint64_t t = 1; t < maxThreads; t *= 2) {
+        threadCounts.push_back(t);
+    }
+    threadCounts.push_back(maxThreads);
+
+    for (uint64_t t : threadCounts) {
+        KMeans kmeans(numClusters, numDims, numPoints, dataset);
+        kmeans.setNumThreads(t);
+
+        // Every model has the same seed, so the same initial centroids; a
+        // threshold of zero runs all the iterations
+        auto start = std::chrono::steady_clock::now();
+        kmeans.fit(iterations, 0);
+        std::chrono::duration<double, std::milli> time =
+            std::chrono::steady_clock::now() - start;
+
+        if (t == 1) {
+            baseTime = time.count();
+            reference = kmeans.centroids.clone();
+        }
+        bool identical =
+            std::memcmp(reference.coordinates, kmeans.centroids.coordinates,
+                        numClusters * numDims * sizeof(double)) == 0;
+        std::cout << t << "    " << time.count() << "    "
+                  << baseTime / time.count() << "    "
+                  << (identical ? "yes" : "no") << std::endl;
+        if (!identical) {
+            return 1;
+        }
+    }
+    return 0;
+}
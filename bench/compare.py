@@ -0,0 +1,49 @@
+from argparse import ArgumentParser
+import json
+import sys
+
+
+def load(filename, metric):
+    with open(filename, 'r') as f:
+        benchmarks = json.load(f)['benchmarks']
+    return {b['name']: b[metric] for b in benchmarks}
+
+
+if __name__ == '__main__':
+    parser = ArgumentParser(
+        description='Compare two outputs of bench_suite and flag the '
+                    'benchmarks that got slower by more than a threshold')
+    parser.add_argument('baseline', type=str)
+    parser.add_argument('contender', type=str)
+    parser.add_argument('--threshold', type=float, default=0.05,
+                        help='relative slowdown counted as a regression')
+    parser.add_argument('--metric', type=str, default='real_time',
+                        choices=['real_time', 'mean_time', 'min_time'])
+    args = parser.parse_args()
+
+    baseline = load(args.baseline, args.metric)
+    contender = load(args.contender, args.metric)
+
+    regressions = 0
+    print(f'{"benchmark":<40} {"baseline_ms":>12} {"contender_ms":>12} '
+          f'{"change":>8}')
+    for name, before in baseline.items():
+        if name not in contender:
+            print(f'{name:<40} {before / 1e6:>12.3f} {"missing":>12}')
+            continue
+        after = contender[name]
+        change = after / before - 1
+        flag = ''
+        if change > args.threshold:
+            flag = '  REGRESSION'
+            regressions += 1
+        elif change < -args.threshold:
+            flag = '  improvement'
+        print(f'{name:<40} {before / 1e6:>12.3f} {after / 1e6:>12.3f} '
+              f'{change:>+8.1%}{flag}')
+    for name in contender:
+        if name not in baseline:
+            print(f'{name:<40} {"new":>12} {contender[name] / 1e6:>12.3f}')
+
+    print(f'{regressions} regression(s) beyond {args.threshold:.0%}')
+    sys.exit(1 if regressions > 0 else 0)
@@ -20,7 +20,7 @@ if __name__ == '__main__':
             X[i] = np.array(list(map(float, line.split())))
     
     with open(args.clusters, 'r') as f:
-        y = f.readlines()
+        y = [line for line in f.readlines() if not line.startswith('#')]
         y = np.array(list(map(int, y)))
 
     X = PCA(n_components=2).fit_transform(X)
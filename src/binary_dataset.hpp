@@ -0,0 +1,296 @@
+/**
+ * @file binary_dataset.hpp
+ * @author Reza Namazi (namazir@mcmaster.ca)
+ * @brief A header file for the binary dataset format, which is loaded with
+ * mmap without parsing or copying the coordinates
+ * @version 1.0
+ * @date 2026-10-16
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+#if defined(__unix__) || defined(__APPLE__)
+#define KMEANS_HAVE_MMAP 1
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#else
+#define KMEANS_HAVE_MMAP 0
+#endif
+
+#include "dataset.hpp"
+#include "stream.hpp"
+
+/**
+ * @brief Header at the start of a binary dataset file. All fields are stored
+ * little-endian; the coordinates start at dataOffset, which is a multiple of
+ * alignment, and are stored row-major.
+ */
+struct BinaryDatasetHeader {
+    char magic[8];        // "KMEANSDS"
+    uint32_t version;     // version of the format
+    uint32_t dtype;       // type of the coordinates (float64 or float32)
+    uint64_t numPoints;   // number of points
+    uint64_t numDims;     // number of dimensions
+    uint64_t alignment;   // alignment of the coordinates in the file
+    uint64_t dataOffset;  // offset of the coordinates in the file
+    uint64_t reserved[2];  // zero, pads the header to 64 bytes
+
+    static constexpr char expectedMagic[8] = {'K', 'M', 'E', 'A',
+                                              'N', 'S', 'D', 'S'};
+    static constexpr uint32_t currentVersion = 1;
+    static constexpr uint32_t float64 = 1;
+    static constexpr uint32_t float32 = 2;
+
+    /**
+     * @brief The dtype of a scalar type
+     */
+    template <typename Scalar>
+    static constexpr uint32_t dtypeOf =
+        std::is_same_v<Scalar, float> ? float32 : float64;
+};
+
+static_assert(sizeof(BinaryDatasetHeader) == 64,
+              "The binary dataset header should be 64 bytes");
+
+/**
+ * @brief Check whether a file is a binary dataset (starts with the magic)
+ *
+ * @param filename Name of the file
+ * @return Whether the file is a binary dataset
+ */
+inline bool isBinaryDataset(const std::string &filename) {
+    std::ifstream file(filename, std::ios::binary);
+    char magic[8];
+    if (!file.read(magic, sizeof(magic))) {
+        return false;
+    }
+    return std::memcmp(magic, BinaryDatasetHeader::expectedMagic,
+                       sizeof(magic)) == 0;
+}
+
+/**
+ * @brief Make the header of a binary dataset with coordinates of type Scalar
+ *
+ * @param numPoints Number of points in the dataset
+ * @param numDims Number of dimensions (coordinates) that each point has
+ * @return The header
+ */
+template <typename Scalar = double>
+BinaryDatasetHeader makeBinaryDatasetHeader(uint64_t numPoints,
+                                            uint64_t numDims) {
+    BinaryDatasetHeader header;
+    std::memset(&header, 0, sizeof(header));
+    std::memcpy(header.magic, BinaryDatasetHeader::expectedMagic,
+                sizeof(header.magic));
+    header.version = BinaryDatasetHeader::currentVersion;
+    header.dtype = BinaryDatasetHeader::dtypeOf<Scalar>;
+    header.numPoints = numPoints;
+    header.numDims = numDims;
+    header.alignment = Dataset::alignment;
+    header.dataOffset = Dataset::alignment;
+    return header;
+}
+
+/**
+ * @brief Write a header and pad the file up to the coordinates
+ *
+ */
+inline void writeBinaryDatasetHeader(std::ofstream &file,
+                                     const BinaryDatasetHeader &header) {
+    file.write(reinterpret_cast<const char *>(&header), sizeof(header));
+    std::vector<char> padding(header.dataOffset - sizeof(header), 0);
+    file.write(padding.data(), std::streamsize(padding.size()));
+}
+
+/**
+ * @brief Save a dataset in the binary format, in its own precision
+ *
+ * @param points The dataset
+ * @param filename Name of the file to write
+ */
+template <typename Scalar>
+void saveBinaryDataset(const BasicDataset<Scalar> &points,
+                       const std::string &filename) {
+    std::ofstream file(filename, std::ios::binary);
+    if (!file.is_open()) {
+        throw std::runtime_error("Could not open the file");
+    }
+    writeBinaryDatasetHeader(
+        file,
+        makeBinaryDatasetHeader<Scalar>(points.numPoints, points.numDims));
+    file.write(reinterpret_cast<const char *>(points.coordinates),
+               std::streamsize(points.numPoints * points.numDims *
+                               sizeof(Scalar)));
+    if (!file) {
+        throw std::runtime_error("Could not write the dataset");
+    }
+}
+
+/**
+ * @brief Convert a text dataset (the format of readDataset) to the binary
+ * format with coordinates of type Scalar. The text file is read in chunks, so
+ * it does not have to fit in memory.
+ *
+ * @param inputFile Name of the text dataset
+ * @param outputFile Name of the binary dataset to write
+ * @param chunkSize Number of points read at a time
+ */
+template <typename Scalar = double>
+void convertToBinaryDataset(const std::string &inputFile,
+                            const std::string &outputFile,
+                            uint64_t chunkSize = 65536) {
+    ChunkReader reader(inputFile, chunkSize);
+    std::ofstream file(outputFile, std::ios::binary);
+    if (!file.is_open()) {
+        throw std::runtime_error("Could not open the file");
+    }
+    writeBinaryDatasetHeader(
+        file,
+        makeBinaryDatasetHeader<Scalar>(reader.numPoints, reader.numDims));
+    forEachChunk<Scalar>(reader, [&](BasicDataset<Scalar> &chunk, uint64_t) {
+        file.write(reinterpret_cast<const char *>(chunk.coordinates),
+                   std::streamsize(chunk.numPoints * chunk.numDims *
+                                   sizeof(Scalar)));
+    });
+    if (!file) {
+        throw std::runtime_error("Could not write the dataset");
+    }
+}
+
+/**
+ * @brief Read a binary dataset stored in the other precision than Scalar and
+ * convert its coordinates, one chunk of rows at a time
+ *
+ * @param filename Name of the binary dataset
+ * @param header The header of the file, already validated
+ * @return The dataset
+ */
+template <typename Scalar>
+BasicDataset<Scalar> convertBinaryDataset(const std::string &filename,
+                                          const BinaryDatasetHeader &header) {
+    using Stored = std::conditional_t<std::is_same_v<Scalar, float>, double,
+                                      float>;
+    BasicDataset<Scalar> points(header.numPoints, header.numDims);
+    std::ifstream file(filename, std::ios::binary);
+    file.seekg(std::streamoff(header.dataOffset));
+    uint64_t total = header.numPoints * header.numDims;
+    std::vector<Stored> chunk(std::min<uint64_t>(total, 1 << 20));
+    for (uint64_t start = 0; start < total; start += chunk.size()) {
+        uint64_t count = std::min<uint64_t>(chunk.size(), total - start);
+        if (!file.read(reinterpret_cast<char *>(chunk.data()),
+                       std::streamsize(count * sizeof(Stored)))) {
+            throw std::runtime_error("Could not read the coordinates");
+        }
+        for (uint64_t i = 0; i < count; i++) {
+            points.coordinates[start + i] = Scalar(chunk[i]);
+        }
+    }
+    return points;
+}
+
+#if KMEANS_HAVE_MMAP
+/**
+ * @brief Map the start of a file in memory. The mapping is private, so
+ * writing to it never changes the file.
+ *
+ * @param filename Name of the file
+ * @param bytes Number of bytes to map
+ * @return The mapping, unmapped when the last owner is destroyed
+ */
+inline std::shared_ptr<char> mapFile(const std::string &filename,
+                                     uint64_t bytes) {
+    int fd = open(filename.c_str(), O_RDONLY);
+    if (fd < 0) {
+        throw std::runtime_error("Could not open the file");
+    }
+    void *mapped =
+        mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (mapped == MAP_FAILED) {
+        throw std::runtime_error("Could not map the file");
+    }
+    return std::shared_ptr<char>(static_cast<char *>(mapped),
+                                 [bytes](char *p) { munmap(p, bytes); });
+}
+#endif
+
+/**
+ * @brief Load a binary dataset. If the file stores Scalar, it is
+ * memory-mapped and the dataset uses the mapped pages directly: nothing is
+ * parsed or copied, and pages are read from disk on first access. The mapping
+ * is private, so writing to the coordinates never changes the file. A file in
+ * the other precision is read and converted.
+ *
+ * @param filename Name of the binary dataset
+ * @return The dataset
+ */
+template <typename Scalar = double>
+BasicDataset<Scalar> loadBinaryDataset(const std::string &filename) {
+    std::ifstream file(filename, std::ios::binary);
+    if (!file.is_open()) {
+        throw std::runtime_error("Could not open the file");
+    }
+    BinaryDatasetHeader header;
+    if (!file.read(reinterpret_cast<char *>(&header), sizeof(header)) ||
+        std::memcmp(header.magic, BinaryDatasetHeader::expectedMagic,
+                    sizeof(header.magic)) != 0) {
+        throw std::runtime_error("Not a binary dataset");
+    }
+    if (header.version != BinaryDatasetHeader::currentVersion) {
+        throw std::runtime_error("Unsupported binary dataset version");
+    }
+    if (header.dtype != BinaryDatasetHeader::float64 &&
+        header.dtype != BinaryDatasetHeader::float32) {
+        throw std::runtime_error("Unsupported binary dataset type");
+    }
+    uint64_t scalarBytes =
+        header.dtype == BinaryDatasetHeader::float32 ? sizeof(float)
+                                                     : sizeof(double);
+    if (header.dataOffset % scalarBytes != 0) {
+        throw std::runtime_error("Misaligned binary dataset");
+    }
+    uint64_t dataBytes = header.numPoints * header.numDims * scalarBytes;
+    file.seekg(0, std::ios::end);
+    if (uint64_t(file.tellg()) < header.dataOffset + dataBytes) {
+        throw std::runtime_error("Could not read the coordinates");
+    }
+    file.close();
+
+    if (header.dtype != BinaryDatasetHeader::dtypeOf<Scalar>) {
+        return convertBinaryDataset<Scalar>(filename, header);
+    }
+
+#if KMEANS_HAVE_MMAP
+    uint64_t mappedBytes = header.dataOffset + dataBytes;
+    std::shared_ptr<char> mapping = mapFile(filename, mappedBytes);
+    // The training loops read the points in order
+    madvise(mapping.get(), mappedBytes, MADV_SEQUENTIAL);
+
+    // The owner unmaps the whole file; the dataset points at the coordinates
+    std::shared_ptr<Scalar> storage(
+        mapping, reinterpret_cast<Scalar *>(mapping.get() + header.dataOffset));
+    return BasicDataset<Scalar>(header.numPoints, header.numDims, storage);
+#else
+    BasicDataset<Scalar> points(header.numPoints, header.numDims);
+    file.open(filename, std::ios::binary);
+    file.seekg(std::streamoff(header.dataOffset));
+    file.read(reinterpret_cast<char *>(points.coordinates),
+              std::streamsize(dataBytes));
+    return points;
+#endif
+}
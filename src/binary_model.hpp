@@ -0,0 +1,286 @@
+/**
+ * @file binary_model.hpp
+ * @author Reza Namazi (namazir@mcmaster.ca)
+ * @brief A header file for the binary model format, which keeps the centroids
+ * exactly and is loaded with mmap
+ * @version 1.0
+ * @date 2026-10-16
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <memory>
+#include <new>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "binary_dataset.hpp"
+#include "dataset.hpp"
+#include "random.hpp"
+
+/**
+ * @brief Formats a model can be saved in
+ */
+enum class ModelFormat {
+    Text,   // one line per centroid, readable (larger and slower to load)
+    Binary  // mapped when loaded, with a header and a checksum (see
+            // BinaryModelHeader)
+};
+
+/**
+ * @brief Header at the start of a binary model file. All fields are stored
+ * little-endian. The sections follow at offsets that are multiples of 64
+ * bytes, each padded with zeros up to the next one:
+ * - the centroids, numClusters x numDims values of the dtype, row-major;
+ * - optionally, the weight of every centroid (see KMeans::clusterWeights),
+ *   as 64-bit floats.
+ * The checksum (see modelChecksum) covers the whole file, with the checksum
+ * field set to zero. Loading does not check it (see verifyBinaryModel).
+ */
+struct BinaryModelHeader {
+    char magic[8];            // "KMEANSMD"
+    uint32_t version;         // version of the format
+    uint32_t dtype;           // type of the centroids (see BinaryDatasetHeader)
+    uint64_t numClusters;     // number of centroids
+    uint64_t numDims;         // number of dimensions
+    uint64_t centroidOffset;  // offset of the centroids in the file
+    uint64_t weightsOffset;   // offset of the weights (0: no weights)
+    uint64_t reserved;        // zero
+    uint64_t checksum;        // checksum of the file
+
+    static constexpr char expectedMagic[8] = {'K', 'M', 'E', 'A',
+                                              'N', 'S', 'M', 'D'};
+    static constexpr uint32_t currentVersion = 1;
+    static constexpr uint64_t alignment = 64;  // alignment of the sections
+};
+
+static_assert(sizeof(BinaryModelHeader) == 64,
+              "The binary model header should be 64 bytes");
+
+/**
+ * @brief Round a size up to the alignment of the sections of a binary model
+ *
+ */
+inline uint64_t alignModelSection(uint64_t size) {
+    return (size + BinaryModelHeader::alignment - 1) /
+           BinaryModelHeader::alignment * BinaryModelHeader::alignment;
+}
+
+/**
+ * @brief Add bytes to the checksum of a binary model: every 64-bit word is
+ * mixed into the state with splitMix64
+ *
+ * @param state The checksum of the bytes before (0 for none)
+ * @param data The bytes
+ * @param size Number of bytes, a multiple of 8
+ * @return The checksum of the bytes before and these
+ */
+inline uint64_t modelChecksum(uint64_t state, const char *data,
+                              uint64_t size) {
+    for (uint64_t offset = 0; offset < size; offset += sizeof(uint64_t)) {
+        uint64_t word;
+        std::memcpy(&word, data + offset, sizeof(word));
+        state = splitMix64(state ^ word);
+    }
+    return state;
+}
+
+/**
+ * @brief Check whether a file is a binary model (starts with the magic)
+ *
+ * @param filename Name of the file
+ * @return Whether the file is a binary model
+ */
+inline bool isBinaryModel(const std::string &filename) {
+    std::ifstream file(filename, std::ios::binary);
+    char magic[8];
+    if (!file.read(magic, sizeof(magic))) {
+        return false;
+    }
+    return std::memcmp(magic, BinaryModelHeader::expectedMagic,
+                       sizeof(magic)) == 0;
+}
+
+/**
+ * @brief Read and check the header of a binary model
+ *
+ * @param filename Name of the file
+ * @param fileSize Receives the size of the file
+ * @return The header
+ */
+inline BinaryModelHeader readBinaryModelHeader(const std::string &filename,
+                                               uint64_t &fileSize) {
+    std::ifstream file(filename, std::ios::binary);
+    if (!file.is_open()) {
+        throw std::runtime_error("Could not open the file");
+    }
+    BinaryModelHeader header;
+    if (!file.read(reinterpret_cast<char *>(&header), sizeof(header)) ||
+        std::memcmp(header.magic, BinaryModelHeader::expectedMagic,
+                    sizeof(header.magic)) != 0) {
+        throw std::runtime_error("Not a binary model");
+    }
+    if (header.version != BinaryModelHeader::currentVersion) {
+        throw std::runtime_error("Unsupported binary model version");
+    }
+    if (header.dtype != BinaryDatasetHeader::float64 &&
+        header.dtype != BinaryDatasetHeader::float32) {
+        throw std::runtime_error("Unsupported binary model type");
+    }
+    file.seekg(0, std::ios::end);
+    fileSize = uint64_t(file.tellg());
+
+    // Every section has to be aligned and inside the file
+    uint64_t scalarBytes = header.dtype == BinaryDatasetHeader::float32
+                               ? sizeof(float)
+                               : sizeof(double);
+    auto inside = [&](uint64_t offset, uint64_t bytes) {
+        return offset % BinaryModelHeader::alignment == 0 &&
+               offset >= sizeof(header) && offset <= fileSize &&
+               bytes <= fileSize - offset;
+    };
+    if (header.numDims == 0) {
+        throw std::runtime_error("The binary model has no dimensions");
+    }
+    // The sizes of the sections are bounded by the size of the file before
+    // they are computed, so that a corrupt header cannot make them wrap
+    if (header.numDims > fileSize / scalarBytes ||
+        header.numClusters > fileSize / (header.numDims * scalarBytes)) {
+        throw std::runtime_error("The binary model is truncated");
+    }
+    if (!inside(header.centroidOffset,
+                header.numClusters * header.numDims * scalarBytes) ||
+        (header.weightsOffset != 0 &&
+         !inside(header.weightsOffset, header.numClusters * sizeof(double))) ||
+        fileSize % sizeof(uint64_t) != 0) {
+        throw std::runtime_error("The binary model is truncated");
+    }
+    return header;
+}
+
+/**
+ * @brief Checksum of a binary model in memory (see BinaryModelHeader)
+ *
+ * @param data The whole file
+ * @param size Size of the file
+ * @return The checksum
+ */
+inline uint64_t binaryModelChecksum(const char *data, uint64_t size) {
+    BinaryModelHeader header;
+    std::memcpy(&header, data, sizeof(header));
+    header.checksum = 0;
+    uint64_t state = modelChecksum(
+        0, reinterpret_cast<const char *>(&header), sizeof(header));
+    return modelChecksum(state, data + sizeof(header), size - sizeof(header));
+}
+
+/**
+ * @brief A binary model in memory
+ */
+struct BinaryModelFile {
+    BinaryModelHeader header;   // the header of the file
+    std::shared_ptr<char> data;  // the whole file (mapped when possible)
+    uint64_t size = 0;           // size of the file
+};
+
+/**
+ * @brief Open a binary model. The file is memory-mapped when the platform
+ * allows it, so nothing is parsed and the centroids can be used where they
+ * are. Only the header and the bounds of the sections are checked, so that no
+ * page is read before it is used; verifyBinaryModel checks the contents.
+ *
+ * @param filename Name of the binary model
+ * @return The file
+ */
+inline BinaryModelFile openBinaryModel(const std::string &filename) {
+    BinaryModelFile model;
+    model.header = readBinaryModelHeader(filename, model.size);
+#if KMEANS_HAVE_MMAP
+    model.data = mapFile(filename, model.size);
+#else
+    // Aligned like a mapping would be, so the centroids can be used in place
+    constexpr std::align_val_t alignment{BinaryModelHeader::alignment};
+    model.data = std::shared_ptr<char>(
+        new (alignment) char[model.size],
+        [](char *p) { operator delete[](p, alignment); });
+    std::ifstream file(filename, std::ios::binary);
+    if (!file.read(model.data.get(), std::streamsize(model.size))) {
+        throw std::runtime_error("Could not read the binary model");
+    }
+#endif
+    return model;
+}
+
+/**
+ * @brief Verify the checksum of a binary model, which reads the whole file
+ *
+ * @param filename Name of the binary model
+ */
+inline void verifyBinaryModel(const std::string &filename) {
+    BinaryModelFile model = openBinaryModel(filename);
+    if (binaryModelChecksum(model.data.get(), model.size) !=
+        model.header.checksum) {
+        throw std::runtime_error("The checksum of the binary model is wrong");
+    }
+}
+
+/**
+ * @brief Write a binary model. The file is written under a temporary name and
+ * then renamed, so a process that has the old model mapped keeps reading it
+ * and never sees a partly written file.
+ *
+ * @param filename Name of the binary model
+ * @param centroids The centroids
+ * @param weights The weight of every centroid, or empty for none
+ */
+template <typename Scalar>
+void writeBinaryModel(const std::string &filename,
+                      const BasicDataset<Scalar> &centroids,
+                      const std::vector<double> &weights) {
+    uint64_t k = centroids.numPoints;
+    uint64_t d = centroids.numDims;
+    BinaryModelHeader header{};
+    std::memcpy(header.magic, BinaryModelHeader::expectedMagic,
+                sizeof(header.magic));
+    header.version = BinaryModelHeader::currentVersion;
+    header.dtype = BinaryDatasetHeader::dtypeOf<Scalar>;
+    header.numClusters = k;
+    header.numDims = d;
+    header.centroidOffset = alignModelSection(sizeof(header));
+    uint64_t end = alignModelSection(header.centroidOffset +
+                                     k * d * sizeof(Scalar));
+    if (weights.size() == k) {
+        header.weightsOffset = end;
+        end = alignModelSection(end + k * sizeof(double));
+    }
+
+    // The whole file is built in memory: a model is small
+    std::vector<char> bytes(end, 0);
+    std::memcpy(bytes.data() + header.centroidOffset, centroids.coordinates,
+                k * d * sizeof(Scalar));
+    if (header.weightsOffset != 0) {
+        std::memcpy(bytes.data() + header.weightsOffset, weights.data(),
+                    k * sizeof(double));
+    }
+    std::memcpy(bytes.data(), &header, sizeof(header));
+    header.checksum = binaryModelChecksum(bytes.data(), end);
+    std::memcpy(bytes.data(), &header, sizeof(header));
+
+    std::string temporary = filename + ".tmp";
+    std::ofstream file(temporary, std::ios::binary);
+    if (!file.write(bytes.data(), std::streamsize(end)) || !file.flush()) {
+        throw std::runtime_error("Could not write the model");
+    }
+    file.close();
+    if (std::rename(temporary.c_str(), filename.c_str()) != 0) {
+        throw std::runtime_error("Could not write the model");
+    }
+}
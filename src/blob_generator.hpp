@@ -12,11 +12,254 @@
 
 #pragma once
 
+#include <algorithm>
+#include <charconv>
+#include <cmath>
+#include <fstream>
 #include <iostream>
-#include <random>
+#include <numbers>
+#include <stdexcept>
+#include <string>
 #include <vector>
 
-#include "kmeans.hpp"
+#include "binary_dataset.hpp"
+#include "dataset.hpp"
+#include "random.hpp"
+#include "stream.hpp"
+#include "thread_pool.hpp"
+
+/**
+ * @brief Distributions of the points of a blob around its center
+ */
+enum class BlobShape {
+    Uniform,  // uniform in the cube of half-side radius around the center
+    Gaussian  // normal with standard deviation radius in every dimension
+};
+
+/**
+ * @brief Options of generateBlob
+ */
+struct BlobOptions {
+    uint64_t seed = 0;        // the same seed always gives the same dataset
+    uint64_t numThreads = 1;  // threads that generate and format the points
+    BlobShape shape = BlobShape::Uniform;  // distribution around the centers
+    double spread = 1;  // the radii of the clusters are spread log-uniformly
+                        // between radius / spread and radius * spread
+    double imbalance = 1;  // ratio of the expected number of points of the
+                           // largest cluster to that of the smallest one
+    bool binary = false;  // write the binary format instead of the text one
+    Precision precision = Precision::Float64;  // coordinates of the binary
+                                               // format
+};
+
+/**
+ * @brief The clusters of a blob dataset and the points drawn from them. Every
+ * random number is a counter-based function of the seed and of the index of
+ * what it draws (see counterUniform), so any point can be generated on its
+ * own and the dataset does not depend on the number of threads.
+ */
+class BlobGenerator {
+   public:
+    uint64_t numDims;      // number of dimensions
+    uint64_t numClusters;  // number of clusters
+    BlobShape shape;       // distribution around the centers
+    Dataset centers;       // center of every cluster, uniform in [0, 1)
+    std::vector<double> radii;       // radius of every cluster
+    std::vector<double> cumulative;  // cumulative probability of the clusters
+
+    /**
+     * @brief Draw the clusters
+     *
+     * @param n Number of dimensions
+     * @param k Number of clusters
+     * @param radius Radius of the blobs
+     * @param options The options (seed, shape, spread and imbalance)
+     */
+    BlobGenerator(uint64_t n, uint64_t k, double radius,
+                  const BlobOptions &options) {
+        if (k == 0) {
+            throw std::runtime_error(
+                "The number of clusters should be at least 1");
+        }
+        if (options.spread < 1 || options.imbalance < 1) {
+            throw std::runtime_error(
+                "The spread and the imbalance should be at least 1");
+        }
+        this->numDims = n;
+        this->numClusters = k;
+        this->shape = options.shape;
+        uint64_t key = splitMix64(options.seed);
+        centerKey = splitMix64(key + 1);
+        clusterKey = splitMix64(key + 2);
+        pointKey = splitMix64(key + 3);
+        uint64_t radiusKey = splitMix64(key + 4);
+
+        centers = Dataset(k, n);
+        for (uint64_t i = 0; i < k * n; i++) {
+            centers.coordinates[i] = counterUniform(centerKey, i);
+        }
+        radii.resize(k);
+        double logSpread = std::log(options.spread);
+        for (uint64_t c = 0; c < k; c++) {
+            radii[c] = radius * std::exp(logSpread *
+                                         (2 * counterUniform(radiusKey, c) - 1));
+        }
+
+        // Geometric weights from 1 down to 1 / imbalance
+        cumulative.resize(k);
+        double total = 0;
+        for (uint64_t c = 0; c < k; c++) {
+            double position = k > 1 ? double(c) / double(k - 1) : 0;
+            total += std::pow(options.imbalance, -position);
+            cumulative[c] = total;
+        }
+        for (double &probability : cumulative) {
+            probability /= total;
+        }
+    }
+
+    /**
+     * @brief Generate one point
+     *
+     * @param i Index of the point
+     * @param point Receives the numDims coordinates
+     */
+    void generate(uint64_t i, double *point) const {
+        double u = counterUniform(clusterKey, i);
+        uint64_t cluster = std::min<uint64_t>(
+            uint64_t(std::upper_bound(cumulative.begin(), cumulative.end(), u) -
+                     cumulative.begin()),
+            numClusters - 1);
+        const double *center = centers.row(cluster);
+        double radius = radii[cluster];
+        for (uint64_t j = 0; j < numDims; j++) {
+            uint64_t counter = 2 * (i * numDims + j);
+            double offset;
+            if (shape == BlobShape::Gaussian) {
+                // Box-Muller; 1 - u is in (0, 1], so the log is finite
+                double u1 = 1 - counterUniform(pointKey, counter);
+                double u2 = counterUniform(pointKey, counter + 1);
+                offset = std::sqrt(-2 * std::log(u1)) *
+                         std::cos(2 * std::numbers::pi * u2);
+            } else {
+                offset = 2 * counterUniform(pointKey, counter) - 1;
+            }
+            point[j] = center[j] + offset * radius;
+        }
+    }
+
+   private:
+    uint64_t centerKey;   // key of the coordinates of the centers
+    uint64_t clusterKey;  // key of the cluster of every point
+    uint64_t pointKey;    // key of the coordinates of the points
+};
+
+/**
+ * @brief Number of points generated by one task of generateBlob
+ */
+inline constexpr uint64_t blobBlockSize = 16384;
+
+/**
+ * @brief Generate the points in blocks in parallel and hand the blocks to a
+ * writer in order. A wave of a few blocks per thread is generated at a time,
+ * so the memory does not grow with the number of points.
+ *
+ * @param numPoints Number of points
+ * @param pool The threads that generate the blocks
+ * @param generateBlock Called as generateBlock(slot, begin, end) to generate
+ * the points [begin, end) into the buffer of slot; may run in parallel
+ * @param writeBlock Called as writeBlock(slot) in the order of the blocks
+ */
+template <typename Generate, typename Write>
+void forEachBlobBlock(uint64_t numPoints, ThreadPool &pool,
+                      const Generate &generateBlock, const Write &writeBlock) {
+    uint64_t numBlocks = (numPoints + blobBlockSize - 1) / blobBlockSize;
+    uint64_t waveSize = 4 * pool.size();
+    for (uint64_t first = 0; first < numBlocks; first += waveSize) {
+        uint64_t count = std::min(waveSize, numBlocks - first);
+        pool.parallelFor(count, [&](uint64_t slot) {
+            uint64_t begin = (first + slot) * blobBlockSize;
+            generateBlock(slot, begin,
+                          std::min(numPoints, begin + blobBlockSize));
+        });
+        for (uint64_t slot = 0; slot < count; slot++) {
+            writeBlock(slot);
+        }
+    }
+}
+
+/**
+ * @brief Write the generated points in the binary format, with coordinates of
+ * type Scalar
+ *
+ */
+template <typename Scalar>
+void writeBinaryBlob(std::ofstream &file, const BlobGenerator &generator,
+                     uint64_t numPoints, ThreadPool &pool) {
+    uint64_t numDims = generator.numDims;
+    writeBinaryDatasetHeader(
+        file, makeBinaryDatasetHeader<Scalar>(numPoints, numDims));
+    std::vector<std::vector<Scalar>> buffers(4 * pool.size());
+    std::vector<uint64_t> sizes(buffers.size());
+    forEachBlobBlock(
+        numPoints, pool,
+        [&](uint64_t slot, uint64_t begin, uint64_t end) {
+            std::vector<Scalar> &buffer = buffers[slot];
+            buffer.resize(blobBlockSize * numDims);
+            std::vector<double> point(numDims);
+            for (uint64_t i = begin; i < end; i++) {
+                generator.generate(i, point.data());
+                for (uint64_t j = 0; j < numDims; j++) {
+                    buffer[(i - begin) * numDims + j] = Scalar(point[j]);
+                }
+            }
+            sizes[slot] = (end - begin) * numDims;
+        },
+        [&](uint64_t slot) {
+            file.write(reinterpret_cast<const char *>(buffers[slot].data()),
+                       std::streamsize(sizes[slot] * sizeof(Scalar)));
+        });
+}
+
+/**
+ * @brief Write the generated points in the text format, with the coordinates
+ * written like an ostream with the default precision writes them
+ *
+ */
+inline void writeTextBlob(std::ofstream &file, const BlobGenerator &generator,
+                          uint64_t numPoints, ThreadPool &pool) {
+    uint64_t numDims = generator.numDims;
+
+    // First line contains the number of points in the dataset, and the
+    // second line the number of dimensions
+    file << numPoints << '\n' << numDims << '\n';
+
+    std::vector<std::string> buffers(4 * pool.size());
+    forEachBlobBlock(
+        numPoints, pool,
+        [&](uint64_t slot, uint64_t begin, uint64_t end) {
+            std::string &buffer = buffers[slot];
+            buffer.clear();
+            std::vector<double> point(numDims);
+            char number[32];
+            for (uint64_t i = begin; i < end; i++) {
+                generator.generate(i, point.data());
+                for (uint64_t j = 0; j < numDims; j++) {
+                    char *last = std::to_chars(number, number + sizeof(number),
+                                               point[j],
+                                               std::chars_format::general, 6)
+                                     .ptr;
+                    buffer.append(number, last);
+                    buffer += ' ';
+                }
+                buffer += '\n';
+            }
+        },
+        [&](uint64_t slot) {
+            file.write(buffers[slot].data(),
+                       std::streamsize(buffers[slot].size()));
+        });
+}
 
 /**
  * @brief Generate a blob of points and save in a file
@@ -28,57 +271,30 @@
  * @param radius Radius of the blob - the points will be generated around the
  * centroids. The radius is the distance between the centroid and the points in
  * the blob. The smaller the radius, the more dense the blob will be.
+ * @param options The seed, the number of threads, the distribution of the
+ * clusters and the format of the file. The file is the same for any number of
+ * threads.
  */
-void generateBlob(char *fileName, uint64_t numPoints, uint64_t numDimensions,
-                  uint64_t numClusters, double radius) {
-    // Initialize the random number generator
-    std::random_device rd;
-    std::mt19937 gen(rd());
+inline void generateBlob(char *fileName, uint64_t numPoints,
+                         uint64_t numDimensions, uint64_t numClusters,
+                         double radius,
+                         const BlobOptions &options = BlobOptions()) {
+    BlobGenerator generator(numDimensions, numClusters, radius, options);
+    ThreadPool pool(options.numThreads);
 
-    std::ofstream file(fileName);
+    std::ofstream file(fileName, options.binary ? std::ios::binary
+                                                : std::ios::out);
     if (!file.is_open()) {
         throw std::runtime_error("Could not open file");
     }
-
-    // First line contains the number of points in the dataset
-    file << numPoints << std::endl;
-
-    // Second line contains the number of dimensions
-    file << numDimensions << std::endl;
-
-    // Initialize the centroids
-    std::vector<Point> centroids(numClusters);
-    for (uint64_t i = 0; i < numClusters; i++) {
-        centroids[i] = Point(numDimensions);
-        for (uint64_t j = 0; j < numDimensions; j++) {
-            // Generate a random number between 0 and 1
-            centroids[i].coordinates[j] = (double)gen() / gen.max();
-        }
+    if (!options.binary) {
+        writeTextBlob(file, generator, numPoints, pool);
+    } else if (options.precision == Precision::Float32) {
+        writeBinaryBlob<float>(file, generator, numPoints, pool);
+    } else {
+        writeBinaryBlob<double>(file, generator, numPoints, pool);
     }
-
-    // Generate the points
-    for (uint64_t i = 0; i < numPoints; i++) {
-        // Choose a random centroid
-        uint64_t centroidIndex = uint64_t(rand()) % numClusters;
-
-        // Generate a random point around the centroid
-        Point point(numDimensions);
-        for (uint64_t j = 0; j < numDimensions; j++) {
-            // Generate a random number between -1 and 1
-            double random = (double)gen() / gen.max() * 2 - 1;
-
-            // Multiply the random number by the radius and add it to the
-            // centroid
-            point.coordinates[j] =
-                centroids[centroidIndex].coordinates[j] + random * radius;
-        }
-
-        // Write the point to the file
-        for (uint64_t j = 0; j < numDimensions; j++) {
-            file << point.coordinates[j] << " ";
-        }
-        file << std::endl;
+    if (!file) {
+        throw std::runtime_error("Could not write the dataset");
     }
-
-    file.close();
-}
\ No newline at end of file
+}
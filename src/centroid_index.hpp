@@ -0,0 +1,284 @@
+/**
+ * @file centroid_index.hpp
+ * @author Reza Namazi (namazir@mcmaster.ca)
+ * @brief A header file for the inverted file index that finds the nearest
+ * centroid of a point without scanning all the centroids
+ * @version 1.0
+ * @date 2026-10-16
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <limits>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "dataset.hpp"
+#include "distance.hpp"
+#include "random.hpp"
+
+/**
+ * @brief An inverted file (IVF) index over the centroids of a model, for
+ * prediction with a very large number of clusters.
+ *
+ * The centroids are grouped into lists by a coarse quantizer: every list has a
+ * coarse centroid, and every centroid belongs to the list of its nearest
+ * coarse centroid. The nearest centroid of a point is searched among the
+ * centroids of the probes lists whose coarse centroids are nearest to the
+ * point, so a search computes numLists + about probes * numClusters /
+ * numLists distances instead of numClusters. More probes find the exact
+ * nearest centroid more often; probing every list is exact (except that a tie
+ * between centroids of different lists goes to the list probed first).
+ *
+ * The centroids of every list are copied next to each other so that a list is
+ * scanned with the nearest centroid kernel. A saved index records a
+ * fingerprint of the centroids it was built for, so that an index left next
+ * to a model that has changed since is not used.
+ */
+template <typename Scalar>
+class CentroidIndex {
+   public:
+    using Dataset = BasicDataset<Scalar>;
+
+    uint64_t numLists = 0;     // number of lists (coarse centroids)
+    uint64_t numClusters = 0;  // number of centroids of the model
+    uint64_t numDims = 0;      // number of dimensions
+    uint64_t probes = 8;       // number of lists searched for a point
+    Dataset coarseCentroids;   // coarse centroid of every list
+    std::vector<uint64_t> listStart;  // first position of every list
+    std::vector<uint64_t> members;    // centroid at every position
+    Dataset listCentroids;  // centroids in list order (row p is members[p])
+    DistanceKernel<Scalar> kernel;  // distance kernels selected for numDims
+    uint64_t fingerprint = 0;  // fingerprint of the centroids (see
+                               // centroidFingerprint)
+
+    /**
+     * @brief Fingerprint of centroids: every coordinate, as a double, is
+     * mixed into the state with splitMix64
+     *
+     * @param centroids The centroids
+     * @return The fingerprint
+     */
+    static uint64_t centroidFingerprint(const Dataset &centroids) {
+        uint64_t state = splitMix64(centroids.numPoints ^
+                                    splitMix64(centroids.numDims));
+        for (uint64_t i = 0; i < centroids.numPoints * centroids.numDims; i++) {
+            double coordinate = centroids.coordinates[i];
+            uint64_t word;
+            std::memcpy(&word, &coordinate, sizeof(word));
+            state = splitMix64(state ^ word);
+        }
+        return state;
+    }
+
+    /**
+     * @brief Build the index from the coarse quantization of the centroids
+     *
+     * @param centroids The centroids of the model
+     * @param coarse The coarse centroids
+     * @param lists The list (nearest coarse centroid) of every centroid.
+     * Lists without centroids are dropped.
+     */
+    void build(const Dataset &centroids, const Dataset &coarse,
+               const std::vector<uint64_t> &lists) {
+        numClusters = centroids.numPoints;
+        numDims = centroids.numDims;
+        kernel = selectDistanceKernel<Scalar>(numDims);
+        fingerprint = centroidFingerprint(centroids);
+
+        // Drop the empty lists, whose coarse centroids are not meaningful
+        std::vector<uint64_t> counts(coarse.numPoints, 0);
+        for (uint64_t i = 0; i < numClusters; i++) {
+            counts[lists[i]]++;
+        }
+        std::vector<uint64_t> renumbered(coarse.numPoints);
+        numLists = 0;
+        for (uint64_t l = 0; l < coarse.numPoints; l++) {
+            renumbered[l] = numLists;
+            numLists += counts[l] > 0;
+        }
+        coarseCentroids = Dataset(numLists, numDims);
+        for (uint64_t l = 0; l < coarse.numPoints; l++) {
+            if (counts[l] > 0) {
+                std::copy(coarse.row(l), coarse.row(l) + numDims,
+                          coarseCentroids.row(renumbered[l]));
+            }
+        }
+
+        // Counting sort of the centroids by list
+        listStart.assign(numLists + 1, 0);
+        for (uint64_t i = 0; i < numClusters; i++) {
+            listStart[renumbered[lists[i]] + 1]++;
+        }
+        for (uint64_t l = 0; l < numLists; l++) {
+            listStart[l + 1] += listStart[l];
+        }
+        members.resize(numClusters);
+        std::vector<uint64_t> next(listStart.begin(), listStart.end() - 1);
+        for (uint64_t i = 0; i < numClusters; i++) {
+            members[next[renumbered[lists[i]]]++] = i;
+        }
+        packCentroids(centroids);
+    }
+
+    /**
+     * @brief Find the nearest centroid of a point among the lists of the
+     * probes nearest coarse centroids. Safe to call from several threads.
+     *
+     * @param point The coordinates of the point
+     * @param minDistance Receives the squared distance to the centroid found
+     * if it is smaller than the value passed in
+     * @return Index of the centroid in the model (0 if none is nearer than
+     * minDistance)
+     */
+    uint64_t nearest(const Scalar *point, double &minDistance) const {
+        // Reused by every search of the thread, so that a search does not
+        // allocate
+        thread_local std::vector<std::pair<double, uint64_t>> nearestLists;
+        nearestLists.resize(numLists);
+        for (uint64_t l = 0; l < numLists; l++) {
+            nearestLists[l] = {
+                kernel.squaredDistance(point, coarseCentroids.row(l), numDims),
+                l};
+        }
+        uint64_t numProbes = std::min(std::max<uint64_t>(probes, 1), numLists);
+        std::nth_element(nearestLists.begin(),
+                         nearestLists.begin() + long(numProbes - 1),
+                         nearestLists.end());
+
+        uint64_t best = 0;
+        for (uint64_t p = 0; p < numProbes; p++) {
+            uint64_t list = nearestLists[p].second;
+            uint64_t start = listStart[list];
+            uint64_t count = listStart[list + 1] - start;
+            double distance = minDistance;
+            uint64_t position = start + kernel.nearestCentroid(
+                                            point, listCentroids.row(start),
+                                            count, numDims, distance);
+            if (distance < minDistance) {
+                minDistance = distance;
+                best = members[position];
+            }
+        }
+        return best;
+    }
+
+    /**
+     * @brief Save the index to a file
+     *
+     * @param filename The name of the file to save the index to
+     */
+    void save(const std::string &filename) const {
+        std::ofstream file(filename);
+        if (!file.is_open()) {
+            throw std::runtime_error("Could not open the file");
+        }
+        writePrecisionHeader(file, precisionOf<Scalar>);
+        file << "# index ivf\n";
+        file << "# centroids " << fingerprint << '\n';
+        file << numLists << " " << numClusters << " " << numDims << '\n';
+        // The coarse centroids, then the members of every list
+        file.precision(std::numeric_limits<Scalar>::max_digits10);
+        for (uint64_t l = 0; l < numLists; l++) {
+            const Scalar *coarse = coarseCentroids.row(l);
+            for (uint64_t j = 0; j < numDims; j++) {
+                file << coarse[j] << " ";
+            }
+            file << '\n';
+        }
+        for (uint64_t l = 0; l < numLists; l++) {
+            file << listStart[l + 1] - listStart[l];
+            for (uint64_t p = listStart[l]; p < listStart[l + 1]; p++) {
+                file << " " << members[p];
+            }
+            file << '\n';
+        }
+    }
+
+    /**
+     * @brief Load an index saved by save
+     *
+     * @param filename The name of the file to load the index from
+     * @param centroids The centroids of the model
+     * @return Whether the index was built for these centroids. If not (or it
+     * records no fingerprint), nothing else is read and the index should be
+     * built again.
+     */
+    bool load(const std::string &filename, const Dataset &centroids) {
+        std::ifstream file(filename);
+        if (!file.is_open()) {
+            throw std::runtime_error("Could not open the file");
+        }
+        // The precision line, the kind of index and the fingerprint
+        bool fingerprinted = false;
+        while ((file >> std::ws).peek() == '#') {
+            std::string line;
+            std::getline(file, line);
+            std::string::size_type name = line.find("centroids ");
+            if (name != std::string::npos) {
+                fingerprint = std::stoull(line.substr(name + 10));
+                fingerprinted = true;
+            }
+        }
+        if (!fingerprinted || fingerprint != centroidFingerprint(centroids)) {
+            return false;
+        }
+        if (!(file >> numLists >> numClusters >> numDims)) {
+            throw std::runtime_error("Could not read the index");
+        }
+        if (numClusters != centroids.numPoints ||
+            numDims != centroids.numDims || numLists == 0) {
+            throw std::runtime_error("The index does not match the model");
+        }
+        kernel = selectDistanceKernel<Scalar>(numDims);
+        coarseCentroids = Dataset(numLists, numDims);
+        for (uint64_t i = 0; i < numLists * numDims; i++) {
+            if (!(file >> coarseCentroids.coordinates[i])) {
+                throw std::runtime_error("Could not read the index");
+            }
+        }
+        listStart.assign(numLists + 1, 0);
+        members.clear();
+        for (uint64_t l = 0; l < numLists; l++) {
+            uint64_t count;
+            if (!(file >> count)) {
+                throw std::runtime_error("Could not read the index");
+            }
+            for (uint64_t m = 0; m < count; m++) {
+                uint64_t member;
+                if (!(file >> member) || member >= numClusters) {
+                    throw std::runtime_error("Could not read the index");
+                }
+                members.push_back(member);
+            }
+            listStart[l + 1] = members.size();
+        }
+        if (members.size() != numClusters) {
+            throw std::runtime_error("The index does not match the model");
+        }
+        packCentroids(centroids);
+        return true;
+    }
+
+   private:
+    /**
+     * @brief Copy the centroids in list order
+     *
+     */
+    void packCentroids(const Dataset &centroids) {
+        listCentroids = Dataset(numClusters, numDims);
+        for (uint64_t p = 0; p < numClusters; p++) {
+            const Scalar *centroid = centroids.row(members[p]);
+            std::copy(centroid, centroid + numDims, listCentroids.row(p));
+        }
+    }
+};
@@ -0,0 +1,267 @@
+/**
+ * @file dataset.hpp
+ * @author Reza Namazi (namazir@mcmaster.ca)
+ * @brief A header file for the contiguous storage of the points in a dataset
+ * @version 1.0
+ * @date 2026-10-16
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <istream>
+#include <memory>
+#include <new>
+#include <ostream>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+/**
+ * @brief Floating-point types that the coordinates can be stored in
+ */
+enum class Precision {
+    Float64,  // double
+    Float32   // float; sums are still accumulated in double
+};
+
+/**
+ * @brief The precision of a scalar type
+ */
+template <typename Scalar>
+inline constexpr Precision precisionOf =
+    std::is_same_v<Scalar, float> ? Precision::Float32 : Precision::Float64;
+
+/**
+ * @brief Name of a precision, as written in files and on the command line
+ *
+ * @param precision The precision
+ * @return "float64" or "float32"
+ */
+inline std::string precisionName(Precision precision) {
+    return precision == Precision::Float32 ? "float32" : "float64";
+}
+
+/**
+ * @brief Parse the name of a precision
+ *
+ * @param name "float64" or "float32"
+ * @return The precision
+ */
+inline Precision parsePrecision(const std::string &name) {
+    if (name == "float64") {
+        return Precision::Float64;
+    }
+    if (name == "float32") {
+        return Precision::Float32;
+    }
+    throw std::runtime_error("Unknown precision " + name);
+}
+
+/**
+ * @brief Write the line that records the precision of a model or prediction
+ * file ("# precision float32")
+ *
+ * @param file The file
+ * @param precision The precision of the model
+ */
+inline void writePrecisionHeader(std::ostream &file, Precision precision) {
+    file << "# precision " << precisionName(precision) << '\n';
+}
+
+/**
+ * @brief Read the comment lines at the start of a model or prediction file
+ *
+ * @param file The file, positioned at its start
+ * @return The precision recorded in the file (files without the line were
+ * written before float32 models existed and are float64)
+ */
+inline Precision readPrecisionHeader(std::istream &file) {
+    Precision precision = Precision::Float64;
+    while ((file >> std::ws).peek() == '#') {
+        std::string line;
+        std::getline(file, line);
+        std::string::size_type name = line.find("precision ");
+        if (name != std::string::npos) {
+            precision = parsePrecision(line.substr(name + 10));
+        }
+    }
+    return precision;
+}
+
+/**
+ * @brief A class to represent a set of points stored in one contiguous buffer
+ *
+ * The coordinates of all points are stored row-major (point i occupies
+ * coordinates[i * numDims, (i + 1) * numDims)) in a single buffer aligned to
+ * Dataset::alignment bytes. The cluster labels are kept in their own array.
+ *
+ * Copying a Dataset is cheap: the copy shares the coordinate buffer with the
+ * original but gets its own labels. Use clone() to get an independent copy of
+ * the coordinates.
+ *
+ * The coordinates are stored as Scalar (double or float); Dataset and
+ * FloatDataset name the two.
+ */
+template <typename Scalar>
+class BasicDataset {
+    static_assert(std::is_same_v<Scalar, double> ||
+                      std::is_same_v<Scalar, float>,
+                  "The coordinates should be double or float");
+
+   public:
+    static constexpr uint64_t alignment = 64;  // alignment of the buffer
+
+    uint64_t numPoints = 0;           // number of points in the dataset
+    uint64_t numDims = 0;             // number of dimensions
+    std::shared_ptr<Scalar> buffer;   // owner of the coordinate buffer
+    Scalar *coordinates = nullptr;    // row-major coordinates of the points
+    std::vector<uint64_t> labels;     // cluster number of each point
+    std::shared_ptr<Scalar> columns;  // lazily built column-major copy
+
+    /**
+     * @brief Construct a new empty Dataset object
+     *
+     */
+    BasicDataset() {}
+
+    /**
+     * @brief Construct a new Dataset object with zero-initialized coordinates
+     *
+     * @param n The number of points in the dataset
+     * @param d The number of dimensions (coordinates) that each point has
+     */
+    BasicDataset(uint64_t n, uint64_t d) {
+        this->numPoints = n;
+        this->numDims = d;
+        this->buffer = allocate(n * d);
+        this->coordinates = buffer.get();
+        for (uint64_t i = 0; i < n * d; i++) {
+            coordinates[i] = 0;
+        }
+    }
+
+    /**
+     * @brief Construct a new Dataset object over coordinates that are already
+     * in memory (e.g. a memory-mapped file), without copying them
+     *
+     * @param n The number of points in the dataset
+     * @param d The number of dimensions (coordinates) that each point has
+     * @param storage Shared owner of the row-major coordinates; the memory is
+     * released when the last dataset using it is destroyed
+     */
+    BasicDataset(uint64_t n, uint64_t d, std::shared_ptr<Scalar> storage) {
+        this->numPoints = n;
+        this->numDims = d;
+        this->buffer = storage;
+        this->coordinates = buffer.get();
+    }
+
+    /**
+     * @brief Get the coordinates of a point
+     *
+     * @param i Index of the point
+     * @return Pointer to the numDims coordinates of the point
+     */
+    Scalar *row(uint64_t i) { return coordinates + i * numDims; }
+    const Scalar *row(uint64_t i) const { return coordinates + i * numDims; }
+
+    /**
+     * @brief Make a copy of the dataset that does not share the coordinate
+     * buffer with this one
+     *
+     * @return The copy of the dataset
+     */
+    BasicDataset clone() const {
+        BasicDataset copy(numPoints, numDims);
+        for (uint64_t i = 0; i < numPoints * numDims; i++) {
+            copy.coordinates[i] = coordinates[i];
+        }
+        copy.labels = labels;
+        return copy;
+    }
+
+    /**
+     * @brief Get a column-major view of the coordinates. The view is built on
+     * the first call and has to be rebuilt with invalidateColumns() if the
+     * coordinates change afterwards.
+     *
+     * @return Pointer to the coordinates stored column-major (dimension j of
+     * point i is at [j * numPoints + i])
+     */
+    const Scalar *columnMajor() {
+        if (!columns) {
+            columns = allocate(numPoints * numDims);
+            for (uint64_t i = 0; i < numPoints; i++) {
+                for (uint64_t j = 0; j < numDims; j++) {
+                    columns.get()[j * numPoints + i] = coordinates[i * numDims + j];
+                }
+            }
+        }
+        return columns.get();
+    }
+
+    /**
+     * @brief Get one dimension of all points from the column-major view
+     *
+     * @param j Index of the dimension
+     * @return Pointer to the numPoints values of the dimension
+     */
+    const Scalar *column(uint64_t j) { return columnMajor() + j * numPoints; }
+
+    /**
+     * @brief Drop the column-major view so that it is rebuilt on next use
+     *
+     */
+    void invalidateColumns() { columns.reset(); }
+
+    /**
+     * @brief Number of bytes used by the dataset (coordinates, labels and the
+     * column-major view if it was built)
+     *
+     * @return The memory used by the dataset in bytes
+     */
+    uint64_t memoryUsage() const {
+        uint64_t bytes = paddedSize(numPoints * numDims);
+        if (columns) {
+            bytes += paddedSize(numPoints * numDims);
+        }
+        return bytes + labels.capacity() * sizeof(uint64_t);
+    }
+
+   private:
+    /**
+     * @brief Size in bytes of an aligned buffer holding count scalars
+     *
+     */
+    static uint64_t paddedSize(uint64_t count) {
+        uint64_t bytes = count * sizeof(Scalar);
+        return (bytes + alignment - 1) / alignment * alignment;
+    }
+
+    /**
+     * @brief Allocate an aligned buffer of scalars
+     *
+     * @param count The number of scalars in the buffer
+     * @return The shared owner of the buffer
+     */
+    static std::shared_ptr<Scalar> allocate(uint64_t count) {
+        // Aligned operator new (rather than std::aligned_alloc) so that the
+        // buffers go through the same allocator as everything else and show
+        // up when it is replaced, e.g. to count allocations
+        void *memory =
+            ::operator new(paddedSize(count), std::align_val_t(alignment));
+        return std::shared_ptr<Scalar>(static_cast<Scalar *>(memory),
+                                       [](Scalar *p) {
+                                           ::operator delete(
+                                               p, std::align_val_t(alignment));
+                                       });
+    }
+};
+
+using Dataset = BasicDataset<double>;
+using FloatDataset = BasicDataset<float>;
@@ -0,0 +1,380 @@
+/**
+ * @file distance.hpp
+ * @author Reza Namazi (namazir@mcmaster.ca)
+ * @brief A header file for the squared Euclidean distance kernels
+ * @version 1.0
+ * @date 2026-10-16
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+
+#pragma once
+
+#include <cstdint>
+
+// The AVX2 and AVX-512 kernels are compiled with function-level target
+// attributes, so the program runs on any x86-64 CPU and picks the widest
+// instruction set that the CPU supports at runtime
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+#define KMEANS_X86_SIMD 1
+#include <immintrin.h>
+#define KMEANS_TARGET_AVX2 __attribute__((target("avx2,fma")))
+#define KMEANS_TARGET_AVX512 __attribute__((target("avx512f,avx2,fma")))
+#else
+#define KMEANS_X86_SIMD 0
+#endif
+
+/**
+ * @brief Instruction sets that the distance kernels can use
+ */
+enum class SimdLevel { Scalar, Avx2, Avx512 };
+
+/**
+ * @brief Compute the squared Euclidean distance between two points. The
+ * arithmetic is done in Scalar; the result is returned as a double.
+ */
+template <typename Scalar>
+using SquaredDistanceFunction = double (*)(const Scalar *a, const Scalar *b,
+                                           uint64_t numDims);
+
+/**
+ * @brief Find the nearest centroid of a point. minDistance holds the distance
+ * to beat on entry and the squared distance to the returned centroid on exit;
+ * 0 is returned if no centroid is closer than the distance to beat.
+ */
+template <typename Scalar>
+using NearestCentroidFunction = uint64_t (*)(const Scalar *point,
+                                             const Scalar *centroids,
+                                             uint64_t numClusters,
+                                             uint64_t numDims,
+                                             double &minDistance);
+
+/**
+ * @brief The pair of kernels used for a given number of dimensions
+ */
+template <typename Scalar = double>
+struct DistanceKernel {
+    SquaredDistanceFunction<Scalar> squaredDistance = nullptr;
+    NearestCentroidFunction<Scalar> nearestCentroid = nullptr;
+};
+
+/**
+ * @brief Portable squared distance. D is the number of dimensions when it is
+ * known at compile time (so that the loop is fully unrolled) and 0 otherwise.
+ *
+ */
+template <typename Scalar, uint64_t D>
+inline double squaredDistanceScalar(const Scalar *a, const Scalar *b,
+                                    uint64_t numDims) {
+    const uint64_t n = D ? D : numDims;
+    Scalar distance = 0;
+    for (uint64_t j = 0; j < n; j++) {
+        Scalar _distance = a[j] - b[j];
+        distance += _distance * _distance;
+    }
+    return double(distance);
+}
+
+/**
+ * @brief Portable nearest centroid search
+ *
+ */
+template <typename Scalar, uint64_t D>
+uint64_t nearestCentroidScalar(const Scalar *point, const Scalar *centroids,
+                               uint64_t numClusters, uint64_t numDims,
+                               double &minDistance) {
+    const uint64_t n = D ? D : numDims;
+    uint64_t cluster = 0;
+    for (uint64_t i = 0; i < numClusters; i++) {
+        double distance =
+            squaredDistanceScalar<Scalar, D>(point, centroids + i * n, n);
+        if (distance < minDistance) {
+            minDistance = distance;
+            cluster = i;
+        }
+    }
+    return cluster;
+}
+
+#if KMEANS_X86_SIMD
+
+/**
+ * @brief Squared distance using 256-bit vectors of 4 doubles
+ *
+ */
+template <uint64_t D>
+KMEANS_TARGET_AVX2 inline double squaredDistanceAvx2(const double *a,
+                                                     const double *b,
+                                                     uint64_t numDims) {
+    const uint64_t n = D ? D : numDims;
+    __m256d sum0 = _mm256_setzero_pd();
+    __m256d sum1 = _mm256_setzero_pd();
+    uint64_t j = 0;
+    for (; j + 8 <= n; j += 8) {
+        __m256d d0 = _mm256_sub_pd(_mm256_loadu_pd(a + j), _mm256_loadu_pd(b + j));
+        __m256d d1 = _mm256_sub_pd(_mm256_loadu_pd(a + j + 4),
+                                   _mm256_loadu_pd(b + j + 4));
+        sum0 = _mm256_fmadd_pd(d0, d0, sum0);
+        sum1 = _mm256_fmadd_pd(d1, d1, sum1);
+    }
+    if (j + 4 <= n) {
+        __m256d d0 = _mm256_sub_pd(_mm256_loadu_pd(a + j), _mm256_loadu_pd(b + j));
+        sum0 = _mm256_fmadd_pd(d0, d0, sum0);
+        j += 4;
+    }
+    sum0 = _mm256_add_pd(sum0, sum1);
+    __m128d half =
+        _mm_add_pd(_mm256_castpd256_pd128(sum0), _mm256_extractf128_pd(sum0, 1));
+    double distance = _mm_cvtsd_f64(_mm_add_sd(half, _mm_unpackhi_pd(half, half)));
+    for (; j < n; j++) {
+        double _distance = a[j] - b[j];
+        distance += _distance * _distance;
+    }
+    return distance;
+}
+
+/**
+ * @brief Squared distance using 256-bit vectors of 8 floats
+ *
+ */
+template <uint64_t D>
+KMEANS_TARGET_AVX2 inline double squaredDistanceAvx2(const float *a,
+                                                     const float *b,
+                                                     uint64_t numDims) {
+    const uint64_t n = D ? D : numDims;
+    __m256 sum0 = _mm256_setzero_ps();
+    __m256 sum1 = _mm256_setzero_ps();
+    uint64_t j = 0;
+    for (; j + 16 <= n; j += 16) {
+        __m256 d0 = _mm256_sub_ps(_mm256_loadu_ps(a + j), _mm256_loadu_ps(b + j));
+        __m256 d1 = _mm256_sub_ps(_mm256_loadu_ps(a + j + 8),
+                                  _mm256_loadu_ps(b + j + 8));
+        sum0 = _mm256_fmadd_ps(d0, d0, sum0);
+        sum1 = _mm256_fmadd_ps(d1, d1, sum1);
+    }
+    if (j + 8 <= n) {
+        __m256 d0 = _mm256_sub_ps(_mm256_loadu_ps(a + j), _mm256_loadu_ps(b + j));
+        sum0 = _mm256_fmadd_ps(d0, d0, sum0);
+        j += 8;
+    }
+    sum0 = _mm256_add_ps(sum0, sum1);
+    __m128 half =
+        _mm_add_ps(_mm256_castps256_ps128(sum0), _mm256_extractf128_ps(sum0, 1));
+    half = _mm_add_ps(half, _mm_movehl_ps(half, half));
+    float distance = _mm_cvtss_f32(_mm_add_ss(half, _mm_movehdup_ps(half)));
+    for (; j < n; j++) {
+        float _distance = a[j] - b[j];
+        distance += _distance * _distance;
+    }
+    return double(distance);
+}
+
+/**
+ * @brief Nearest centroid search using the AVX2 distance
+ *
+ */
+template <typename Scalar, uint64_t D>
+KMEANS_TARGET_AVX2 uint64_t nearestCentroidAvx2(const Scalar *point,
+                                                const Scalar *centroids,
+                                                uint64_t numClusters,
+                                                uint64_t numDims,
+                                                double &minDistance) {
+    const uint64_t n = D ? D : numDims;
+    uint64_t cluster = 0;
+    for (uint64_t i = 0; i < numClusters; i++) {
+        double distance = squaredDistanceAvx2<D>(point, centroids + i * n, n);
+        if (distance < minDistance) {
+            minDistance = distance;
+            cluster = i;
+        }
+    }
+    return cluster;
+}
+
+/**
+ * @brief Squared distance using 512-bit vectors of 8 doubles; the remainder
+ * is handled with a masked load
+ *
+ */
+template <uint64_t D>
+KMEANS_TARGET_AVX512 inline double squaredDistanceAvx512(const double *a,
+                                                         const double *b,
+                                                         uint64_t numDims) {
+    const uint64_t n = D ? D : numDims;
+    __m512d sum = _mm512_setzero_pd();
+    uint64_t j = 0;
+    for (; j + 8 <= n; j += 8) {
+        __m512d d = _mm512_sub_pd(_mm512_loadu_pd(a + j), _mm512_loadu_pd(b + j));
+        sum = _mm512_fmadd_pd(d, d, sum);
+    }
+    if (j < n) {
+        __mmask8 mask = __mmask8((1u << (n - j)) - 1);
+        __m512d d = _mm512_sub_pd(_mm512_maskz_loadu_pd(mask, a + j),
+                                  _mm512_maskz_loadu_pd(mask, b + j));
+        sum = _mm512_fmadd_pd(d, d, sum);
+    }
+    // The 512-bit reduction intrinsics trip -Wuninitialized in some GCC
+    // versions, so the lanes are added through memory
+    alignas(64) double lanes[8];
+    _mm512_store_pd(lanes, sum);
+    return ((lanes[0] + lanes[4]) + (lanes[1] + lanes[5])) +
+           ((lanes[2] + lanes[6]) + (lanes[3] + lanes[7]));
+}
+
+/**
+ * @brief Squared distance using 512-bit vectors of 16 floats; the remainder
+ * is handled with a masked load
+ *
+ */
+template <uint64_t D>
+KMEANS_TARGET_AVX512 inline double squaredDistanceAvx512(const float *a,
+                                                         const float *b,
+                                                         uint64_t numDims) {
+    const uint64_t n = D ? D : numDims;
+    __m512 sum = _mm512_setzero_ps();
+    uint64_t j = 0;
+    for (; j + 16 <= n; j += 16) {
+        __m512 d = _mm512_sub_ps(_mm512_loadu_ps(a + j), _mm512_loadu_ps(b + j));
+        sum = _mm512_fmadd_ps(d, d, sum);
+    }
+    if (j < n) {
+        __mmask16 mask = __mmask16((1u << (n - j)) - 1);
+        __m512 d = _mm512_sub_ps(_mm512_maskz_loadu_ps(mask, a + j),
+                                 _mm512_maskz_loadu_ps(mask, b + j));
+        sum = _mm512_fmadd_ps(d, d, sum);
+    }
+    alignas(64) float lanes[16];
+    _mm512_store_ps(lanes, sum);
+    float distance = 0;
+    for (uint64_t k = 0; k < 8; k++) {
+        distance += lanes[k] + lanes[k + 8];
+    }
+    return double(distance);
+}
+
+/**
+ * @brief Nearest centroid search using the AVX-512 distance
+ *
+ */
+template <typename Scalar, uint64_t D>
+KMEANS_TARGET_AVX512 uint64_t nearestCentroidAvx512(const Scalar *point,
+                                                    const Scalar *centroids,
+                                                    uint64_t numClusters,
+                                                    uint64_t numDims,
+                                                    double &minDistance) {
+    const uint64_t n = D ? D : numDims;
+    uint64_t cluster = 0;
+    for (uint64_t i = 0; i < numClusters; i++) {
+        double distance = squaredDistanceAvx512<D>(point, centroids + i * n, n);
+        if (distance < minDistance) {
+            minDistance = distance;
+            cluster = i;
+        }
+    }
+    return cluster;
+}
+
+#endif
+
+/**
+ * @brief Detect the widest instruction set supported by the CPU
+ *
+ * @return The instruction set to use for the distance kernels
+ */
+inline SimdLevel detectSimdLevel() {
+#if KMEANS_X86_SIMD
+    static const SimdLevel level = [] {
+        __builtin_cpu_init();
+        if (__builtin_cpu_supports("avx512f")) {
+            return SimdLevel::Avx512;
+        }
+        if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma")) {
+            return SimdLevel::Avx2;
+        }
+        return SimdLevel::Scalar;
+    }();
+    return level;
+#else
+    return SimdLevel::Scalar;
+#endif
+}
+
+/**
+ * @brief Choose the instruction set for a number of dimensions. AVX-512 only
+ * pays off on long rows (at least 512 bytes, e.g. 64 doubles): for short rows
+ * the masked remainder and the wider reduction make it slower than AVX2.
+ *
+ * @param numDims The number of dimensions of the points
+ * @return The instruction set to use
+ */
+template <typename Scalar = double>
+inline SimdLevel preferredSimdLevel(uint64_t numDims) {
+    SimdLevel level = detectSimdLevel();
+    if (level == SimdLevel::Avx512 && numDims * sizeof(Scalar) < 512) {
+        return SimdLevel::Avx2;
+    }
+    return level;
+}
+
+/**
+ * @brief Get the kernels of one instruction set, specialized for the number
+ * of dimensions D (0 for the generic version)
+ *
+ */
+template <typename Scalar, uint64_t D>
+DistanceKernel<Scalar> distanceKernelFor(SimdLevel level) {
+#if KMEANS_X86_SIMD
+    if (level == SimdLevel::Avx512) {
+        return {squaredDistanceAvx512<D>, nearestCentroidAvx512<Scalar, D>};
+    }
+    if (level == SimdLevel::Avx2) {
+        return {squaredDistanceAvx2<D>, nearestCentroidAvx2<Scalar, D>};
+    }
+#else
+    (void)level;
+#endif
+    return {squaredDistanceScalar<Scalar, D>, nearestCentroidScalar<Scalar, D>};
+}
+
+/**
+ * @brief Select the distance kernels for a number of dimensions. Common small
+ * numbers of dimensions get kernels specialized at compile time.
+ *
+ * @param numDims The number of dimensions of the points
+ * @param level The instruction set to use
+ * @return The distance kernels
+ */
+template <typename Scalar = double>
+inline DistanceKernel<Scalar> selectDistanceKernel(uint64_t numDims,
+                                                   SimdLevel level) {
+    switch (numDims) {
+        case 2:
+            return distanceKernelFor<Scalar, 2>(level);
+        case 3:
+            return distanceKernelFor<Scalar, 3>(level);
+        case 4:
+            return distanceKernelFor<Scalar, 4>(level);
+        case 8:
+            return distanceKernelFor<Scalar, 8>(level);
+        case 16:
+            return distanceKernelFor<Scalar, 16>(level);
+        case 32:
+            return distanceKernelFor<Scalar, 32>(level);
+        default:
+            return distanceKernelFor<Scalar, 0>(level);
+    }
+}
+
+/**
+ * @brief Select the distance kernels for a number of dimensions using the
+ * preferred instruction set of the CPU
+ *
+ * @param numDims The number of dimensions of the points
+ * @return The distance kernels
+ */
+template <typename Scalar = double>
+inline DistanceKernel<Scalar> selectDistanceKernel(uint64_t numDims) {
+    return selectDistanceKernel<Scalar>(numDims,
+                                        preferredSimdLevel<Scalar>(numDims));
+}
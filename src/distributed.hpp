@@ -0,0 +1,947 @@
+/**
+ * @file distributed.hpp
+ * @author Reza Namazi (namazir@mcmaster.ca)
+ * @brief A header file for data-parallel training over several processes: a
+ * coordinator owns the centroids and workers own shards of the dataset
+ * @version 1.0
+ * @date 2026-10-16
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <memory>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include "binary_dataset.hpp"
+#include "dataset.hpp"
+#include "kmeans.hpp"
+#include "stream.hpp"
+
+/**
+ * @brief A reliable, ordered byte stream between the coordinator and one
+ * worker. The messages of the protocol are the same over every transport, so
+ * a transport only has to move bytes (e.g. a Unix domain socket between
+ * local processes, or a TCP connection between hosts).
+ */
+class Transport {
+   public:
+    virtual ~Transport() = default;
+
+    /**
+     * @brief Send bytes. Throws if the other side is gone.
+     *
+     */
+    virtual void send(const void *data, uint64_t size) = 0;
+
+    /**
+     * @brief Receive exactly size bytes. Throws if the other side is gone.
+     *
+     */
+    virtual void receive(void *data, uint64_t size) = 0;
+};
+
+/**
+ * @brief A transport over a connected stream socket
+ */
+class SocketTransport : public Transport {
+   public:
+    /**
+     * @brief Construct a new transport that owns a connected socket
+     *
+     * @param socketFd The socket, closed by the destructor
+     */
+    explicit SocketTransport(int socketFd) : fd(socketFd) {}
+
+    SocketTransport(const SocketTransport &) = delete;
+    SocketTransport &operator=(const SocketTransport &) = delete;
+
+    ~SocketTransport() override { close(fd); }
+
+    void send(const void *data, uint64_t size) override {
+        const char *bytes = static_cast<const char *>(data);
+        while (size > 0) {
+            ssize_t count = ::send(fd, bytes, size, MSG_NOSIGNAL);
+            if (count < 0 && errno == EINTR) {
+                continue;
+            }
+            if (count <= 0) {
+                throw std::runtime_error("The connection was lost");
+            }
+            bytes += count;
+            size -= uint64_t(count);
+        }
+    }
+
+    void receive(void *data, uint64_t size) override {
+        char *bytes = static_cast<char *>(data);
+        while (size > 0) {
+            ssize_t count = read(fd, bytes, size);
+            if (count < 0 && errno == EINTR) {
+                continue;
+            }
+            if (count <= 0) {
+                throw std::runtime_error("The connection was lost");
+            }
+            bytes += count;
+            size -= uint64_t(count);
+        }
+    }
+
+   private:
+    int fd;  // the connected socket
+};
+
+/**
+ * @brief Make the address of a Unix domain socket
+ *
+ */
+inline sockaddr_un unixSocketAddress(const std::string &path) {
+    sockaddr_un address{};
+    if (path.size() >= sizeof(address.sun_path)) {
+        throw std::runtime_error("The socket path is too long");
+    }
+    address.sun_family = AF_UNIX;
+    std::memcpy(address.sun_path, path.c_str(), path.size() + 1);
+    return address;
+}
+
+/**
+ * @brief A Unix domain socket that the coordinator listens on for workers. A
+ * stale socket file at the path is replaced, and the file is removed when
+ * the listener is destroyed.
+ */
+class UnixSocketListener {
+   public:
+    /**
+     * @brief Listen on a path
+     *
+     * @param socketPath The path of the socket
+     */
+    explicit UnixSocketListener(const std::string &socketPath)
+        : path(socketPath) {
+        sockaddr_un address = unixSocketAddress(path);
+        struct stat status;
+        if (stat(path.c_str(), &status) == 0 && S_ISSOCK(status.st_mode)) {
+            unlink(path.c_str());
+        }
+        fd = socket(AF_UNIX, SOCK_STREAM, 0);
+        if (fd < 0) {
+            throw std::runtime_error("Could not create the socket");
+        }
+        if (bind(fd, reinterpret_cast<sockaddr *>(&address), sizeof(address)) <
+                0 ||
+            listen(fd, SOMAXCONN) < 0) {
+            close(fd);
+            throw std::runtime_error("Could not listen on " + path);
+        }
+    }
+
+    UnixSocketListener(const UnixSocketListener &) = delete;
+    UnixSocketListener &operator=(const UnixSocketListener &) = delete;
+
+    ~UnixSocketListener() {
+        close(fd);
+        unlink(path.c_str());
+    }
+
+    /**
+     * @brief Wait for the next worker to connect
+     *
+     * @param timeoutSeconds Time after which to give up
+     * @return The transport to the worker, or nullptr if none connected in
+     * time
+     */
+    std::unique_ptr<Transport> accept(double timeoutSeconds) {
+        auto start = std::chrono::steady_clock::now();
+        while (true) {
+            std::chrono::duration<double> waited =
+                std::chrono::steady_clock::now() - start;
+            double remaining = std::max(0.0, timeoutSeconds - waited.count());
+            pollfd listening{fd, POLLIN, 0};
+            int ready = poll(&listening, 1, int(std::ceil(remaining * 1000)));
+            if (ready == 0) {
+                return nullptr;
+            }
+            if (ready > 0) {
+                int client = ::accept(fd, nullptr, nullptr);
+                if (client >= 0) {
+                    return std::make_unique<SocketTransport>(client);
+                }
+            }
+            if (errno != EINTR) {
+                throw std::runtime_error("Could not accept a worker");
+            }
+        }
+    }
+
+   private:
+    std::string path;  // path of the socket
+    int fd;            // the listening socket
+};
+
+/**
+ * @brief Connect to a coordinator listening on a Unix domain socket, retrying
+ * while it is not listening yet
+ *
+ * @param path The path of the socket
+ * @param timeoutSeconds Time after which to give up
+ * @return The transport to the coordinator
+ */
+inline std::unique_ptr<Transport> connectUnixSocket(
+    const std::string &path, double timeoutSeconds = 60) {
+    sockaddr_un address = unixSocketAddress(path);
+    auto start = std::chrono::steady_clock::now();
+    while (true) {
+        int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+        if (fd < 0) {
+            throw std::runtime_error("Could not create the socket");
+        }
+        if (connect(fd, reinterpret_cast<sockaddr *>(&address),
+                    sizeof(address)) == 0) {
+            return std::make_unique<SocketTransport>(fd);
+        }
+        close(fd);
+        std::chrono::duration<double> waited =
+            std::chrono::steady_clock::now() - start;
+        if (waited.count() > timeoutSeconds) {
+            throw std::runtime_error("Could not connect to " + path);
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+}
+
+/**
+ * @brief Messages that the coordinator sends to the workers. Every message
+ * starts with its type; the values that follow are listed with each type.
+ */
+enum class Message : uint64_t {
+    Fetch,    // local indices -> the worker replies with their coordinates
+    Assign,   // centroids, piece boundaries -> counts, sums, farthest
+              // distances and points, and inertia of each piece, then the
+              // number of points that changed cluster
+    Relabel,  // local indices, clusters -> no reply (reseeded points)
+    Stop      // the worker exits
+};
+
+/**
+ * @brief Send a value of a trivially copyable type
+ *
+ */
+template <typename T>
+void sendValue(Transport &transport, const T &value) {
+    transport.send(&value, sizeof(T));
+}
+
+/**
+ * @brief Receive a value of a trivially copyable type
+ *
+ */
+template <typename T>
+T receiveValue(Transport &transport) {
+    T value;
+    transport.receive(&value, sizeof(T));
+    return value;
+}
+
+/**
+ * @brief Send a vector as its size followed by its elements
+ *
+ */
+template <typename T>
+void sendVector(Transport &transport, const std::vector<T> &values) {
+    sendValue<uint64_t>(transport, values.size());
+    transport.send(values.data(), values.size() * sizeof(T));
+}
+
+/**
+ * @brief Receive a vector sent by sendVector, reusing its buffer
+ *
+ */
+template <typename T>
+void receiveVector(Transport &transport, std::vector<T> &values) {
+    values.resize(receiveValue<uint64_t>(transport));
+    transport.receive(values.data(), values.size() * sizeof(T));
+}
+
+/**
+ * @brief What a worker tells the coordinator when it connects
+ */
+struct WorkerHello {
+    uint64_t shardIndex;  // position of the shard in the whole dataset
+    uint64_t numPoints;   // number of points of the shard
+    uint64_t numDims;     // number of dimensions
+    uint64_t precision;   // Precision of the coordinates
+};
+
+/**
+ * @brief A connection to a worker that has described its shard
+ */
+struct WorkerConnection {
+    std::unique_ptr<Transport> transport;  // connection to the worker
+    WorkerHello hello;                     // what the worker sent first
+};
+
+/**
+ * @brief Receive the description of its shard from every worker
+ *
+ * @param transports One transport per worker
+ * @return The connections
+ */
+inline std::vector<WorkerConnection> receiveHellos(
+    std::vector<std::unique_ptr<Transport>> transports) {
+    std::vector<WorkerConnection> connections;
+    for (std::unique_ptr<Transport> &transport : transports) {
+        WorkerHello hello = receiveValue<WorkerHello>(*transport);
+        connections.push_back({std::move(transport), hello});
+    }
+    return connections;
+}
+
+/**
+ * @brief Wait until one worker per shard has connected and described its
+ * shard
+ *
+ * @param listener The socket the workers connect to
+ * @param numShards Number of shards
+ * @param timeoutSeconds Time after which to give up, like the workers do
+ * (see connectUnixSocket)
+ * @return The connections to the workers, in the order they connected
+ */
+inline std::vector<WorkerConnection> acceptWorkers(
+    UnixSocketListener &listener, uint64_t numShards,
+    double timeoutSeconds = 60) {
+    std::vector<WorkerConnection> connections;
+    std::vector<bool> connected(numShards, false);
+    auto start = std::chrono::steady_clock::now();
+    while (connections.size() < numShards) {
+        std::chrono::duration<double> waited =
+            std::chrono::steady_clock::now() - start;
+        std::unique_ptr<Transport> transport =
+            listener.accept(timeoutSeconds - waited.count());
+        if (!transport) {
+            std::string missing;
+            for (uint64_t s = 0; s < numShards; s++) {
+                if (!connected[s]) {
+                    missing += missing.empty() ? "" : ", ";
+                    missing += std::to_string(s);
+                }
+            }
+            throw std::runtime_error(
+                "The workers of these shards did not connect within " +
+                std::to_string(uint64_t(timeoutSeconds)) +
+                " seconds: " + missing);
+        }
+        WorkerHello hello = receiveValue<WorkerHello>(*transport);
+        if (hello.shardIndex >= numShards || connected[hello.shardIndex]) {
+            throw std::runtime_error("The shard indices should be 0 to " +
+                                     std::to_string(numShards - 1) +
+                                     ", each once");
+        }
+        connected[hello.shardIndex] = true;
+        connections.push_back({std::move(transport), hello});
+    }
+    return connections;
+}
+
+/**
+ * @brief Serve a coordinator with the points of one shard until it sends
+ * Stop. For Assign, the worker assigns its points to the centroids it
+ * receives (Lloyd) and replies with the counts, coordinate sums, farthest
+ * points and inertia of every piece of the shard, accumulated in point order
+ * like a partition of single-process training. Relabel moves the points that
+ * the coordinator gave to empty clusters, so that the next Assign counts the
+ * points that changed cluster like single-process training.
+ *
+ * @param transport The connection to the coordinator
+ * @param shardIndex Position of the shard in the whole dataset
+ * @param shard The points of the shard
+ * @param numThreads Number of threads that assign the points
+ */
+template <typename Scalar>
+void runWorker(Transport &transport, uint64_t shardIndex,
+               BasicDataset<Scalar> shard, uint64_t numThreads) {
+    uint64_t numDims = shard.numDims;
+    WorkerHello hello{shardIndex, shard.numPoints, numDims,
+                      uint64_t(precisionOf<Scalar>)};
+    sendValue(transport, hello);
+
+    // The model is made when the number of clusters is known
+    std::unique_ptr<BasicKMeans<Scalar>> model;
+    std::vector<uint64_t> indices;
+    std::vector<uint64_t> clusters;
+    std::vector<Scalar> values;
+    std::vector<uint64_t> boundaries;
+    std::vector<uint64_t> counts;
+    std::vector<double> sums;
+    std::vector<double> pieceInertia;
+    std::vector<double> farthestDistances;
+    std::vector<uint64_t> farthestPoints;
+    while (true) {
+        Message message = receiveValue<Message>(transport);
+        if (message == Message::Stop) {
+            return;
+        }
+        if (message == Message::Fetch) {
+            receiveVector(transport, indices);
+            values.resize(indices.size() * numDims);
+            for (uint64_t i = 0; i < indices.size(); i++) {
+                if (indices[i] >= shard.numPoints) {
+                    throw std::runtime_error("The index is not in the shard");
+                }
+                std::copy(shard.row(indices[i]), shard.row(indices[i]) + numDims,
+                          values.data() + i * numDims);
+            }
+            sendVector(transport, values);
+            continue;
+        }
+        if (message == Message::Relabel) {
+            receiveVector(transport, indices);
+            receiveVector(transport, clusters);
+            for (uint64_t i = 0; i < indices.size(); i++) {
+                if (!model || indices[i] >= shard.numPoints ||
+                    i >= clusters.size() || clusters[i] >= model->numClusters) {
+                    throw std::runtime_error("The relabeled point is wrong");
+                }
+                model->points.labels[indices[i]] = clusters[i];
+            }
+            continue;
+        }
+
+        receiveVector(transport, values);
+        receiveVector(transport, boundaries);
+        uint64_t numClusters = numDims > 0 ? values.size() / numDims : 0;
+        if (!model || model->numClusters != numClusters) {
+            model = std::make_unique<BasicKMeans<Scalar>>(
+                numClusters, numDims, shard.numPoints, shard);
+            model->setNumThreads(numThreads);
+        }
+        std::copy(values.begin(), values.end(), model->centroids.coordinates);
+
+        // Assign and sum up every piece
+        uint64_t numPieces = boundaries.size() - 1;
+        counts.assign(numPieces * numClusters, 0);
+        sums.assign(numPieces * numClusters * numDims, 0);
+        pieceInertia.resize(numPieces);
+        farthestDistances.assign(numPieces * numClusters, -1);
+        farthestPoints.assign(numPieces * numClusters, 0);
+        uint64_t reassigned = 0;
+        model->assignAndAccumulatePieces(boundaries, sums.data(), counts.data(),
+                                         pieceInertia.data(), reassigned,
+                                         farthestDistances.data(),
+                                         farthestPoints.data());
+        sendVector(transport, counts);
+        sendVector(transport, sums);
+        sendVector(transport, farthestDistances);
+        sendVector(transport, farthestPoints);
+        sendVector(transport, pieceInertia);
+        sendValue(transport, reassigned);
+    }
+}
+
+/**
+ * @brief The coordinator of distributed training. It owns the centroids and
+ * runs Lloyd's algorithm over workers that each own a shard of the dataset:
+ * every iteration sends the centroids to the workers, which assign their
+ * points and send back only the sums and counts of their points per cluster.
+ *
+ * The sums are split at the partition boundaries of single-process training
+ * of the whole dataset (see BasicKMeans::numPartitionsFor), and merged in
+ * partition order with the same code, so when every shard starts at a
+ * partition boundary (see writeShards) the model is bitwise identical to the
+ * one trained in a single process from the same initial centroids, with the
+ * same reseeding of empty clusters and stopping criteria. A partition split
+ * between two shards is summed in two pieces, which can change the last
+ * bits.
+ */
+template <typename Scalar>
+class DistributedCoordinator {
+   public:
+    using Dataset = BasicDataset<Scalar>;
+
+    BasicKMeans<Scalar> model;  // the centroids; holds no points
+    uint64_t numPoints = 0;     // number of points of all the shards
+    bool aligned = true;  // whether every shard starts at a partition boundary
+
+    /**
+     * @brief Take the connections to the workers and wait for each of them
+     * to describe its shard
+     *
+     * @param k Number of clusters
+     * @param transports One transport per worker, in any order
+     */
+    DistributedCoordinator(uint64_t k,
+                           std::vector<std::unique_ptr<Transport>> transports)
+        : DistributedCoordinator(k, receiveHellos(std::move(transports))) {}
+
+    /**
+     * @brief Take the connections to the workers, which have described their
+     * shards
+     *
+     * @param k Number of clusters
+     * @param connections One connection per worker, in any order
+     */
+    DistributedCoordinator(uint64_t k,
+                           std::vector<WorkerConnection> connections)
+        : model(k, 0, 0, Dataset()) {
+        if (connections.empty()) {
+            throw std::runtime_error("There should be at least one worker");
+        }
+        workers.resize(connections.size());
+        for (WorkerConnection &connection : connections) {
+            const WorkerHello &hello = connection.hello;
+            if (hello.shardIndex >= workers.size() ||
+                workers[hello.shardIndex].transport) {
+                throw std::runtime_error("The shard indices should be 0 to " +
+                                         std::to_string(workers.size() - 1) +
+                                         ", each once");
+            }
+            if (hello.precision != uint64_t(precisionOf<Scalar>)) {
+                throw std::runtime_error(
+                    "The workers should use the precision of the coordinator");
+            }
+            Worker &worker = workers[hello.shardIndex];
+            worker.transport = std::move(connection.transport);
+            worker.numPoints = hello.numPoints;
+            worker.numDims = hello.numDims;
+        }
+        uint64_t numDims = workers[0].numDims;
+        for (Worker &worker : workers) {
+            if (worker.numDims != numDims) {
+                throw std::runtime_error(
+                    "The shards should have the same number of dimensions");
+            }
+            worker.offset = numPoints;
+            numPoints += worker.numPoints;
+        }
+        if (k > numPoints) {
+            throw std::runtime_error(
+                "The number of clusters should not be greater than the number "
+                "of points");
+        }
+        model = BasicKMeans<Scalar>(k, numDims, 0, Dataset());
+        splitPartitions();
+    }
+
+    DistributedCoordinator(const DistributedCoordinator &) = delete;
+    DistributedCoordinator &operator=(const DistributedCoordinator &) = delete;
+
+    /**
+     * @brief Tell the workers to exit
+     *
+     */
+    ~DistributedCoordinator() {
+        for (Worker &worker : workers) {
+            try {
+                sendValue(*worker.transport, Message::Stop);
+            } catch (const std::exception &) {
+                // The worker is already gone
+            }
+        }
+    }
+
+    /**
+     * @brief Initialize the centroids to distinct random points, the points
+     * BasicKMeans::initializeRandom picks from the whole dataset with the
+     * same seed
+     *
+     * @param seed The seed of the random number generator
+     */
+    void initializeRandom(uint64_t seed) {
+        model.setSeed(seed);
+        std::vector<uint64_t> indices = BasicKMeans<Scalar>::drawDistinctIndices(
+            numPoints, model.numClusters, model.rng);
+
+        // Ask every worker for the points it holds
+        std::vector<std::vector<uint64_t>> local(workers.size());
+        std::vector<std::vector<uint64_t>> clusters(workers.size());
+        for (uint64_t c = 0; c < indices.size(); c++) {
+            uint64_t w = workerOf(indices[c]);
+            local[w].push_back(indices[c] - workers[w].offset);
+            clusters[w].push_back(c);
+        }
+        std::vector<Scalar> values;
+        uint64_t numDims = model.numDims;
+        for (uint64_t w = 0; w < workers.size(); w++) {
+            if (local[w].empty()) {
+                continue;
+            }
+            sendValue(*workers[w].transport, Message::Fetch);
+            sendVector(*workers[w].transport, local[w]);
+            receiveVector(*workers[w].transport, values);
+            for (uint64_t i = 0; i < clusters[w].size(); i++) {
+                std::copy(values.data() + i * numDims,
+                          values.data() + (i + 1) * numDims,
+                          model.centroids.row(clusters[w][i]));
+            }
+        }
+    }
+
+    /**
+     * @brief Run Lloyd's algorithm from the current centroids, like
+     * BasicKMeans::fitFromCentroids: empty clusters are reseeded following
+     * model.emptyClusterPolicy, and model.inertiaTolerance and
+     * model.reassignedTolerance stop the training the same way
+     *
+     * @param maxIterations Maximum number of iterations to run the algorithm
+     * @param threshold The threshold to stop the algorithm - If the change in
+     * the centroids is less than this threshold, the algorithm stops
+     */
+    void fit(uint64_t maxIterations, double threshold) {
+        uint64_t numClusters = model.numClusters;
+        uint64_t numDims = model.numDims;
+        uint64_t size = numClusters * numDims;
+        std::vector<Scalar> centroidValues;
+        std::vector<uint64_t> counts;
+        std::vector<double> sums;
+        std::vector<double> farthestDistances;
+        std::vector<uint64_t> farthestPoints;
+        std::vector<double> pieceInertia;
+        double previousInertia = 0;
+        model.stopReason = StopReason::MaxIterations;
+        uint64_t iteration = 0;
+        while (iteration < maxIterations) {
+            // Every worker assigns its points at the same time
+            centroidValues.assign(model.centroids.coordinates,
+                                  model.centroids.coordinates + size);
+            for (Worker &worker : workers) {
+                sendValue(*worker.transport, Message::Assign);
+                sendVector(*worker.transport, centroidValues);
+                sendVector(*worker.transport, worker.boundaries);
+            }
+
+            // The pieces of all the workers, in the order of the dataset
+            model.partitionSums.clear();
+            model.partitionCounts.clear();
+            model.partitionFarthestDistance.clear();
+            model.partitionFarthestPoint.clear();
+            double inertia = 0;
+            uint64_t reassigned = 0;
+            for (Worker &worker : workers) {
+                receiveVector(*worker.transport, counts);
+                receiveVector(*worker.transport, sums);
+                receiveVector(*worker.transport, farthestDistances);
+                receiveVector(*worker.transport, farthestPoints);
+                receiveVector(*worker.transport, pieceInertia);
+                reassigned += receiveValue<uint64_t>(*worker.transport);
+                uint64_t numPieces = worker.boundaries.size() - 1;
+                if (counts.size() != numPieces * numClusters ||
+                    sums.size() != numPieces * size ||
+                    farthestDistances.size() != numPieces * numClusters ||
+                    farthestPoints.size() != numPieces * numClusters ||
+                    pieceInertia.size() != numPieces) {
+                    throw std::runtime_error("A worker sent a wrong reply");
+                }
+                model.partitionCounts.insert(model.partitionCounts.end(),
+                                             counts.begin(), counts.end());
+                model.partitionSums.insert(model.partitionSums.end(),
+                                           sums.begin(), sums.end());
+                model.partitionFarthestDistance.insert(
+                    model.partitionFarthestDistance.end(),
+                    farthestDistances.begin(), farthestDistances.end());
+                for (uint64_t point : farthestPoints) {
+                    model.partitionFarthestPoint.push_back(worker.offset +
+                                                           point);
+                }
+                for (double value : pieceInertia) {
+                    inertia += value;
+                }
+            }
+
+            model.rememberCentroids();
+            uint64_t pieces = model.partitionCounts.size() / numClusters;
+            model.clusterSums.assign(size, 0);
+            model.clusterCounts.assign(numClusters, 0);
+            model.mergePartitions(pieces, model.clusterSums,
+                                  model.clusterCounts);
+            model.mergeFarthest(pieces);
+            uint64_t reseeded = reseedEmptyClusters();
+            model.divideClusterSums(model.clusterSums, model.clusterCounts,
+                                    model.previousCentroids);
+
+            double maxDistance = 0;
+            for (uint64_t i = 0; i < numClusters; i++) {
+                double distance = model.kernel.squaredDistance(
+                    model.previousCentroids.row(i), model.centroids.row(i),
+                    numDims);
+                if (distance > maxDistance) {
+                    maxDistance = distance;
+                }
+            }
+            model.iterationsRun = iteration + 1;
+            if (maxDistance < threshold) {
+                model.stopReason = StopReason::Threshold;
+                break;
+            }
+            // Stop when the assignment barely improves any more (a reseeded
+            // cluster always gets another iteration)
+            if (iteration > 0 && reseeded == 0) {
+                if (model.inertiaTolerance > 0 &&
+                    previousInertia - inertia <
+                        model.inertiaTolerance * previousInertia) {
+                    model.stopReason = StopReason::InertiaPlateau;
+                    break;
+                }
+                if (model.reassignedTolerance > 0 &&
+                    double(reassigned) <
+                        model.reassignedTolerance * double(numPoints)) {
+                    model.stopReason = StopReason::FewReassigned;
+                    break;
+                }
+            }
+            previousInertia = inertia;
+            iteration++;
+        }
+        model.clusterWeights.assign(model.clusterCounts.begin(),
+                                    model.clusterCounts.end());
+    }
+
+   private:
+    /**
+     * @brief A connected worker and its shard
+     *
+     */
+    struct Worker {
+        std::unique_ptr<Transport> transport;  // connection to the worker
+        uint64_t numPoints = 0;  // number of points of the shard
+        uint64_t numDims = 0;    // number of dimensions of the shard
+        uint64_t offset = 0;     // index of its first point in the dataset
+        std::vector<uint64_t> boundaries;  // local boundaries of its pieces
+    };
+
+    std::vector<Worker> workers;  // the workers, in the order of their shards
+
+    /**
+     * @brief Find the worker that holds a point
+     *
+     * @param point Index of the point in the dataset
+     * @return The position of the worker
+     */
+    uint64_t workerOf(uint64_t point) const {
+        uint64_t w = 0;
+        while (point >= workers[w].offset + workers[w].numPoints) {
+            w++;
+        }
+        return w;
+    }
+
+    /**
+     * @brief Give every empty cluster the farthest point of a donor, like
+     * BasicKMeans::reseedEmptyClusters with the farthest points found by the
+     * workers. The point is fetched from its worker, which is told its new
+     * cluster.
+     *
+     * @return The number of clusters reseeded
+     */
+    uint64_t reseedEmptyClusters() {
+        std::vector<uint64_t> &counts = model.clusterCounts;
+        if (model.emptyClusterPolicy == EmptyClusterPolicy::Keep ||
+            std::find(counts.begin(), counts.end(), 0) == counts.end()) {
+            return 0;
+        }
+        std::vector<bool> gave(model.numClusters, false);
+        std::vector<Scalar> values;
+        uint64_t reseeded = 0;
+        for (uint64_t c = 0; c < model.numClusters; c++) {
+            if (counts[c] != 0) {
+                continue;
+            }
+            uint64_t donor = model.reseedDonor(counts, gave);
+            if (donor == model.numClusters) {
+                break;
+            }
+            gave[donor] = true;
+
+            uint64_t point = model.farthestPoint[donor];
+            Worker &worker = workers[workerOf(point)];
+            std::vector<uint64_t> local = {point - worker.offset};
+            sendValue(*worker.transport, Message::Fetch);
+            sendVector(*worker.transport, local);
+            receiveVector(*worker.transport, values);
+            if (values.size() != model.numDims) {
+                throw std::runtime_error("A worker sent a wrong reply");
+            }
+            model.moveToEmptyCluster(model.clusterSums, counts, donor, c,
+                                     values.data());
+            sendValue(*worker.transport, Message::Relabel);
+            sendVector(*worker.transport, local);
+            sendVector(*worker.transport, std::vector<uint64_t>{c});
+            reseeded++;
+        }
+        return reseeded;
+    }
+
+    /**
+     * @brief Split the shards at the partition boundaries of the whole
+     * dataset
+     *
+     */
+    void splitPartitions() {
+        uint64_t partitions = BasicKMeans<Scalar>::numPartitionsFor(
+            numPoints, model.numClusters, model.numDims);
+        for (Worker &worker : workers) {
+            uint64_t begin = worker.offset;
+            uint64_t end = worker.offset + worker.numPoints;
+            worker.boundaries = {0};
+            bool startsPartition = false;
+            for (uint64_t p = 0; p <= partitions; p++) {
+                uint64_t boundary = p * numPoints / partitions;
+                startsPartition = startsPartition || boundary == begin;
+                if (boundary > begin && boundary < end) {
+                    worker.boundaries.push_back(boundary - begin);
+                }
+            }
+            worker.boundaries.push_back(worker.numPoints);
+            aligned = aligned && (startsPartition || worker.numPoints == 0);
+        }
+    }
+};
+
+/**
+ * @brief Writes the points of a dataset, given in order, to shard files in
+ * the binary format so that every shard starts at a partition boundary of
+ * single-process training (see writeShards)
+ */
+template <typename Scalar>
+class ShardWriter {
+   public:
+    std::vector<std::string> names;  // names of the shard files
+
+    /**
+     * @brief Plan the shards
+     *
+     * @param n Number of points of the dataset
+     * @param d Number of dimensions
+     * @param k Number of clusters the shards will be trained with
+     * @param numShards Number of shards
+     * @param prefix The shards are written to prefix0.kmd, prefix1.kmd, ...
+     */
+    ShardWriter(uint64_t n, uint64_t d, uint64_t k, uint64_t numShards,
+                const std::string &prefix)
+        : numDims(d) {
+        uint64_t partitions = BasicKMeans<Scalar>::numPartitionsFor(n, k, d);
+        if (numShards == 0 || numShards > partitions) {
+            throw std::runtime_error(
+                "The number of shards should be between 1 and the number of "
+                "partitions (" +
+                std::to_string(partitions) + ")");
+        }
+        // Shard s holds the partitions from s * partitions / numShards
+        for (uint64_t s = 0; s <= numShards; s++) {
+            starts.push_back(s * partitions / numShards * n / partitions);
+            if (s < numShards) {
+                names.push_back(prefix + std::to_string(s) + ".kmd");
+            }
+        }
+    }
+
+    /**
+     * @brief Write the next points of the dataset
+     *
+     * @param chunk The points
+     * @param offset Index of the first of them in the dataset
+     */
+    void write(const BasicDataset<Scalar> &chunk, uint64_t offset) {
+        for (uint64_t i = 0; i < chunk.numPoints; i++) {
+            // Open the shards that start here (empty ones are skipped over)
+            while (offset + i == starts[shard + 1] || !file.is_open()) {
+                if (file.is_open()) {
+                    finishShard();
+                    shard++;
+                }
+                file.open(names[shard], std::ios::binary);
+                if (!file.is_open()) {
+                    throw std::runtime_error("Could not open the file");
+                }
+                writeBinaryDatasetHeader(
+                    file, makeBinaryDatasetHeader<Scalar>(
+                              starts[shard + 1] - starts[shard], numDims));
+            }
+            file.write(reinterpret_cast<const char *>(chunk.row(i)),
+                       std::streamsize(numDims * sizeof(Scalar)));
+        }
+    }
+
+    /**
+     * @brief Close the last shard
+     *
+     */
+    void finish() {
+        if (file.is_open()) {
+            finishShard();
+        }
+    }
+
+   private:
+    uint64_t numDims;             // number of dimensions
+    std::vector<uint64_t> starts;  // index of the first point of every shard
+    uint64_t shard = 0;           // shard being written
+    std::ofstream file;           // file of the shard being written
+
+    /**
+     * @brief Close the shard being written
+     *
+     */
+    void finishShard() {
+        file.close();
+        if (!file) {
+            throw std::runtime_error("Could not write the shards");
+        }
+    }
+};
+
+/**
+ * @brief Split a dataset file into shard files in the binary format, with
+ * coordinates of type Scalar, so that every shard starts at a partition
+ * boundary of single-process training with numClusters clusters. Distributed
+ * training over these shards then gives the same model bitwise. A text file
+ * is read in chunks and a binary one is memory-mapped, so the dataset does
+ * not have to fit in memory.
+ *
+ * @param inputFile Name of the dataset
+ * @param numClusters Number of clusters the shards will be trained with
+ * @param numShards Number of shards
+ * @param prefix The shards are written to prefix0.kmd, prefix1.kmd, ...
+ * @return The names of the shard files
+ */
+template <typename Scalar = double>
+std::vector<std::string> writeShards(const std::string &inputFile,
+                                     uint64_t numClusters, uint64_t numShards,
+                                     const std::string &prefix) {
+    if (isBinaryDataset(inputFile)) {
+        BasicDataset<Scalar> points = loadBinaryDataset<Scalar>(inputFile);
+        ShardWriter<Scalar> writer(points.numPoints, points.numDims,
+                                   numClusters, numShards, prefix);
+        writer.write(points, 0);
+        writer.finish();
+        return writer.names;
+    }
+    ChunkReader reader(inputFile, 65536);
+    ShardWriter<Scalar> writer(reader.numPoints, reader.numDims, numClusters,
+                               numShards, prefix);
+    forEachChunk<Scalar>(reader, [&](BasicDataset<Scalar> &chunk,
+                                     uint64_t offset) {
+        writer.write(chunk, offset);
+    });
+    writer.finish();
+    return writer.names;
+}
@@ -0,0 +1,372 @@
+/**
+ * @file gemm.hpp
+ * @author Reza Namazi (namazir@mcmaster.ca)
+ * @brief A header file for the assignment of points to centroids computed as a
+ * blocked matrix product
+ * @version 1.0
+ * @date 2026-10-16
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <iterator>
+#include <limits>
+#include <vector>
+
+#include "distance.hpp"
+
+/**
+ * @brief Compute the dot products of 4 points with the centroids of a packed
+ * slab. rows holds the 4 points, slab the numDims x width transposed
+ * centroids, and dots receives the 4 x width products (row-major).
+ */
+template <typename Scalar>
+using DotTileFunction = void (*)(const Scalar *const *rows, const Scalar *slab,
+                                 uint64_t numDims, Scalar *dots);
+
+/**
+ * @brief Portable dot product tile
+ *
+ */
+template <typename Scalar, uint64_t Width>
+void dotTileScalar(const Scalar *const *rows, const Scalar *slab,
+                   uint64_t numDims, Scalar *dots) {
+    Scalar acc[4][Width] = {};
+    for (uint64_t j = 0; j < numDims; j++) {
+        const Scalar *column = slab + j * Width;
+        for (uint64_t r = 0; r < 4; r++) {
+            Scalar x = rows[r][j];
+            for (uint64_t k = 0; k < Width; k++) {
+                acc[r][k] += x * column[k];
+            }
+        }
+    }
+    for (uint64_t r = 0; r < 4; r++) {
+        for (uint64_t k = 0; k < Width; k++) {
+            dots[r * Width + k] = acc[r][k];
+        }
+    }
+}
+
+#if KMEANS_X86_SIMD
+
+/**
+ * @brief Dot product tile of 4 points by 8 centroids using 256-bit vectors of
+ * 4 doubles: every step broadcasts one coordinate of each point and
+ * multiplies it with the same coordinate of the 8 centroids. The 8
+ * accumulators are spelled out so that they stay in registers.
+ *
+ */
+KMEANS_TARGET_AVX2 inline void dotTileAvx2(const double *const *rows,
+                                           const double *slab,
+                                           uint64_t numDims, double *dots) {
+    const double *row0 = rows[0], *row1 = rows[1], *row2 = rows[2],
+                 *row3 = rows[3];
+    __m256d acc00 = _mm256_setzero_pd(), acc01 = _mm256_setzero_pd();
+    __m256d acc10 = _mm256_setzero_pd(), acc11 = _mm256_setzero_pd();
+    __m256d acc20 = _mm256_setzero_pd(), acc21 = _mm256_setzero_pd();
+    __m256d acc30 = _mm256_setzero_pd(), acc31 = _mm256_setzero_pd();
+    for (uint64_t j = 0; j < numDims; j++) {
+        __m256d c0 = _mm256_loadu_pd(slab + j * 8);
+        __m256d c1 = _mm256_loadu_pd(slab + j * 8 + 4);
+        __m256d x0 = _mm256_broadcast_sd(row0 + j);
+        __m256d x1 = _mm256_broadcast_sd(row1 + j);
+        __m256d x2 = _mm256_broadcast_sd(row2 + j);
+        __m256d x3 = _mm256_broadcast_sd(row3 + j);
+        acc00 = _mm256_fmadd_pd(x0, c0, acc00);
+        acc01 = _mm256_fmadd_pd(x0, c1, acc01);
+        acc10 = _mm256_fmadd_pd(x1, c0, acc10);
+        acc11 = _mm256_fmadd_pd(x1, c1, acc11);
+        acc20 = _mm256_fmadd_pd(x2, c0, acc20);
+        acc21 = _mm256_fmadd_pd(x2, c1, acc21);
+        acc30 = _mm256_fmadd_pd(x3, c0, acc30);
+        acc31 = _mm256_fmadd_pd(x3, c1, acc31);
+    }
+    _mm256_storeu_pd(dots, acc00);
+    _mm256_storeu_pd(dots + 4, acc01);
+    _mm256_storeu_pd(dots + 8, acc10);
+    _mm256_storeu_pd(dots + 12, acc11);
+    _mm256_storeu_pd(dots + 16, acc20);
+    _mm256_storeu_pd(dots + 20, acc21);
+    _mm256_storeu_pd(dots + 24, acc30);
+    _mm256_storeu_pd(dots + 28, acc31);
+}
+
+/**
+ * @brief Dot product tile of 4 points by 16 centroids using 256-bit vectors of
+ * 8 floats
+ *
+ */
+KMEANS_TARGET_AVX2 inline void dotTileAvx2(const float *const *rows,
+                                           const float *slab, uint64_t numDims,
+                                           float *dots) {
+    const float *row0 = rows[0], *row1 = rows[1], *row2 = rows[2],
+                *row3 = rows[3];
+    __m256 acc00 = _mm256_setzero_ps(), acc01 = _mm256_setzero_ps();
+    __m256 acc10 = _mm256_setzero_ps(), acc11 = _mm256_setzero_ps();
+    __m256 acc20 = _mm256_setzero_ps(), acc21 = _mm256_setzero_ps();
+    __m256 acc30 = _mm256_setzero_ps(), acc31 = _mm256_setzero_ps();
+    for (uint64_t j = 0; j < numDims; j++) {
+        __m256 c0 = _mm256_loadu_ps(slab + j * 16);
+        __m256 c1 = _mm256_loadu_ps(slab + j * 16 + 8);
+        __m256 x0 = _mm256_broadcast_ss(row0 + j);
+        __m256 x1 = _mm256_broadcast_ss(row1 + j);
+        __m256 x2 = _mm256_broadcast_ss(row2 + j);
+        __m256 x3 = _mm256_broadcast_ss(row3 + j);
+        acc00 = _mm256_fmadd_ps(x0, c0, acc00);
+        acc01 = _mm256_fmadd_ps(x0, c1, acc01);
+        acc10 = _mm256_fmadd_ps(x1, c0, acc10);
+        acc11 = _mm256_fmadd_ps(x1, c1, acc11);
+        acc20 = _mm256_fmadd_ps(x2, c0, acc20);
+        acc21 = _mm256_fmadd_ps(x2, c1, acc21);
+        acc30 = _mm256_fmadd_ps(x3, c0, acc30);
+        acc31 = _mm256_fmadd_ps(x3, c1, acc31);
+    }
+    _mm256_storeu_ps(dots, acc00);
+    _mm256_storeu_ps(dots + 8, acc01);
+    _mm256_storeu_ps(dots + 16, acc10);
+    _mm256_storeu_ps(dots + 24, acc11);
+    _mm256_storeu_ps(dots + 32, acc20);
+    _mm256_storeu_ps(dots + 40, acc21);
+    _mm256_storeu_ps(dots + 48, acc30);
+    _mm256_storeu_ps(dots + 56, acc31);
+}
+
+#endif
+
+/**
+ * @brief Assign points to their nearest centroid with the expansion
+ * ||x - c||^2 = ||x||^2 - 2 x.c + ||c||^2, where the cross terms of a block of
+ * points against all centroids are a matrix product computed tile by tile.
+ * The nearest and second nearest centroid of each point are tracked inside
+ * the tile loop, so the N x K distance matrix is never stored.
+ *
+ * The expansion loses precision when ||x|| and ||c|| are large compared to
+ * ||x - c||. Whenever the two nearest expanded distances of a point are
+ * closer than the worst-case rounding error of the expansion plus that of the
+ * direct distance (see separated), the point is assigned again with the
+ * direct distance kernel, so the labels are always the ones that the direct
+ * kernel gives.
+ */
+template <typename Scalar>
+class GemmAssigner {
+   public:
+    // Number of centroids in a packed slab (two SIMD vectors)
+    static constexpr uint64_t slabWidth = 64 / sizeof(Scalar);
+    // Number of points that share a pass over the packed centroids
+    static constexpr uint64_t pointBlock = 32;
+    // Number of dimensions multiplied at a time
+    static constexpr uint64_t dimBlock = 64;
+
+    uint64_t numClusters = 0;  // number of centroids
+    uint64_t numDims = 0;      // number of dimensions
+    uint64_t fallbacks = 0;    // points assigned with the direct kernel
+
+    /**
+     * @brief Construct a new assigner
+     *
+     * @param directKernel Kernels used for the points near a tie
+     */
+    GemmAssigner(DistanceKernel<Scalar> directKernel = {})
+        : kernel(directKernel) {
+        tile = dotTileScalar<Scalar, slabWidth>;
+#if KMEANS_X86_SIMD
+        if (detectSimdLevel() != SimdLevel::Scalar) {
+            tile = dotTileAvx2;
+        }
+#endif
+    }
+
+    /**
+     * @brief Compute the squared norm of every row
+     *
+     * @param rows Row-major coordinates
+     * @param numRows Number of rows
+     * @param dims Number of dimensions
+     * @param norms Receives the numRows squared norms
+     */
+    static void squaredNorms(const Scalar *rows, uint64_t numRows,
+                             uint64_t dims, double *norms) {
+        for (uint64_t i = 0; i < numRows; i++) {
+            double norm = 0;
+            for (uint64_t j = 0; j < dims; j++) {
+                norm += double(rows[i * dims + j]) * double(rows[i * dims + j]);
+            }
+            norms[i] = norm;
+        }
+    }
+
+    /**
+     * @brief Pack the centroids into slabs of slabWidth transposed centroids
+     * and compute their norms. Has to be called after every centroid update.
+     *
+     * @param coordinates Row-major coordinates of the centroids, which have to
+     * stay valid while the assigner is used
+     * @param k Number of centroids
+     * @param d Number of dimensions
+     */
+    void setCentroids(const Scalar *coordinates, uint64_t k, uint64_t d) {
+        numClusters = k;
+        numDims = d;
+        numSlabs = (k + slabWidth - 1) / slabWidth;
+        packed.assign(numSlabs * slabWidth * d, Scalar(0));
+        for (uint64_t i = 0; i < k; i++) {
+            Scalar *slab = packed.data() + (i / slabWidth) * slabWidth * d;
+            for (uint64_t j = 0; j < d; j++) {
+                slab[j * slabWidth + i % slabWidth] = coordinates[i * d + j];
+            }
+        }
+        centroids = coordinates;
+        centroidNorms.resize(k);
+        squaredNorms(coordinates, k, d, centroidNorms.data());
+        maxCentroidNorm = 0;
+        for (double norm : centroidNorms) {
+            maxCentroidNorm = std::max(maxCentroidNorm, std::sqrt(norm));
+        }
+        // Padding centroids can never be the nearest
+        centroidNorms.resize(numSlabs * slabWidth, INFINITY);
+        fallbacks = 0;
+    }
+
+    /**
+     * @brief Assign a range of points. Safe to call from several threads on
+     * disjoint ranges; the number of fallbacks is returned rather than added
+     * to the member.
+     *
+     * @param points Row-major coordinates of all points
+     * @param pointNorms Squared norms of all points
+     * @param begin First point of the range
+     * @param end End of the range
+     * @param labels Receives the index of the nearest centroid of each point
+     * @return Number of points of the range assigned with the direct kernel
+     */
+    uint64_t assign(const Scalar *points, const double *pointNorms,
+                    uint64_t begin, uint64_t end, uint64_t *labels) const {
+        alignas(64) Scalar dots[4 * slabWidth];
+        double products[pointBlock * slabWidth];
+        double best[pointBlock];
+        double second[pointBlock];
+        uint64_t bestIndex[pointBlock];
+        uint64_t numFallbacks = 0;
+        for (uint64_t first = begin; first < end; first += pointBlock) {
+            uint64_t count = std::min(pointBlock, end - first);
+            for (uint64_t p = 0; p < count; p++) {
+                best[p] = INFINITY;
+                second[p] = INFINITY;
+                bestIndex[p] = 0;
+            }
+            for (uint64_t s = 0; s < numSlabs; s++) {
+                const Scalar *slab = packed.data() + s * slabWidth * numDims;
+                const double *norms = centroidNorms.data() + s * slabWidth;
+
+                // Dot products of the block of points with the slab, a block
+                // of dimensions at a time so that the slab stays in cache and
+                // every product is rounded in Scalar over dimBlock terms only
+                std::fill(std::begin(products), std::end(products), 0);
+                for (uint64_t j = 0; j < numDims; j += dimBlock) {
+                    uint64_t length = std::min(dimBlock, numDims - j);
+                    for (uint64_t g = 0; g < count; g += 4) {
+                        // The last group repeats its last point to fill the
+                        // tile
+                        const Scalar *rows[4];
+                        for (uint64_t r = 0; r < 4; r++) {
+                            uint64_t p = std::min(g + r, count - 1);
+                            rows[r] = points + (first + p) * numDims + j;
+                        }
+                        tile(rows, slab + j * slabWidth, length, dots);
+                        for (uint64_t r = 0; r < 4 && g + r < count; r++) {
+                            double *product = products + (g + r) * slabWidth;
+                            for (uint64_t k = 0; k < slabWidth; k++) {
+                                product[k] += double(dots[r * slabWidth + k]);
+                            }
+                        }
+                    }
+                }
+
+                // Nearest and second nearest centroid of every point so far
+                for (uint64_t p = 0; p < count; p++) {
+                    double pointNorm = pointNorms[first + p];
+                    const double *product = products + p * slabWidth;
+                    for (uint64_t k = 0; k < slabWidth; k++) {
+                        double distance = pointNorm + norms[k] - 2 * product[k];
+                        if (distance < best[p]) {
+                            second[p] = best[p];
+                            best[p] = distance;
+                            bestIndex[p] = s * slabWidth + k;
+                        } else if (distance < second[p]) {
+                            second[p] = distance;
+                        }
+                    }
+                }
+            }
+            for (uint64_t p = 0; p < count; p++) {
+                uint64_t i = first + p;
+                if (separated(pointNorms[i], best[p], second[p])) {
+                    labels[i] = bestIndex[p];
+                } else {
+                    double minDistance =
+                        std::numeric_limits<double>::infinity();
+                    labels[i] = kernel.nearestCentroid(
+                        points + i * numDims, centroids, numClusters, numDims,
+                        minDistance);
+                    numFallbacks++;
+                }
+            }
+        }
+        return numFallbacks;
+    }
+
+   private:
+    DistanceKernel<Scalar> kernel;  // direct kernels for the points near a tie
+    DotTileFunction<Scalar> tile;   // dot product tile kernel
+    const Scalar *centroids = nullptr;  // unpacked centroids
+    std::vector<Scalar> packed;         // slabs of transposed centroids
+    std::vector<double> centroidNorms;  // squared norms, padded with infinity
+    double maxCentroidNorm = 0;         // largest norm of a centroid
+    uint64_t numSlabs = 0;              // number of packed slabs
+
+    /**
+     * @brief Rounding error bound of a sum of n products in Scalar
+     * (Higham's gamma_n), relative to the sum of their absolute values
+     *
+     */
+    static double gamma(uint64_t n) {
+        double u = double(std::numeric_limits<Scalar>::epsilon()) / 2;
+        return double(n) * u / (1 - double(n) * u);
+    }
+
+    /**
+     * @brief Check that the nearest expanded distance of a point is certainly
+     * the nearest direct distance too. The expanded distances are off by at
+     * most 2 gamma(dimBlock) ||x|| ||c|| (each block of dot products is
+     * rounded in Scalar, the rest is in double), and the direct distances
+     * (sums of numDims squares in Scalar) by at most gamma(numDims + 2) times
+     * the distance; the two nearest expanded distances have to be further
+     * apart than all of these errors.
+     *
+     * @param pointNorm Squared norm of the point
+     * @param best Nearest expanded distance
+     * @param second Second nearest expanded distance (infinity if there is
+     * a single centroid, which is then certainly the nearest)
+     * @return Whether the nearest centroid is certain
+     */
+    bool separated(double pointNorm, double best, double second) const {
+        if (second == INFINITY) {
+            return true;
+        }
+        double doubleError = 8 * std::numeric_limits<double>::epsilon() *
+                             (pointNorm + maxCentroidNorm * maxCentroidNorm);
+        double expansionError =
+            2 * gamma(dimBlock) * std::sqrt(pointNorm) * maxCentroidNorm +
+            doubleError;
+        double directError =
+            gamma(numDims + 2) * (std::max(best, 0.0) + second + 2 * expansionError);
+        return second - best > 2 * expansionError + directError;
+    }
+};
@@ -11,44 +11,206 @@
 
 #pragma once
 
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
 #include <fstream>
 #include <iostream>
+#include <limits>
+#include <memory>
+#include <random>
+#include <stdexcept>
 #include <string>
+#include <type_traits>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+
+#include "binary_model.hpp"
+#include "centroid_index.hpp"
+#include "dataset.hpp"
+#include "distance.hpp"
+#include "gemm.hpp"
+#include "prediction_writer.hpp"
+#include "random.hpp"
+#include "stream.hpp"
+#include "telemetry.hpp"
+#include "thread_pool.hpp"
 
 /**
- * @brief A class to represent a point in the dataset
+ * @brief Algorithms that fit can use to assign the points to the centroids.
+ * They all give the same assignments; Hamerly and Elkan keep bounds on the
+ * distances between the points and the centroids (triangle inequality) to
+ * skip most of the distance computations.
  */
-class Point {
-   public:
-    uint64_t numDims;                 // number of dimensions
-    std::vector<double> coordinates;  // pointer to the array of coordinates
-    uint64_t cluster;  // cluster number to which the point belongs
-    /**
-     * @brief Construct a new Point object
-     *
-     */
-    Point() {}
-    /**
-     * @brief Construct a new Point object
-     *
-     * @param n The number of dimensions (coordinates) that each point has
-     */
-    Point(uint64_t n) {
-        this->numDims = n;
-        this->coordinates.resize(n);
-    }
+enum class Algorithm {
+    Lloyd,    // compute the distance from every point to every centroid
+    Hamerly,  // one upper bound and one lower bound per point
+    Elkan,    // one upper bound per point and one lower bound per centroid
+    Gemm,     // Lloyd with the distances computed as a blocked matrix product
+    Auto      // Elkan for many clusters in many dimensions, else Hamerly
+};
+
+/**
+ * @brief Methods that fit can use to choose the initial centroids
+ */
+enum class InitMethod {
+    Random,          // numClusters distinct points chosen uniformly
+    KMeansPlusPlus,  // k-means++ (D^2 sampling)
+    KMeansParallel   // k-means|| (oversampled D^2 sampling in a few rounds)
+};
+
+/**
+ * @brief What fit does with a cluster that no point was assigned to. Its
+ * centroid would otherwise be the mean of no points.
+ */
+enum class EmptyClusterPolicy {
+    Farthest,      // move it to the point farthest from its centroid
+    SplitLargest,  // move it to the farthest point of the largest cluster
+    Keep           // leave the centroid where it is
 };
 
+/**
+ * @brief Read the precision of a model file (text or binary)
+ *
+ * @param filename The name of the model file
+ * @return The precision of the model
+ */
+inline Precision readModelPrecision(const std::string &filename) {
+    if (isBinaryModel(filename)) {
+        uint64_t fileSize;
+        return readBinaryModelHeader(filename, fileSize).dtype ==
+                       BinaryDatasetHeader::float32
+                   ? Precision::Float32
+                   : Precision::Float64;
+    }
+    std::ifstream file(filename);
+    if (!file.is_open()) {
+        throw std::runtime_error("Could not open the file");
+    }
+    return readPrecisionHeader(file);
+}
+
 /**
  * @brief A class to represent the K-means clustering algorithm
+ *
+ * The points and centroids are stored as Scalar (double or float; KMeans and
+ * FloatKMeans name the two). With float, each squared distance is accumulated
+ * in float by the distance kernels and only returned as a double. The
+ * centroid sums, the inertia and the Hamerly and Elkan bounds are always kept
+ * in double.
  */
-class KMeans {
+template <typename Scalar>
+class BasicKMeans {
    public:
+    using Dataset = BasicDataset<Scalar>;  // points stored as Scalar
+
     uint64_t numClusters;          // number of clusters
     uint64_t numDims;              // number of dimensions
     uint64_t numPoints;            // number of points in the dataset
-    std::vector<Point> points;     // pointer to the array of points
-    std::vector<Point> centroids;  // pointer to the array of centroids
+    Dataset points;                // points in the dataset and their labels
+    Dataset centroids;             // coordinates of the centroids
+    // Number of points each centroid is the mean of (decayed by the online
+    // updates), saved with the model. Empty if unknown (older model files).
+    std::vector<double> clusterWeights;
+    std::shared_ptr<ThreadPool> pool;  // threads used by the parallel loops
+    DistanceKernel<Scalar> kernel;  // distance kernels selected for numDims
+    Algorithm algorithm = Algorithm::Lloyd;  // assignment algorithm of fit
+    InitMethod initMethod = InitMethod::Random;  // initialization of fit
+    std::mt19937_64 rng;  // random number generator used by the initialization
+    uint64_t iterationsRun = 0;  // number of iterations run by the last fit
+    StopReason stopReason = StopReason::MaxIterations;  // why it stopped
+    uint64_t numInits = 1;  // initializations tried by fit (see fitRestarts)
+    EmptyClusterPolicy emptyClusterPolicy = EmptyClusterPolicy::Farthest;
+    // Besides the threshold on the centroid shift, fit stops once the inertia
+    // of the assignment improves by less than inertiaTolerance times the
+    // previous one, or fewer than reassignedTolerance times the points change
+    // cluster (0 disables either criterion)
+    double inertiaTolerance = 0;
+    double reassignedTolerance = 0;
+    // Measured by the last pass of assignAndAccumulate: the inertia of the
+    // assignment (squared distance of every point to its nearest centroid)
+    // and the number of points whose label changed
+    double assignmentInertia = 0;
+    uint64_t reassignedPoints = 0;
+    Telemetry telemetry;  // callbacks that receive the metrics of training
+
+    // Point-to-centroid distances computed and skipped by the last call to fit
+    uint64_t distanceComputations = 0;
+    uint64_t skippedDistanceComputations = 0;
+
+    // State of the Hamerly and Elkan algorithms
+    std::vector<double> upperBounds;  // bound on the distance to own centroid
+    std::vector<double> lowerBounds;  // bounds on the distance to the others
+    std::vector<double> centroidShift;      // distance moved in last update
+    std::vector<double> centroidDistances;  // half distances between centroids
+    std::vector<double> halfMinDistance;  // half distance to nearest centroid
+
+    // State of the matrix product assignment
+    GemmAssigner<Scalar> gemm;        // packed centroids and their norms
+    std::vector<double> pointNorms;   // squared norm of every point
+
+    // Optional index of the centroids used by prediction instead of
+    // scanning every centroid (see buildIndex)
+    std::shared_ptr<CentroidIndex<Scalar>> centroidIndex;
+
+    // Scratch buffers kept across iterations, so that once fit has run an
+    // iteration the following ones do no heap allocation
+    Dataset previousCentroids;           // centroids before the last update
+    std::vector<double> clusterSums;     // sum of the points of every cluster
+    std::vector<uint64_t> clusterCounts;  // number of points of every cluster
+    std::vector<double> partitionSums;     // clusterSums of every partition
+    std::vector<uint64_t> partitionCounts;  // clusterCounts of every partition
+    std::vector<uint64_t> partitionBounds;   // first point of every partition
+    std::vector<double> partitionInertia;     // inertia of every partition
+    std::vector<uint64_t> pieceReassigned;  // changed labels per piece
+    std::vector<double> pointDistances;  // squared distance of every point to
+                                         // its centroid (sliced accumulation)
+    // Point farthest from its centroid in every cluster (and partition),
+    // from which empty clusters are reseeded
+    std::vector<double> farthestDistance;
+    std::vector<uint64_t> farthestPoint;
+    std::vector<double> partitionFarthestDistance;
+    std::vector<uint64_t> partitionFarthestPoint;
+    std::vector<uint64_t> blockCounts;   // a count per block of points
+    std::vector<uint64_t> previousLabels;  // labels before the assignment
+                                           // (only kept for the telemetry)
+
+    // Number of points assigned by one task of the parallel assignment loop
+    static constexpr uint64_t blockSize = 4096;
+    // Number of points savePredictions assigns before writing them
+    static constexpr uint64_t predictionChunk = uint64_t(1) << 18;
+    // Upper bound on the number of partitions of the dataset that accumulate
+    // their own centroid sums
+    static constexpr uint64_t maxPartitions = 64;
+    // Upper bound on the memory used by the partial sums of all partitions
+    static constexpr uint64_t partitionMemoryBudget = uint64_t(1) << 26;
+    // Slices of the clusters per thread when the partitions are too few to
+    // keep the threads busy (see assignAndAccumulatePieces)
+    static constexpr uint64_t slicesPerThread = 4;
+    // Number of clusters and dimensions from which Algorithm::Auto uses
+    // Elkan. With fewer dimensions a distance is cheap compared to updating
+    // numClusters lower bounds per point, and Hamerly is faster.
+    static constexpr uint64_t elkanMinClusters = 32;
+    static constexpr uint64_t elkanMinDims = 256;
+    // Upper bound on the memory used by the lower bounds of Elkan
+    static constexpr uint64_t elkanMemoryBudget = uint64_t(1) << 32;
+    // Number of rounds and oversampling factor (times numClusters) of k-means||
+    static constexpr uint64_t parallelInitRounds = 5;
+    static constexpr double parallelInitOversampling = 2;
+    // Maximum number of iterations of the coarse k-means of buildIndex
+    static constexpr uint64_t indexIterations = 20;
+    // Number of restarts of fitRestarts trained at a time, and number of
+    // iterations after which a restart is abandoned if its inertia is above
+    // the best final inertia of the waves of restarts before it
+    static constexpr uint64_t restartsPerWave = 4;
+    static constexpr uint64_t restartPruneIterations = 5;
+    // Relative margin by which a bound has to win before a distance computation
+    // is skipped, so that rounding in the bounds never changes an assignment.
+    // Float distances are rounded far more than the bounds, which are doubles.
+    static constexpr double boundMargin =
+        std::is_same_v<Scalar, float> ? 1e-5 : 1e-9;
 
     /**
      * @brief Construct a new KMeans object with a given number of clusters.
@@ -56,234 +218,2260 @@ class KMeans {
      * @param k The number of clusters that the model should find in the dataset
      * @param n The number of dimensions (coordinates) that each point has
      * @param numDataPoints The number of points in the dataset
-     * @param dataPoints A vector containing the points in the dataset
+     * @param dataPoints The points in the dataset. The model shares their
+     * coordinates (a copy of a dataset does not copy them), so moving the
+     * dataset in only saves a reference count.
      */
-    KMeans(uint64_t k, uint64_t n, uint64_t numDataPoints,
-           std::vector<Point> dataPoints) {
+    BasicKMeans(uint64_t k, uint64_t n, uint64_t numDataPoints,
+                Dataset dataPoints) {
         this->numClusters = k;
-        centroids.resize(k);
-        for (uint64_t i = 0; i < k; i++) {
-            centroids[i] = Point(n);
-        }
+        this->centroids = Dataset(k, n);
         this->numDims = n;
         this->numPoints = numDataPoints;
-        this->points = dataPoints;
+        this->points = std::move(dataPoints);
+        this->points.labels.resize(numDataPoints);
+        this->kernel = selectDistanceKernel<Scalar>(n);
     }
 
     /**
      * @brief Construct a new KMeans object given a model file
      *
      * @param numDataPoints The number of points in the dataset
-     * @param dataPoints A vector containing the points in the dataset
+     * @param dataPoints The points in the dataset
      * @param filename The name of the file containing the model (e.g. the
-     * coordinates of the centroids)
+     * coordinates of the centroids), text or binary (see loadModel)
      */
-    KMeans(uint64_t numDataPoints, std::vector<Point> dataPoints,
-           char *filename) {
+    BasicKMeans(uint64_t numDataPoints, Dataset dataPoints,
+                const std::string &filename) {
         this->numPoints = numDataPoints;
-        this->points = dataPoints;
+        this->points = std::move(dataPoints);
+        this->points.labels.resize(numDataPoints);
 
         // Load the model from the file
         this->loadModel(filename);
     }
 
     /**
-     * @brief Randomly initialize the centroids to points in the dataset
+     * @brief Set the number of threads used to train the model and predict.
+     * The result of training does not depend on the number of threads.
+     *
+     * @param n The number of threads (including the calling thread)
+     */
+    void setNumThreads(uint64_t n) { pool = std::make_shared<ThreadPool>(n); }
+
+    /**
+     * @brief Get the thread pool, creating a single-threaded one if none was
+     * set with setNumThreads
+     *
+     * @return The thread pool
+     */
+    ThreadPool &threadPool() {
+        if (!pool) {
+            pool = std::make_shared<ThreadPool>(1);
+        }
+        return *pool;
+    }
+
+    /**
+     * @brief Number of partitions of the dataset that accumulate their own
+     * partial sums. It only depends on the size of the problem (never on the
+     * number of threads), and the partial sums are always merged in partition
+     * order, so the result is the same for any number of threads.
+     *
+     * @return The number of partitions
+     */
+    uint64_t numPartitions() const {
+        return numPartitionsFor(numPoints, numClusters, numDims);
+    }
+
+    /**
+     * @brief Number of partitions of a dataset of a given size (see
+     * numPartitions). Partition p holds the points from p * n / partitions
+     * up to (p + 1) * n / partitions.
+     *
+     * @param n Number of points
+     * @param k Number of clusters
+     * @param d Number of dimensions
+     * @return The number of partitions
+     */
+    static uint64_t numPartitionsFor(uint64_t n, uint64_t k, uint64_t d) {
+        uint64_t partitions = (n + blockSize - 1) / blockSize;
+        uint64_t bytes = (k * d + k) * sizeof(double);
+        uint64_t affordable = partitionMemoryBudget / (bytes > 0 ? bytes : 1);
+        if (partitions > maxPartitions) {
+            partitions = maxPartitions;
+        }
+        if (partitions > affordable) {
+            partitions = affordable;
+        }
+        return partitions > 0 ? partitions : 1;
+    }
+
+    /**
+     * @brief Seed the random number generator used by the initialization
+     *
+     * @param seed The seed
+     */
+    void setSeed(uint64_t seed) { rng.seed(seed); }
+
+    /**
+     * @brief Initialize the centroids with the method set in initMethod
      *
      */
     void initializeCentroids() {
-        // An array to keep track of the selected centroids so that we don't
-        // select the same point twice as a centroid
-        std::vector<bool> selected(numPoints, false);
+        if (numClusters > numPoints) {
+            throw std::runtime_error(
+                "The number of clusters should not be greater than the number "
+                "of points");
+        }
+        if (initMethod == InitMethod::KMeansPlusPlus) {
+            initializeKMeansPlusPlus();
+        } else if (initMethod == InitMethod::KMeansParallel) {
+            initializeKMeansParallel();
+        } else {
+            initializeRandom();
+        }
+    }
+
+    /**
+     * @brief Randomly initialize the centroids to distinct points in the
+     * dataset
+     *
+     */
+    void initializeRandom() {
+        std::vector<uint64_t> indices =
+            drawDistinctIndices(numPoints, numClusters, rng);
         for (uint64_t i = 0; i < numClusters; i++) {
-            uint64_t index = uint64_t(rand()) % numPoints;
-            while (selected[index]) {
-                index = uint64_t(rand()) % numPoints;
-            }
-            selected[index] = true;
-            for (uint64_t j = 0; j < numDims; j++) {
-                centroids[i].coordinates[j] = points[index].coordinates[j];
+            copyPointToCentroid(indices[i], i);
+        }
+    }
+
+    /**
+     * @brief Draw distinct indices uniformly, as initializeRandom does
+     *
+     * @param n Number of points to draw from
+     * @param k Number of indices to draw
+     * @param generator The random number generator
+     * @return The indices, in the order the centroids take them
+     */
+    static std::vector<uint64_t> drawDistinctIndices(
+        uint64_t n, uint64_t k, std::mt19937_64 &generator) {
+        // Floyd's algorithm draws k distinct indices with exactly k random
+        // numbers, however close k is to n
+        std::vector<uint64_t> indices;
+        std::unordered_set<uint64_t> selected;
+        for (uint64_t j = n - k; j < n; j++) {
+            uint64_t index =
+                std::uniform_int_distribution<uint64_t>(0, j)(generator);
+            if (selected.count(index)) {
+                index = j;
             }
+            selected.insert(index);
+            indices.push_back(index);
         }
+        return indices;
     }
 
     /**
-     * @brief Assign points to the nearest centroid
+     * @brief Initialize the centroids with k-means++: every centroid after the
+     * first one is a point drawn with probability proportional to its squared
+     * distance to the nearest centroid chosen so far
      *
      */
-    void assignPointsToCentroids() {
-        for (uint64_t i = 0; i < numPoints; i++) {
-            double minDistance = 1e9;  // initialize the minimum distance to a
-                                       // large number (infinity)
-            uint64_t cluster = 0;
-            for (uint64_t j = 0; j < numClusters; j++) {
-                double distance = 0;
-                for (uint64_t l = 0; l < numDims; l++) {
-                    double _distance =
-                        points[i].coordinates[l] - centroids[j].coordinates[l];
-                    distance += _distance * _distance;
+    void initializeKMeansPlusPlus() {
+        std::vector<double> minDistance(numPoints, INFINITY);
+        uint64_t first =
+            std::uniform_int_distribution<uint64_t>(0, numPoints - 1)(rng);
+        copyPointToCentroid(first, 0);
+        for (uint64_t i = 1; i < numClusters; i++) {
+            updateMinDistance(minDistance, centroids.row(i - 1), 1);
+            copyPointToCentroid(sampleByDistance(minDistance), i);
+        }
+    }
+
+    /**
+     * @brief Initialize the centroids with k-means|| (Bahmani et al.): a few
+     * rounds each sample about parallelInitOversampling * numClusters points
+     * independently with probability proportional to their squared distance to
+     * the candidates, then weighted k-means++ on the candidates (weighted by
+     * the number of points nearest to them) picks the centroids
+     *
+     */
+    void initializeKMeansParallel() {
+        std::vector<double> minDistance(numPoints, INFINITY);
+        std::vector<uint64_t> candidates = {
+            std::uniform_int_distribution<uint64_t>(0, numPoints - 1)(rng)};
+        Dataset candidatePoints = gatherPoints(candidates);
+        updateMinDistance(minDistance, candidatePoints.coordinates, 1);
+
+        double oversampling = parallelInitOversampling * double(numClusters);
+        for (uint64_t round = 0; round < parallelInitRounds; round++) {
+            double cost = totalDistance(minDistance);
+            if (cost <= 0) {
+                break;
+            }
+
+            // Every point is kept independently, with a random number that
+            // only depends on the key of the round and the index of the point
+            uint64_t key = rng();
+            uint64_t partitions = numPartitions();
+            std::vector<std::vector<uint64_t>> sampled(partitions);
+            threadPool().parallelFor(partitions, [&](uint64_t p) {
+                uint64_t end = (p + 1) * numPoints / partitions;
+                for (uint64_t i = p * numPoints / partitions; i < end; i++) {
+                    double probability = oversampling * minDistance[i] / cost;
+                    if (counterUniform(key, i) < probability) {
+                        sampled[p].push_back(i);
+                    }
                 }
-                if (distance < minDistance) {
-                    minDistance = distance;
-                    cluster = j;
+            });
+            std::vector<uint64_t> newCandidates;
+            for (uint64_t p = 0; p < partitions; p++) {
+                newCandidates.insert(newCandidates.end(), sampled[p].begin(),
+                                     sampled[p].end());
+            }
+            if (newCandidates.empty()) {
+                continue;
+            }
+            Dataset newPoints = gatherPoints(newCandidates);
+            updateMinDistance(minDistance, newPoints.coordinates,
+                              newCandidates.size());
+            candidates.insert(candidates.end(), newCandidates.begin(),
+                              newCandidates.end());
+        }
+
+        // Fall back to k-means++ if the rounds found too few candidates
+        if (candidates.size() <= numClusters) {
+            initializeKMeansPlusPlus();
+            return;
+        }
+
+        // Weight every candidate by the number of points nearest to it
+        candidatePoints = gatherPoints(candidates);
+        uint64_t numCandidates = candidates.size();
+        uint64_t partitions = numPartitions();
+        std::vector<uint64_t> partialWeights(partitions * numCandidates, 0);
+        threadPool().parallelFor(partitions, [&](uint64_t p) {
+            uint64_t end = (p + 1) * numPoints / partitions;
+            for (uint64_t i = p * numPoints / partitions; i < end; i++) {
+                double distance = INFINITY;
+                uint64_t nearest = kernel.nearestCentroid(
+                    points.row(i), candidatePoints.coordinates, numCandidates,
+                    numDims, distance);
+                partialWeights[p * numCandidates + nearest]++;
+            }
+        });
+        std::vector<double> weights(numCandidates, 0);
+        for (uint64_t p = 0; p < partitions; p++) {
+            for (uint64_t c = 0; c < numCandidates; c++) {
+                weights[c] += double(partialWeights[p * numCandidates + c]);
+            }
+        }
+
+        // Weighted k-means++ on the candidates
+        std::vector<double> candidateDistance(numCandidates, INFINITY);
+        std::vector<double> score(numCandidates);
+        std::discrete_distribution<uint64_t> byWeight(weights.begin(),
+                                                      weights.end());
+        uint64_t chosen = byWeight(rng);
+        for (uint64_t i = 0; i < numClusters; i++) {
+            copyPointToCentroid(candidates[chosen], i);
+            double total = 0;
+            for (uint64_t c = 0; c < numCandidates; c++) {
+                double distance = kernel.squaredDistance(
+                    candidatePoints.row(c), centroids.row(i), numDims);
+                candidateDistance[c] = std::min(candidateDistance[c], distance);
+                score[c] = weights[c] * candidateDistance[c];
+                total += score[c];
+            }
+            if (total <= 0) {
+                // Every candidate is already a centroid: keep drawing by
+                // weight
+                chosen = byWeight(rng);
+                continue;
+            }
+            double target = std::uniform_real_distribution<double>(0, total)(rng);
+            chosen = numCandidates - 1;
+            for (uint64_t c = 0; c < numCandidates; c++) {
+                target -= score[c];
+                if (target < 0 && score[c] > 0) {
+                    chosen = c;
+                    break;
                 }
             }
-            points[i].cluster = cluster;
         }
     }
 
     /**
-     * @brief Update the centroids to the mean of the points in the cluster
+     * @brief Initialize the centroids from a model trained on the same points
+     * with one cluster less: its centroids are kept, and the cluster with the
+     * largest inertia is split by adding a centroid at one of its points,
+     * drawn with probability proportional to the squared distance to the
+     * centroid of the cluster (as in k-means++)
      *
+     * @param smaller The trained model with numClusters - 1 clusters
      */
-    void updateCentroids() {
-        // Initialize the centroids to zero
-        std::vector<uint64_t> numPointsInCluster(numClusters, 0);
-        for (uint64_t i = 0; i < numClusters; i++) {
-            for (uint64_t j = 0; j < numDims; j++) {
-                centroids[i].coordinates[j] = 0;
-            }
+    void initializeBySplitting(BasicKMeans &smaller) {
+        if (numClusters > numPoints) {
+            throw std::runtime_error(
+                "The number of clusters should not be greater than the number "
+                "of points");
+        }
+        if (smaller.numClusters + 1 != numClusters ||
+            smaller.numDims != numDims || smaller.numPoints != numPoints) {
+            throw std::runtime_error(
+                "A model can only be split from a model with one cluster less "
+                "on the same points");
+        }
+        for (uint64_t i = 0; i < smaller.numClusters; i++) {
+            const Scalar *centroid = smaller.centroids.row(i);
+            std::copy(centroid, centroid + numDims, centroids.row(i));
         }
 
-        // Add the coordinates of all points in a cluster
-        for (uint64_t i = 0; i < numPoints; i++) {
-            uint64_t cluster = points[i].cluster;
-            numPointsInCluster[cluster]++;
-            for (uint64_t j = 0; j < numDims; j++) {
-                centroids[cluster].coordinates[j] += points[i].coordinates[j];
+        std::vector<double> clusterInertia = smaller.clusterInertia();
+        uint64_t worst = uint64_t(
+            std::max_element(clusterInertia.begin(), clusterInertia.end()) -
+            clusterInertia.begin());
+        std::vector<double> distance(numPoints, 0);
+        uint64_t numBlocks = (numPoints + blockSize - 1) / blockSize;
+        threadPool().parallelFor(numBlocks, [&](uint64_t block) {
+            uint64_t end = std::min(numPoints, (block + 1) * blockSize);
+            for (uint64_t i = block * blockSize; i < end; i++) {
+                if (smaller.points.labels[i] == worst) {
+                    distance[i] = kernel.squaredDistance(
+                        points.row(i), smaller.centroids.row(worst), numDims);
+                }
             }
+        });
+        copyPointToCentroid(sampleByDistance(distance), numClusters - 1);
+    }
+
+    /**
+     * @brief Copy a point of the dataset to a centroid
+     *
+     * @param index Index of the point
+     * @param cluster Index of the centroid
+     */
+    void copyPointToCentroid(uint64_t index, uint64_t cluster) {
+        const Scalar *point = points.row(index);
+        Scalar *centroid = centroids.row(cluster);
+        for (uint64_t j = 0; j < numDims; j++) {
+            centroid[j] = point[j];
         }
+    }
 
-        // Divide the sum by the number of points in the cluster to get the
-        // coordinates of the centroid
-        for (uint64_t i = 0; i < numClusters; i++) {
+    /**
+     * @brief Copy some points of the dataset into a new dataset
+     *
+     * @param indices Indices of the points
+     * @return The points
+     */
+    Dataset gatherPoints(const std::vector<uint64_t> &indices) const {
+        Dataset gathered(indices.size(), numDims);
+        for (uint64_t i = 0; i < indices.size(); i++) {
+            const Scalar *point = points.row(indices[i]);
             for (uint64_t j = 0; j < numDims; j++) {
-                centroids[i].coordinates[j] /= double(numPointsInCluster[i]);
+                gathered.row(i)[j] = point[j];
             }
         }
+        return gathered;
     }
 
     /**
-     * @brief Run the k-means algorithm until a threshold is reached or maximum
-     * number of iterations is reached
+     * @brief Lower the squared distance of every point to its nearest
+     * candidate with some new candidates
      *
-     * @param maxIterations Maximum number of iterations to run the algorithm
-     * @param threshold The threshold to stop the algorithm - If the change in
-     * the centroids is less than this threshold, the algorithm stops
+     * @param minDistance The squared distance of every point to its nearest
+     * candidate so far
+     * @param candidates Row-major coordinates of the new candidates
+     * @param numCandidates The number of new candidates
      */
-    void fit(uint64_t maxIterations, double threshold) {
-        initializeCentroids();
-        uint64_t iteration = 0;
-        while (iteration < maxIterations) {
-            assignPointsToCentroids();
+    void updateMinDistance(std::vector<double> &minDistance,
+                           const Scalar *candidates, uint64_t numCandidates) {
+        uint64_t numBlocks = (numPoints + blockSize - 1) / blockSize;
+        threadPool().parallelFor(numBlocks, [&](uint64_t block) {
+            uint64_t end = std::min(numPoints, (block + 1) * blockSize);
+            for (uint64_t i = block * blockSize; i < end; i++) {
+                kernel.nearestCentroid(points.row(i), candidates,
+                                       numCandidates, numDims, minDistance[i]);
+            }
+        });
+    }
 
-            // Store the old centroids
-            std::vector<Point> oldCentroids(numClusters);
-            for (uint64_t i = 0; i < numClusters; i++) {
-                oldCentroids[i] = Point(numDims);
-                for (uint64_t j = 0; j < numDims; j++) {
-                    oldCentroids[i].coordinates[j] =
-                        centroids[i].coordinates[j];
-                }
+    /**
+     * @brief Add up the squared distances of the points of every partition
+     *
+     * @param minDistance The squared distance of every point
+     * @return The sum of the distances in each partition
+     */
+    std::vector<double> partitionDistances(
+        const std::vector<double> &minDistance) {
+        uint64_t partitions = numPartitions();
+        std::vector<double> partialSums(partitions, 0);
+        threadPool().parallelFor(partitions, [&](uint64_t p) {
+            uint64_t end = (p + 1) * numPoints / partitions;
+            for (uint64_t i = p * numPoints / partitions; i < end; i++) {
+                partialSums[p] += minDistance[i];
             }
+        });
+        return partialSums;
+    }
+
+    /**
+     * @brief Add up the squared distances of all points in partition order
+     *
+     * @param minDistance The squared distance of every point
+     * @return The sum of the distances
+     */
+    double totalDistance(const std::vector<double> &minDistance) {
+        double total = 0;
+        for (double partialSum : partitionDistances(minDistance)) {
+            total += partialSum;
+        }
+        return total;
+    }
 
-            updateCentroids();
+    /**
+     * @brief Draw a point with probability proportional to its squared
+     * distance to the nearest centroid chosen so far
+     *
+     * @param minDistance The squared distance of every point
+     * @return Index of the point
+     */
+    uint64_t sampleByDistance(const std::vector<double> &minDistance) {
+        std::vector<double> partialSums = partitionDistances(minDistance);
+        double total = 0;
+        for (double partialSum : partialSums) {
+            total += partialSum;
+        }
+        if (total <= 0) {
+            // All points coincide with a centroid
+            return std::uniform_int_distribution<uint64_t>(0, numPoints - 1)(
+                rng);
+        }
 
-            // Calculate the maximum distance between the old and new centroids
-            double maxDistance = 0;
-            for (uint64_t i = 0; i < numClusters; i++) {
-                double distance = 0;
-                for (uint64_t j = 0; j < numDims; j++) {
-                    double _distance = oldCentroids[i].coordinates[j] -
-                                       centroids[i].coordinates[j];
-                    distance += _distance * _distance;
+        // Find the partition of the target first, then the point in it.
+        // Rounding can leave a tiny positive target at the end of the scan, in
+        // which case the last point with a positive distance is chosen.
+        double target = std::uniform_real_distribution<double>(0, total)(rng);
+        uint64_t partitions = partialSums.size();
+        uint64_t p = 0;
+        uint64_t lastPositive = 0;
+        for (; p < partitions; p++) {
+            if (partialSums[p] > 0) {
+                lastPositive = p;
+                if (target < partialSums[p]) {
+                    break;
                 }
-                if (distance > maxDistance) {
-                    maxDistance = distance;
+                target -= partialSums[p];
+            }
+        }
+        if (p == partitions) {
+            p = lastPositive;
+        }
+        uint64_t chosen = 0;
+        uint64_t end = (p + 1) * numPoints / partitions;
+        for (uint64_t i = p * numPoints / partitions; i < end; i++) {
+            if (minDistance[i] > 0) {
+                chosen = i;
+                target -= minDistance[i];
+                if (target < 0) {
+                    break;
                 }
             }
+        }
+        return chosen;
+    }
 
-            // If the maximum distance is less than the threshold, stop the
-            // algorithm
-            if (maxDistance < threshold) {
-                break;
+    /**
+     * @brief Assign points to the nearest centroid
+     *
+     */
+    void assignPointsToCentroids() {
+        uint64_t numBlocks = (numPoints + blockSize - 1) / blockSize;
+        threadPool().parallelFor(numBlocks, [this](uint64_t block) {
+            uint64_t end = std::min(numPoints, (block + 1) * blockSize);
+            for (uint64_t i = block * blockSize; i < end; i++) {
+                assignPoint(i);
             }
+        });
+    }
 
-            iteration++;
+    /**
+     * @brief Assign points to the nearest centroid for prediction: through the
+     * index when there is one, otherwise exactly
+     *
+     */
+    void predictPoints() {
+        predictRange(points, 0, numPoints, points.labels.data(), nullptr);
+    }
+
+    /**
+     * @brief Assign the points [begin, end) of a dataset for prediction, in
+     * parallel
+     *
+     * @param data The dataset
+     * @param begin Index of the first point
+     * @param end Index past the last point
+     * @param labels Receives the cluster of every point, from labels[0]
+     * @param distances Receives the squared distance of every point to the
+     * centroid of its cluster, from distances[0] (nullptr: not needed)
+     */
+    void predictRange(const Dataset &data, uint64_t begin, uint64_t end,
+                      uint64_t *labels, double *distances) {
+        uint64_t numBlocks = (end - begin + blockSize - 1) / blockSize;
+        threadPool().parallelFor(numBlocks, [&](uint64_t block) {
+            uint64_t first = begin + block * blockSize;
+            uint64_t last = std::min(end, first + blockSize);
+            for (uint64_t i = first; i < last; i++) {
+                double minDistance;
+                labels[i - begin] = predictPoint(data.row(i), minDistance);
+                if (distances) {
+                    distances[i - begin] = minDistance;
+                }
+            }
+        });
+    }
+
+    /**
+     * @brief Find the nearest centroid of a point for prediction: through the
+     * index when there is one, otherwise exactly
+     *
+     * @param point The coordinates of the point
+     * @param minDistance Receives the squared distance to the centroid
+     * @return Index of the centroid
+     */
+    uint64_t predictPoint(const Scalar *point, double &minDistance) const {
+        minDistance = std::numeric_limits<double>::infinity();
+        if (centroidIndex) {
+            return centroidIndex->nearest(point, minDistance);
         }
+        return kernel.nearestCentroid(point, centroids.coordinates,
+                                      numClusters, numDims, minDistance);
     }
 
     /**
-     * @brief Save the predictions to a file
+     * @brief Build the index of the centroids used by prediction. The
+     * centroids are clustered into lists by k-means itself.
      *
-     * @param filename The name of the file to save the predictions to
+     * @param numLists Number of lists (0: the square root of the number of
+     * clusters)
+     * @param probes Number of lists searched for a point
      */
-    void savePredictions(std::string filename) {
-        assignPointsToCentroids();
-        std::ofstream file(filename);
-        for (uint64_t i = 0; i < numPoints; i++) {
-            file << points[i].cluster << std::endl;
+    void buildIndex(uint64_t numLists, uint64_t probes) {
+        if (numLists == 0) {
+            numLists = uint64_t(std::lround(std::sqrt(double(numClusters))));
         }
+        numLists = std::max<uint64_t>(1, std::min(numLists, numClusters));
+        BasicKMeans coarse(numLists, numDims, numClusters, centroids);
+        coarse.pool = pool;
+        coarse.initMethod = InitMethod::KMeansPlusPlus;
+        coarse.algorithm = Algorithm::Hamerly;
+        coarse.fit(indexIterations, 0);
+        coarse.assignPointsToCentroids();
+        centroidIndex = std::make_shared<CentroidIndex<Scalar>>();
+        centroidIndex->build(centroids, coarse.centroids,
+                             coarse.points.labels);
+        centroidIndex->probes = probes;
     }
 
     /**
-     * @brief Calculate the inertia of the model (sum of squared distances of
-     * samples to their closest cluster center)
+     * @brief Load the index of the centroids used by prediction
      *
-     * @return The intertia of the model
+     * @param filename The name of the file saved by CentroidIndex::save
+     * @param probes Number of lists searched for a point
+     * @return Whether the index was built for the centroids of the model (if
+     * not, the model is left without an index)
      */
-    double inertia() {
-        double inertia = 0;
-        for (uint64_t i = 0; i < numPoints; i++) {
-            uint64_t cluster = points[i].cluster;
-            for (uint64_t j = 0; j < numDims; j++) {
-                double distance = points[i].coordinates[j] -
-                                  centroids[cluster].coordinates[j];
-                inertia += distance * distance;
-            }
+    bool loadIndex(const std::string &filename, uint64_t probes) {
+        auto index = std::make_shared<CentroidIndex<Scalar>>();
+        if (!index->load(filename, centroids)) {
+            return false;
         }
-        return inertia;
+        index->probes = probes;
+        centroidIndex = index;
+        return true;
     }
 
     /**
-     * @brief Save the model to a file
+     * @brief Assign one point to the nearest centroid
      *
-     * @param filename The name of the file to save the model to
+     * @param i Index of the point
      */
-    void saveModel(std::string filename) {
-        std::ofstream file(filename);
-        file << numClusters << std::endl;  // First line is number of clusters
-        file << numDims << std::endl;  // Second line is number of dimensions
-        // Next lines are the coordinates of the centroids
-        for (uint64_t i = 0; i < numClusters; i++) {
-            for (uint64_t j = 0; j < numDims; j++) {
-                file << centroids[i].coordinates[j] << " ";
+    void assignPoint(uint64_t i) {
+        double minDistance = std::numeric_limits<double>::infinity();
+        points.labels[i] =
+            kernel.nearestCentroid(points.row(i), centroids.coordinates,
+                                   numClusters, numDims, minDistance);
+    }
+
+    /**
+     * @brief Assign points to the nearest centroid with the matrix product
+     * expansion of the distances (see GemmAssigner). Gives the same labels as
+     * assignPointsToCentroids.
+     *
+     * @param newPoints Whether the points changed since the last call, so
+     * that their norms have to be computed again
+     */
+    void assignPointsGemm(bool newPoints) {
+        if (newPoints || pointNorms.size() != numPoints) {
+            pointNorms.resize(numPoints);
+            uint64_t numBlocks = (numPoints + blockSize - 1) / blockSize;
+            threadPool().parallelFor(numBlocks, [&](uint64_t block) {
+                uint64_t begin = block * blockSize;
+                uint64_t end = std::min(numPoints, begin + blockSize);
+                GemmAssigner<Scalar>::squaredNorms(points.row(begin),
+                                                   end - begin, numDims,
+                                                   pointNorms.data() + begin);
+            });
+        }
+        if (newPoints) {
+            gemm = GemmAssigner<Scalar>(kernel);
+        }
+        gemm.setCentroids(centroids.coordinates, numClusters, numDims);
+
+        uint64_t numBlocks = (numPoints + blockSize - 1) / blockSize;
+        blockCounts.assign(numBlocks, 0);
+        threadPool().parallelFor(numBlocks, [&](uint64_t block) {
+            uint64_t begin = block * blockSize;
+            uint64_t end = std::min(numPoints, begin + blockSize);
+            blockCounts[block] =
+                gemm.assign(points.coordinates, pointNorms.data(), begin, end,
+                            points.labels.data());
+        });
+        for (uint64_t block = 0; block < numBlocks; block++) {
+            gemm.fallbacks += blockCounts[block];
+        }
+    }
+
+    /**
+     * @brief Update the centroids to the mean of the points in the cluster
+     *
+     */
+    void updateCentroids() {
+        clusterSums.assign(numClusters * numDims, 0);
+        clusterCounts.assign(numClusters, 0);
+        accumulateClusterSums(clusterSums, clusterCounts);
+        reseedEmptyClusters(clusterSums, clusterCounts, centroids, false);
+        divideClusterSums(clusterSums, clusterCounts, centroids);
+    }
+
+    /**
+     * @brief Merge the farthest points of the partitions into farthestPoint
+     * and farthestDistance, in partition order so that ties go to the first
+     * point whatever the number of threads
+     *
+     * @param partitions Number of partitions
+     */
+    void mergeFarthest(uint64_t partitions) {
+        farthestDistance.assign(numClusters, -1);
+        farthestPoint.assign(numClusters, numPoints);
+        for (uint64_t p = 0; p < partitions; p++) {
+            for (uint64_t c = 0; c < numClusters; c++) {
+                double distance = partitionFarthestDistance[p * numClusters + c];
+                if (distance > farthestDistance[c]) {
+                    farthestDistance[c] = distance;
+                    farthestPoint[c] = partitionFarthestPoint[p * numClusters + c];
+                }
             }
-            file << std::endl;
         }
-        file.close();
     }
 
     /**
-     * @brief Load the model from a file
+     * @brief Find the farthest point of every cluster with a pass over the
+     * points, for the assignments that do not track it
      *
-     * @param filename The name of the file to load the model from
+     * @param assigned The centroids the points are assigned to
      */
-    void loadModel(std::string filename) {
-        std::ifstream file(filename);
-        file >> numClusters;  // First line is number of clusters
-        file >> numDims;      // Second line is number of dimensions
-        this->numClusters = numClusters;
-        centroids.resize(numClusters);
-        this->numDims = numDims;
-        // Next lines are the coordinates of the centroids
-        std::vector<Point> oldCentroids(numClusters);
-        for (uint64_t i = 0; i < numClusters; i++) {
-            centroids[i] = Point(numDims);
-            for (uint64_t j = 0; j < numDims; j++) {
-                file >> centroids[i].coordinates[j];
+    void findFarthestPoints(const Dataset &assigned) {
+        uint64_t partitions = numPartitions();
+        partitionFarthestDistance.assign(partitions * numClusters, -1);
+        partitionFarthestPoint.assign(partitions * numClusters, numPoints);
+        threadPool().parallelFor(partitions, [&](uint64_t p) {
+            double *distances = partitionFarthestDistance.data() + p * numClusters;
+            uint64_t *farthest = partitionFarthestPoint.data() + p * numClusters;
+            uint64_t end = (p + 1) * numPoints / partitions;
+            for (uint64_t i = p * numPoints / partitions; i < end; i++) {
+                uint64_t cluster = points.labels[i];
+                double distance = kernel.squaredDistance(
+                    points.row(i), assigned.row(cluster), numDims);
+                if (distance > distances[cluster]) {
+                    distances[cluster] = distance;
+                    farthest[cluster] = i;
+                }
+            }
+        });
+        mergeFarthest(partitions);
+    }
+
+    /**
+     * @brief Give every empty cluster a point, following emptyClusterPolicy:
+     * the farthest point of the cluster whose farthest point is the farthest
+     * from its centroid (Farthest), or of the cluster with the most points
+     * (SplitLargest). The point is moved from the sums and count of its
+     * cluster to those of the empty one, so the empty centroid is placed on
+     * it. A cluster gives at most one point per update and keeps at least
+     * one; an empty cluster left without a point keeps its centroid (see
+     * divideClusterSums).
+     *
+     * @param sums The sum of the coordinates of every cluster (row-major)
+     * @param counts The number of points in every cluster
+     * @param assigned The centroids the points are assigned to
+     * @param tracked Whether the pass that assigned the points already found
+     * the farthest point of every cluster (see assignAndAccumulate)
+     * @return The number of clusters reseeded
+     */
+    uint64_t reseedEmptyClusters(std::vector<double> &sums,
+                                 std::vector<uint64_t> &counts,
+                                 const Dataset &assigned, bool tracked) {
+        if (emptyClusterPolicy == EmptyClusterPolicy::Keep ||
+            std::find(counts.begin(), counts.end(), 0) == counts.end()) {
+            return 0;
+        }
+        if (!tracked) {
+            findFarthestPoints(assigned);
+        }
+        std::vector<bool> gave(numClusters, false);
+        uint64_t reseeded = 0;
+        for (uint64_t c = 0; c < numClusters; c++) {
+            if (counts[c] != 0) {
+                continue;
+            }
+            uint64_t donor = reseedDonor(counts, gave);
+            if (donor == numClusters) {
+                break;
             }
+            gave[donor] = true;
+
+            uint64_t i = farthestPoint[donor];
+            moveToEmptyCluster(sums, counts, donor, c, points.row(i));
+            points.labels[i] = c;
+            // The lower bounds of Hamerly and Elkan of the point may not hold
+            // for its new cluster
+            if (lowerBounds.size() == numPoints * numClusters) {
+                std::fill(lowerBounds.begin() + int64_t(i * numClusters),
+                          lowerBounds.begin() + int64_t((i + 1) * numClusters),
+                          0);
+            } else if (lowerBounds.size() == numPoints) {
+                lowerBounds[i] = 0;
+            }
+            reseeded++;
         }
-        file.close();
+        return reseeded;
     }
-};
+
+    /**
+     * @brief Choose the cluster that gives its farthest point to the next
+     * empty cluster (see reseedEmptyClusters)
+     *
+     * @param counts The number of points in every cluster
+     * @param gave Whether every cluster already gave a point
+     * @return The donor, or numClusters if no cluster can give a point
+     */
+    uint64_t reseedDonor(const std::vector<uint64_t> &counts,
+                         const std::vector<bool> &gave) const {
+        uint64_t donor = numClusters;
+        for (uint64_t d = 0; d < numClusters; d++) {
+            if (counts[d] < 2 || gave[d]) {
+                continue;
+            }
+            bool better =
+                donor == numClusters ||
+                (emptyClusterPolicy == EmptyClusterPolicy::SplitLargest
+                     ? counts[d] > counts[donor]
+                     : farthestDistance[d] > farthestDistance[donor]);
+            if (better) {
+                donor = d;
+            }
+        }
+        return donor;
+    }
+
+    /**
+     * @brief Move a point from the sums and count of its cluster to those of
+     * an empty cluster
+     *
+     * @param sums The sum of the coordinates of every cluster (row-major)
+     * @param counts The number of points in every cluster
+     * @param donor The cluster of the point
+     * @param empty The empty cluster
+     * @param point The coordinates of the point
+     */
+    void moveToEmptyCluster(std::vector<double> &sums,
+                            std::vector<uint64_t> &counts, uint64_t donor,
+                            uint64_t empty, const Scalar *point) const {
+        double *from = sums.data() + donor * numDims;
+        double *to = sums.data() + empty * numDims;
+        for (uint64_t j = 0; j < numDims; j++) {
+            from[j] -= point[j];
+            to[j] = point[j];
+        }
+        counts[donor]--;
+        counts[empty] = 1;
+    }
+
+    /**
+     * @brief Assign every point to its nearest centroid and add it to the sums
+     * and count of its cluster, in one pass over the points, so that each
+     * point is read once per iteration instead of once to assign it and once
+     * to update the centroids. The pass also measures the inertia of the
+     * assignment and the number of points that changed cluster (see
+     * assignmentInertia and reassignedPoints) and finds the farthest point of
+     * every cluster (see farthestPoint). Partition p handles its points in
+     * order, so clusterSums and clusterCounts are the same as those of
+     * assignPointsToCentroids followed by accumulateClusterSums.
+     *
+     */
+    void assignAndAccumulate() {
+        uint64_t partitions = numPartitions();
+        uint64_t size = numClusters * numDims;
+        partitionBounds.resize(partitions + 1);
+        for (uint64_t p = 0; p <= partitions; p++) {
+            partitionBounds[p] = p * numPoints / partitions;
+        }
+        partitionSums.assign(partitions * size, 0);
+        partitionCounts.assign(partitions * numClusters, 0);
+        partitionInertia.assign(partitions, 0);
+        partitionFarthestDistance.assign(partitions * numClusters, -1);
+        partitionFarthestPoint.assign(partitions * numClusters, numPoints);
+        assignAndAccumulatePieces(
+            partitionBounds, partitionSums.data(), partitionCounts.data(),
+            partitionInertia.data(), reassignedPoints,
+            partitionFarthestDistance.data(), partitionFarthestPoint.data());
+        clusterSums.assign(size, 0);
+        clusterCounts.assign(numClusters, 0);
+        mergePartitions(partitions, clusterSums, clusterCounts);
+        mergeFarthest(partitions);
+
+        // Add the partitions in order so that the result does not depend on
+        // the number of threads
+        assignmentInertia = 0;
+        for (uint64_t p = 0; p < partitions; p++) {
+            assignmentInertia += partitionInertia[p];
+        }
+    }
+
+    /**
+     * @brief Assign consecutive pieces of the points and add every piece to
+     * its own sums, counts and farthest points, as assignAndAccumulateRange
+     * does for each piece.
+     *
+     * With fewer pieces than threads (the sums of large codebooks limit the
+     * number of partitions), the points are first assigned in parallel
+     * blocks, then every piece is accumulated by tasks that each own a slice
+     * of the clusters. Every cluster still adds its points in order, so the
+     * results are the same either way.
+     *
+     * @param bounds The pieces: piece p holds the points [bounds[p],
+     * bounds[p + 1])
+     * @param sums The sums of every piece (numClusters x numDims each)
+     * @param counts The counts of every piece (numClusters each)
+     * @param inertia Receives the inertia of every piece
+     * @param reassigned Receives the number of points that changed cluster
+     * @param farthestDistances The farthest distances of every piece
+     * (numClusters each, -1 if none)
+     * @param farthestPoints The farthest points of every piece
+     */
+    void assignAndAccumulatePieces(const std::vector<uint64_t> &bounds,
+                                   double *sums, uint64_t *counts,
+                                   double *inertia, uint64_t &reassigned,
+                                   double *farthestDistances,
+                                   uint64_t *farthestPoints) {
+        uint64_t numPieces = bounds.size() - 1;
+        uint64_t size = numClusters * numDims;
+        ThreadPool &threads = threadPool();
+        if (numPieces >= threads.size()) {
+            pieceReassigned.assign(numPieces, 0);
+            threads.parallelFor(numPieces, [&](uint64_t p) {
+                assignAndAccumulateRange(
+                    bounds[p], bounds[p + 1], sums + p * size,
+                    counts + p * numClusters, inertia[p], pieceReassigned[p],
+                    farthestDistances + p * numClusters,
+                    farthestPoints + p * numClusters);
+            });
+            reassigned = 0;
+            for (uint64_t changed : pieceReassigned) {
+                reassigned += changed;
+            }
+            return;
+        }
+
+        // Assign blocks of points in parallel, keeping their distances
+        uint64_t begin = bounds.front();
+        uint64_t end = bounds.back();
+        pointDistances.resize(numPoints);
+        uint64_t numBlocks = (end - begin + blockSize - 1) / blockSize;
+        blockCounts.assign(numBlocks, 0);
+        threads.parallelFor(numBlocks, [&](uint64_t block) {
+            uint64_t first = begin + block * blockSize;
+            uint64_t last = std::min(end, first + blockSize);
+            uint64_t changed = 0;
+            for (uint64_t i = first; i < last; i++) {
+                double minDistance = std::numeric_limits<double>::infinity();
+                uint64_t cluster =
+                    kernel.nearestCentroid(points.row(i), centroids.coordinates,
+                                           numClusters, numDims, minDistance);
+                changed += cluster != points.labels[i];
+                points.labels[i] = cluster;
+                pointDistances[i] = minDistance;
+            }
+            blockCounts[block] = changed;
+        });
+        reassigned = 0;
+        for (uint64_t changed : blockCounts) {
+            reassigned += changed;
+        }
+
+        // Accumulate every piece by slices of the clusters
+        uint64_t slices = slicesFor(numPieces);
+        threads.parallelFor(numPieces * slices, [&](uint64_t task) {
+            uint64_t p = task / slices;
+            uint64_t s = task % slices;
+            accumulateSlice(bounds[p], bounds[p + 1], s * numClusters / slices,
+                            (s + 1) * numClusters / slices, sums + p * size,
+                            counts + p * numClusters,
+                            farthestDistances + p * numClusters,
+                            farthestPoints + p * numClusters);
+            if (s == 0) {
+                double inertiaSum = 0;
+                for (uint64_t i = bounds[p]; i < bounds[p + 1]; i++) {
+                    inertiaSum += pointDistances[i];
+                }
+                inertia[p] = inertiaSum;
+            }
+        });
+    }
+
+    /**
+     * @brief Number of slices of the clusters that accumulate every piece
+     * when there are fewer pieces than threads (see
+     * assignAndAccumulatePieces). It does not change the sums.
+     *
+     * @param numPieces Number of pieces
+     * @return The number of slices
+     */
+    uint64_t slicesFor(uint64_t numPieces) {
+        uint64_t tasks = slicesPerThread * threadPool().size();
+        uint64_t slices = (tasks + numPieces - 1) / numPieces;
+        return std::max<uint64_t>(1, std::min(slices, numClusters));
+    }
+
+    /**
+     * @brief Add the points of a range whose cluster is in a slice of the
+     * clusters to the sums of their clusters, one point after the other
+     *
+     * @param begin First point of the range
+     * @param end End of the range
+     * @param firstCluster First cluster of the slice
+     * @param lastCluster End of the slice
+     * @param partialSum The sum of every cluster (row-major)
+     * @param partialCount The number of points of every cluster
+     * @param partialFarthestDistance The squared distance of the farthest
+     * point of every cluster so far, from pointDistances (nullptr: not
+     * tracked)
+     * @param partialFarthestPoint The farthest point of every cluster so far
+     */
+    void accumulateSlice(uint64_t begin, uint64_t end, uint64_t firstCluster,
+                         uint64_t lastCluster, double *partialSum,
+                         uint64_t *partialCount,
+                         double *partialFarthestDistance,
+                         uint64_t *partialFarthestPoint) const {
+        for (uint64_t i = begin; i < end; i++) {
+            uint64_t cluster = points.labels[i];
+            if (cluster < firstCluster || cluster >= lastCluster) {
+                continue;
+            }
+            if (partialFarthestDistance &&
+                pointDistances[i] > partialFarthestDistance[cluster]) {
+                partialFarthestDistance[cluster] = pointDistances[i];
+                partialFarthestPoint[cluster] = i;
+            }
+            partialCount[cluster]++;
+            const Scalar *point = points.row(i);
+            double *sum = partialSum + cluster * numDims;
+            for (uint64_t j = 0; j < numDims; j++) {
+                sum[j] += point[j];
+            }
+        }
+    }
+
+    /**
+     * @brief Assign a range of points and add them to the sums of their
+     * clusters, one point after the other (see assignAndAccumulate)
+     *
+     * @param begin First point of the range
+     * @param end End of the range
+     * @param partialSum The sum of every cluster (row-major)
+     * @param partialCount The number of points of every cluster
+     * @param partialInertia Receives the inertia of the assignment
+     * @param reassigned Receives the number of points that changed cluster
+     * @param partialFarthestDistance The squared distance of the farthest
+     * point of every cluster so far (-1 if none)
+     * @param partialFarthestPoint The farthest point of every cluster so far
+     */
+    void assignAndAccumulateRange(uint64_t begin, uint64_t end,
+                                  double *partialSum, uint64_t *partialCount,
+                                  double &partialInertia, uint64_t &reassigned,
+                                  double *partialFarthestDistance,
+                                  uint64_t *partialFarthestPoint) {
+        double inertiaSum = 0;
+        uint64_t changed = 0;
+        for (uint64_t i = begin; i < end; i++) {
+            const Scalar *point = points.row(i);
+            double minDistance = std::numeric_limits<double>::infinity();
+            uint64_t cluster =
+                kernel.nearestCentroid(point, centroids.coordinates,
+                                       numClusters, numDims, minDistance);
+            changed += cluster != points.labels[i];
+            points.labels[i] = cluster;
+            inertiaSum += minDistance;
+            if (minDistance > partialFarthestDistance[cluster]) {
+                partialFarthestDistance[cluster] = minDistance;
+                partialFarthestPoint[cluster] = i;
+            }
+            partialCount[cluster]++;
+            double *sum = partialSum + cluster * numDims;
+            for (uint64_t j = 0; j < numDims; j++) {
+                sum[j] += point[j];
+            }
+        }
+        partialInertia = inertiaSum;
+        reassigned = changed;
+    }
+
+    /**
+     * @brief Make the centroids the previous centroids by swapping the two
+     * buffers instead of copying, before an update that writes every
+     * centroid
+     *
+     */
+    void swapCentroids() {
+        if (previousCentroids.numPoints != numClusters ||
+            previousCentroids.numDims != numDims) {
+            previousCentroids = Dataset(numClusters, numDims);
+        }
+        std::swap(centroids, previousCentroids);
+    }
+
+    /**
+     * @brief Copy the centroids to previousCentroids, reusing its buffer
+     *
+     */
+    void rememberCentroids() {
+        if (previousCentroids.numPoints != numClusters ||
+            previousCentroids.numDims != numDims) {
+            previousCentroids = Dataset(numClusters, numDims);
+        }
+        std::copy(centroids.coordinates,
+                  centroids.coordinates + numClusters * numDims,
+                  previousCentroids.coordinates);
+    }
+
+    /**
+     * @brief Add the coordinates of the points of each cluster to its sum and
+     * the number of points to its count
+     *
+     * @param sums The sum of the coordinates of every cluster (row-major)
+     * @param counts The number of points in every cluster
+     */
+    void accumulateClusterSums(std::vector<double> &sums,
+                               std::vector<uint64_t> &counts) {
+        // Each partition of the dataset adds the coordinates of its points to
+        // its own sums and counts
+        uint64_t partitions = numPartitions();
+        uint64_t size = numClusters * numDims;
+        partitionSums.assign(partitions * size, 0);
+        partitionCounts.assign(partitions * numClusters, 0);
+        if (partitions >= threadPool().size()) {
+            threadPool().parallelFor(partitions, [&](uint64_t p) {
+                accumulateRange(p * numPoints / partitions,
+                                (p + 1) * numPoints / partitions,
+                                partitionSums.data() + p * size,
+                                partitionCounts.data() + p * numClusters);
+            });
+        } else {
+            // Too few partitions to keep the threads busy: every partition is
+            // accumulated by slices of the clusters, which gives the same sums
+            uint64_t slices = slicesFor(partitions);
+            threadPool().parallelFor(partitions * slices, [&](uint64_t task) {
+                uint64_t p = task / slices;
+                uint64_t s = task % slices;
+                accumulateSlice(p * numPoints / partitions,
+                                (p + 1) * numPoints / partitions,
+                                s * numClusters / slices,
+                                (s + 1) * numClusters / slices,
+                                partitionSums.data() + p * size,
+                                partitionCounts.data() + p * numClusters,
+                                nullptr, nullptr);
+            });
+        }
+        mergePartitions(partitions, sums, counts);
+    }
+
+    /**
+     * @brief Add the coordinates of a range of points to the sums of their
+     * clusters, one point after the other
+     *
+     * @param begin First point of the range
+     * @param end End of the range
+     * @param partialSum The sum of every cluster (row-major)
+     * @param partialCount The number of points of every cluster
+     */
+    void accumulateRange(uint64_t begin, uint64_t end, double *partialSum,
+                         uint64_t *partialCount) const {
+        for (uint64_t i = begin; i < end; i++) {
+            uint64_t cluster = points.labels[i];
+            partialCount[cluster]++;
+            const Scalar *point = points.row(i);
+            double *sum = partialSum + cluster * numDims;
+            for (uint64_t j = 0; j < numDims; j++) {
+                sum[j] += point[j];
+            }
+        }
+    }
+
+    /**
+     * @brief Add the partial sums and counts of the partitions (in
+     * partitionSums and partitionCounts) to the sums and counts
+     *
+     * @param partitions Number of partitions
+     * @param sums The sum of the coordinates of every cluster (row-major)
+     * @param counts The number of points in every cluster
+     */
+    void mergePartitions(uint64_t partitions, std::vector<double> &sums,
+                         std::vector<uint64_t> &counts) {
+        uint64_t size = numClusters * numDims;
+        // Merge the partitions in order so that the result does not depend on
+        // the number of threads
+        threadPool().parallelFor(numClusters, [&](uint64_t i) {
+            double *sum = sums.data() + i * numDims;
+            for (uint64_t p = 0; p < partitions; p++) {
+                counts[i] += partitionCounts[p * numClusters + i];
+                const double *partialSum =
+                    partitionSums.data() + p * size + i * numDims;
+                for (uint64_t j = 0; j < numDims; j++) {
+                    sum[j] += partialSum[j];
+                }
+            }
+        });
+    }
+
+    /**
+     * @brief Divide the sum of the coordinates of each cluster by the number
+     * of points in the cluster to get the coordinates of the centroid. A
+     * cluster without points keeps its centroid.
+     *
+     * @param sums The sum of the coordinates of every cluster (row-major)
+     * @param counts The number of points in every cluster
+     * @param previous The centroids the points were assigned to (the
+     * centroids themselves, or previousCentroids after rememberCentroids or
+     * swapCentroids)
+     */
+    void divideClusterSums(const std::vector<double> &sums,
+                           const std::vector<uint64_t> &counts,
+                           const Dataset &previous) {
+        for (uint64_t i = 0; i < numClusters; i++) {
+            Scalar *centroid = centroids.row(i);
+            if (counts[i] == 0) {
+                if (previous.coordinates != centroids.coordinates) {
+                    std::copy(previous.row(i), previous.row(i) + numDims,
+                              centroid);
+                }
+                continue;
+            }
+            const double *sum = sums.data() + i * numDims;
+            for (uint64_t j = 0; j < numDims; j++) {
+                centroid[j] = Scalar(sum[j] / double(counts[i]));
+            }
+        }
+    }
+
+    /**
+     * @brief Run the k-means algorithm until a threshold is reached or maximum
+     * number of iterations is reached
+     *
+     * @param maxIterations Maximum number of iterations to run the algorithm
+     * @param threshold The threshold to stop the algorithm - If the change in
+     * the centroids is less than this threshold, the algorithm stops
+     */
+    void fit(uint64_t maxIterations, double threshold) {
+        if (numInits > 1) {
+            fitRestarts(maxIterations, threshold);
+            return;
+        }
+        initializeCentroids();
+        fitFromCentroids(maxIterations, threshold);
+    }
+
+    /**
+     * @brief Run fit from numInits initializations and keep the model of
+     * lowest inertia. The restarts are trained concurrently over the shared
+     * points, in waves of restartsPerWave that each get a share of the
+     * threads. A restart that has not converged after restartPruneIterations
+     * iterations while its inertia is still above the best one of the earlier
+     * waves is abandoned. The best is only updated between waves, so the
+     * result does not depend on the number of threads.
+     *
+     * The first restart draws from rng like a single fit does, and every
+     * other one from a seed drawn from rng, so one initialization gives the
+     * model of fit.
+     *
+     * @param maxIterations Maximum number of iterations of every restart
+     * @param threshold The threshold to stop a restart - If the change in
+     * the centroids is less than this threshold, the restart stops
+     */
+    void fitRestarts(uint64_t maxIterations, double threshold) {
+        if (numClusters > numPoints) {
+            throw std::runtime_error(
+                "The number of clusters should not be greater than the number "
+                "of points");
+        }
+        PhaseTimer fitTimer;
+        if (telemetry.active()) {
+            fitTimer.lap();
+        }
+        uint64_t restarts = std::max<uint64_t>(numInits, 1);
+        std::vector<std::mt19937_64> generators(restarts, rng);
+        for (uint64_t r = 1; r < restarts; r++) {
+            generators[r].seed(rng());
+        }
+
+        uint64_t concurrent = std::min(restartsPerWave, threadPool().size());
+        uint64_t threadsPerRestart =
+            std::max<uint64_t>(1, threadPool().size() / concurrent);
+        ThreadPool wave(concurrent);
+        std::vector<std::unique_ptr<BasicKMeans>> candidates(restartsPerWave);
+        std::vector<double> candidateInertia(restartsPerWave);
+        std::unique_ptr<BasicKMeans> best;
+        double bestInertia = std::numeric_limits<double>::infinity();
+        for (uint64_t first = 0; first < restarts; first += restartsPerWave) {
+            uint64_t count = std::min(restartsPerWave, restarts - first);
+            wave.parallelFor(count, [&](uint64_t t) {
+                auto candidate = std::make_unique<BasicKMeans>(
+                    numClusters, numDims, numPoints, points);
+                candidate->setNumThreads(threadsPerRestart);
+                candidate->algorithm = algorithm;
+                candidate->initMethod = initMethod;
+                candidate->emptyClusterPolicy = emptyClusterPolicy;
+                candidate->inertiaTolerance = inertiaTolerance;
+                candidate->reassignedTolerance = reassignedTolerance;
+                candidate->rng = generators[first + t];
+                candidate->initializeCentroids();
+
+                // Check the restart after a few iterations; going on from
+                // there assigns the points exactly like one longer fit
+                uint64_t checkpoint =
+                    std::min(restartPruneIterations, maxIterations);
+                candidate->fitFromCentroids(checkpoint, threshold);
+                if (candidate->stopReason == StopReason::MaxIterations &&
+                    checkpoint < maxIterations) {
+                    if (candidate->inertia() > bestInertia) {
+                        return;
+                    }
+                    uint64_t iterations = candidate->iterationsRun;
+                    uint64_t computed = candidate->distanceComputations;
+                    uint64_t skipped = candidate->skippedDistanceComputations;
+                    candidate->fitFromCentroids(maxIterations - checkpoint,
+                                                threshold);
+                    candidate->iterationsRun += iterations;
+                    candidate->distanceComputations += computed;
+                    candidate->skippedDistanceComputations += skipped;
+                }
+                candidateInertia[t] = candidate->inertia();
+                candidates[t] = std::move(candidate);
+            });
+            for (uint64_t t = 0; t < count; t++) {
+                if (candidates[t] && candidateInertia[t] < bestInertia) {
+                    best = std::move(candidates[t]);
+                    bestInertia = candidateInertia[t];
+                }
+                candidates[t].reset();
+            }
+        }
+
+        // The first restart is never abandoned, so there is a best one
+        centroids = best->centroids;
+        points.labels = std::move(best->points.labels);
+        clusterSums = std::move(best->clusterSums);
+        clusterCounts = std::move(best->clusterCounts);
+        clusterWeights = std::move(best->clusterWeights);
+        iterationsRun = best->iterationsRun;
+        stopReason = best->stopReason;
+        distanceComputations = best->distanceComputations;
+        skippedDistanceComputations = best->skippedDistanceComputations;
+        centroidIndex.reset();
+        if (telemetry.active()) {
+            reportFit(fitTimer.lap());
+        }
+    }
+
+    /**
+     * @brief Run the iterations of fit starting from the current centroids
+     * instead of initializing them
+     *
+     * @param maxIterations Maximum number of iterations to run the algorithm
+     * @param threshold The threshold to stop the algorithm - If the change in
+     * the centroids is less than this threshold, the algorithm stops
+     */
+    void fitFromCentroids(uint64_t maxIterations, double threshold) {
+        Algorithm method = selectAlgorithm();
+        distanceComputations = 0;
+        uint64_t assignments = 0;
+        uint64_t iteration = 0;
+        // The metrics are only computed and the clocks only read when a
+        // callback receives them or a stopping criterion needs them
+        bool measure = telemetry.active();
+        bool needInertia = measure || inertiaTolerance > 0;
+        bool needReassigned = measure || reassignedTolerance > 0;
+        double previousInertia = 0;
+        PhaseTimer fitTimer;
+        PhaseTimer timer;
+        if (measure) {
+            fitTimer.lap();
+        }
+        stopReason = StopReason::MaxIterations;
+        while (iteration < maxIterations) {
+            IterationStats stats;
+            uint64_t computedBefore = distanceComputations;
+            // Lloyd measures the assignment in its fused pass; the other
+            // algorithms compare the labels and compute the inertia after it
+            bool fused = method == Algorithm::Lloyd;
+            if (needReassigned && !fused) {
+                previousLabels.assign(points.labels.begin(),
+                                      points.labels.end());
+            }
+            if (measure) {
+                timer.lap();
+            }
+
+            if (fused) {
+                assignAndAccumulate();
+                distanceComputations += numPoints * numClusters;
+            } else if (method == Algorithm::Gemm) {
+                assignPointsGemm(iteration == 0);
+                distanceComputations += numPoints * numClusters;
+            } else if (iteration == 0) {
+                initializeBounds(method);
+            } else {
+                assignPointsWithBounds(method);
+            }
+            assignments++;
+
+            if (measure) {
+                stats.assignSeconds = timer.lap();
+                stats.iteration = assignments;
+                stats.distanceComputations =
+                    distanceComputations - computedBefore;
+            }
+            // Not timed: the centroids have not moved yet, so this is the
+            // inertia of the assignment
+            if (needInertia) {
+                stats.inertia = fused ? assignmentInertia : inertia();
+            }
+            if (needReassigned) {
+                stats.reassigned = iteration == 0 ? numPoints
+                                   : fused        ? reassignedPoints
+                                                  : countReassigned();
+            }
+            if (measure && !fused) {
+                timer.lap();
+            }
+
+            // The old centroids become the previous ones, and every centroid
+            // is written again from the sums
+            swapCentroids();
+            if (!fused) {
+                clusterSums.assign(numClusters * numDims, 0);
+                clusterCounts.assign(numClusters, 0);
+                accumulateClusterSums(clusterSums, clusterCounts);
+            }
+            stats.reseeded = reseedEmptyClusters(
+                clusterSums, clusterCounts, previousCentroids, fused);
+            divideClusterSums(clusterSums, clusterCounts, previousCentroids);
+
+            // Calculate the maximum distance between the old and new centroids
+            double maxDistance = 0;
+            centroidShift.resize(numClusters);
+            for (uint64_t i = 0; i < numClusters; i++) {
+                double distance = kernel.squaredDistance(
+                    previousCentroids.row(i), centroids.row(i), numDims);
+                centroidShift[i] = std::sqrt(distance);
+                if (distance > maxDistance) {
+                    maxDistance = distance;
+                }
+            }
+            if (method == Algorithm::Hamerly || method == Algorithm::Elkan) {
+                updateBounds(method);
+            }
+            skippedDistanceComputations =
+                assignments * numPoints * numClusters - distanceComputations;
+            iterationsRun = assignments;
+
+            if (measure) {
+                stats.updateSeconds = timer.lap();
+                stats.maxSquaredShift = maxDistance;
+                if (telemetry.onIteration) {
+                    telemetry.onIteration(stats);
+                }
+            }
+
+            // If the maximum distance is less than the threshold, stop the
+            // algorithm
+            if (maxDistance < threshold) {
+                stopReason = StopReason::Threshold;
+                break;
+            }
+            // Stop when the assignment barely improves any more (a reseeded
+            // cluster always gets another iteration)
+            if (iteration > 0 && stats.reseeded == 0) {
+                if (inertiaTolerance > 0 &&
+                    previousInertia - stats.inertia <
+                        inertiaTolerance * previousInertia) {
+                    stopReason = StopReason::InertiaPlateau;
+                    break;
+                }
+                if (reassignedTolerance > 0 &&
+                    double(stats.reassigned) <
+                        reassignedTolerance * double(numPoints)) {
+                    stopReason = StopReason::FewReassigned;
+                    break;
+                }
+            }
+            previousInertia = stats.inertia;
+
+            iteration++;
+        }
+        clusterWeights.assign(clusterCounts.begin(), clusterCounts.end());
+        if (measure) {
+            reportFit(fitTimer.lap());
+        }
+    }
+
+    /**
+     * @brief Count the points whose label differs from previousLabels
+     *
+     * @return The number of points that changed cluster
+     */
+    uint64_t countReassigned() const {
+        uint64_t reassigned = 0;
+        for (uint64_t i = 0; i < numPoints; i++) {
+            reassigned += points.labels[i] != previousLabels[i];
+        }
+        return reassigned;
+    }
+
+    /**
+     * @brief Pass the summary of a training run to the telemetry
+     *
+     * @param seconds Time spent training
+     */
+    void reportFit(double seconds) {
+        if (telemetry.onFit) {
+            FitStats stats;
+            stats.iterations = iterationsRun;
+            stats.stopReason = stopReason;
+            stats.seconds = seconds;
+            telemetry.onFit(stats);
+        }
+    }
+
+    /**
+     * @brief Run the k-means algorithm over a dataset file that is read again
+     * in chunks at every iteration, so that only the centroids and the chunk
+     * buffers are in memory. The initial centroids are a uniform sample of the
+     * file (reservoir sampling), and the points are always assigned with
+     * Lloyd's algorithm since the bounds of Hamerly and Elkan need memory for
+     * every point.
+     *
+     * @param reader The reader of the dataset file
+     * @param maxIterations Maximum number of iterations to run the algorithm
+     * @param threshold The threshold to stop the algorithm - If the change in
+     * the centroids is less than this threshold, the algorithm stops
+     */
+    void fitStreaming(ChunkReader &reader, uint64_t maxIterations,
+                      double threshold) {
+        if (reader.numDims != numDims) {
+            throw std::runtime_error(
+                "The dataset does not have the dimensions of the model");
+        }
+        if (numClusters > reader.numPoints) {
+            throw std::runtime_error(
+                "The number of clusters should not be greater than the number "
+                "of points");
+        }
+
+        // Reservoir sampling: point t replaces a random centroid with
+        // probability numClusters / (t + 1)
+        forEachChunk<Scalar>(reader, [&](Dataset &chunk, uint64_t offset) {
+            for (uint64_t i = 0; i < chunk.numPoints; i++) {
+                uint64_t t = offset + i;
+                uint64_t slot =
+                    t < numClusters
+                        ? t
+                        : std::uniform_int_distribution<uint64_t>(0, t)(rng);
+                if (slot < numClusters) {
+                    const Scalar *point = chunk.row(i);
+                    Scalar *centroid = centroids.row(slot);
+                    for (uint64_t j = 0; j < numDims; j++) {
+                        centroid[j] = point[j];
+                    }
+                }
+            }
+        });
+
+        fitStreamingFromCentroids(reader, maxIterations, threshold);
+    }
+
+    /**
+     * @brief Run the iterations of fitStreaming starting from the current
+     * centroids instead of sampling them
+     *
+     * @param reader The reader of the dataset file
+     * @param maxIterations Maximum number of iterations to run the algorithm
+     * @param threshold The threshold to stop the algorithm - If the change in
+     * the centroids is less than this threshold, the algorithm stops
+     */
+    void fitStreamingFromCentroids(ChunkReader &reader, uint64_t maxIterations,
+                                   double threshold) {
+        if (reader.numDims != numDims) {
+            throw std::runtime_error(
+                "The dataset does not have the dimensions of the model");
+        }
+        std::vector<double> sums(numClusters * numDims);
+        std::vector<uint64_t> counts(numClusters);
+        PhaseTimer fitTimer;
+        if (telemetry.active()) {
+            fitTimer.lap();
+        }
+        stopReason = StopReason::MaxIterations;
+        uint64_t iteration = 0;
+        while (iteration < maxIterations) {
+            std::fill(sums.begin(), sums.end(), 0);
+            std::fill(counts.begin(), counts.end(), 0);
+            forEachChunk<Scalar>(reader, [&](Dataset &chunk, uint64_t) {
+                withPoints(chunk, [&] {
+                    assignPointsToCentroids();
+                    accumulateClusterSums(sums, counts);
+                });
+            });
+
+            rememberCentroids();
+            divideClusterSums(sums, counts, previousCentroids);
+
+            // Calculate the maximum distance between the old and new centroids
+            double maxDistance = 0;
+            for (uint64_t i = 0; i < numClusters; i++) {
+                double distance = kernel.squaredDistance(
+                    previousCentroids.row(i), centroids.row(i), numDims);
+                if (distance > maxDistance) {
+                    maxDistance = distance;
+                }
+            }
+            iteration++;
+            if (maxDistance < threshold) {
+                stopReason = StopReason::Threshold;
+                break;
+            }
+        }
+        iterationsRun = iteration;
+        clusterWeights.assign(counts.begin(), counts.end());
+        if (telemetry.active()) {
+            reportFit(fitTimer.lap());
+        }
+    }
+
+    /**
+     * @brief Predict the cluster of every point of a dataset file that is read
+     * in chunks, and save the predictions to a file. Reading the next chunk,
+     * assigning the current one and writing the previous one overlap.
+     *
+     * @param reader The reader of the dataset file
+     * @param filename The name of the file to save the predictions to
+     * @param options The format of the file and whether distances are saved
+     */
+    void savePredictionsStreaming(ChunkReader &reader, std::string filename,
+                                  const PredictionOptions &options = {}) {
+        if (reader.numDims != numDims) {
+            throw std::runtime_error(
+                "The dataset does not have the dimensions of the model");
+        }
+        PredictionWriter writer(filename, precisionOf<Scalar>,
+                                reader.numPoints, options, threadPool());
+        std::vector<double> distances(options.distances ? reader.chunkSize
+                                                        : 0);
+        forEachChunk<Scalar>(reader, [&](Dataset &chunk, uint64_t) {
+            predictRange(chunk, 0, chunk.numPoints, chunk.labels.data(),
+                         options.distances ? distances.data() : nullptr);
+            // The writer formats the labels before returning, so the chunk
+            // can be read into again
+            writer.write(chunk.labels.data(), distances.data(),
+                         chunk.numPoints);
+        });
+        writer.close();
+    }
+
+    /**
+     * @brief Run a function with a chunk of points in place of the points of
+     * the model
+     *
+     * @param chunk The points to use (their labels are updated)
+     * @param function The function to run
+     */
+    template <typename Function>
+    void withPoints(Dataset &chunk, Function function) {
+        std::swap(points, chunk);
+        uint64_t savedNumPoints = numPoints;
+        numPoints = points.numPoints;
+        try {
+            function();
+        } catch (...) {
+            std::swap(points, chunk);
+            numPoints = savedNumPoints;
+            throw;
+        }
+        std::swap(points, chunk);
+        numPoints = savedNumPoints;
+    }
+
+    /**
+     * @brief Fold a batch of new points into the centroids (online update):
+     * the points are assigned to the current centroids, and every centroid
+     * becomes the weighted mean of its previous points, whose weight is
+     * multiplied by decay first, and of its new points. With a decay of 1,
+     * each centroid stays the exact mean of all the points ever assigned to
+     * it; a smaller decay forgets old points so that the model follows drift.
+     * The index of the centroids, if any, is dropped since it would be stale.
+     *
+     * @param batch The new points (their labels are updated)
+     * @param decay Factor in (0, 1] applied to the previous weights
+     */
+    void updateOnline(Dataset &batch, double decay) {
+        if (!(decay > 0 && decay <= 1)) {
+            throw std::runtime_error("The decay should be in (0, 1]");
+        }
+        if (batch.numDims != numDims) {
+            throw std::runtime_error(
+                "The dataset does not have the dimensions of the model");
+        }
+        if (clusterWeights.size() != numClusters) {
+            throw std::runtime_error(
+                "The model has no cluster weights; train it again (e.g. with "
+                "--resume) before updating it");
+        }
+        batch.labels.resize(batch.numPoints);
+        clusterSums.assign(numClusters * numDims, 0);
+        clusterCounts.assign(numClusters, 0);
+        withPoints(batch, [&] {
+            assignPointsToCentroids();
+            accumulateClusterSums(clusterSums, clusterCounts);
+        });
+        for (uint64_t i = 0; i < numClusters; i++) {
+            double previous = decay * clusterWeights[i];
+            double total = previous + double(clusterCounts[i]);
+            if (clusterCounts[i] > 0) {
+                Scalar *centroid = centroids.row(i);
+                const double *sum = clusterSums.data() + i * numDims;
+                for (uint64_t j = 0; j < numDims; j++) {
+                    centroid[j] = Scalar(
+                        (previous * double(centroid[j]) + sum[j]) / total);
+                }
+            }
+            clusterWeights[i] = total;
+        }
+        centroidIndex.reset();
+    }
+
+    /**
+     * @brief Run mini-batch k-means (Sculley, 2010): every step assigns a
+     * random batch of points and moves each centroid towards its points with a
+     * per-centroid learning rate of 1 / (number of points it has seen). The
+     * points are labeled with one full assignment pass at the end.
+     *
+     * @param batchSize Number of points sampled (with replacement) per step
+     * @param maxSteps Maximum number of steps
+     * @param tolerance Minimum relative improvement of the smoothed batch
+     * inertia that counts as progress (0 disables early stopping)
+     * @param patience Number of steps without progress after which training
+     * stops
+     */
+    void fitMiniBatch(uint64_t batchSize, uint64_t maxSteps, double tolerance,
+                      uint64_t patience) {
+        initializeCentroids();
+        if (batchSize > numPoints) {
+            batchSize = numPoints;
+        }
+
+        std::vector<uint64_t> seen(numClusters, 0);
+        // The centroids are moved in double and rounded to Scalar after every
+        // step, so that small learning rates are not lost to float rounding
+        std::vector<double> runningCentroids(
+            centroids.coordinates, centroids.coordinates + numClusters * numDims);
+        std::vector<uint64_t> batch(batchSize);
+        std::vector<uint64_t> batchLabels(batchSize);
+        std::vector<double> batchDistances(batchSize);
+        std::vector<uint64_t> clusterStart(numClusters + 1);
+        std::vector<uint64_t> byCluster(batchSize);
+
+        // Weight of a batch in the exponentially smoothed inertia
+        double alpha = std::min(1.0, 2.0 * double(batchSize) /
+                                         double(numPoints + 1));
+        double smoothedInertia = 0;
+        double bestInertia = INFINITY;
+        uint64_t stepsWithoutProgress = 0;
+        PhaseTimer fitTimer;
+        if (telemetry.active()) {
+            fitTimer.lap();
+        }
+        stopReason = StopReason::MaxIterations;
+
+        uint64_t step = 0;
+        while (step < maxSteps) {
+            for (uint64_t b = 0; b < batchSize; b++) {
+                batch[b] = std::uniform_int_distribution<uint64_t>(
+                    0, numPoints - 1)(rng);
+            }
+
+            // Assign the batch
+            uint64_t numBlocks = (batchSize + blockSize - 1) / blockSize;
+            threadPool().parallelFor(numBlocks, [&](uint64_t block) {
+                uint64_t end = std::min(batchSize, (block + 1) * blockSize);
+                for (uint64_t b = block * blockSize; b < end; b++) {
+                    batchDistances[b] = std::numeric_limits<double>::infinity();
+                    batchLabels[b] = kernel.nearestCentroid(
+                        points.row(batch[b]), centroids.coordinates,
+                        numClusters, numDims, batchDistances[b]);
+                }
+            });
+            double batchInertia = 0;
+            for (uint64_t b = 0; b < batchSize; b++) {
+                batchInertia += batchDistances[b];
+            }
+            batchInertia /= double(batchSize);
+
+            // Group the batch by cluster, keeping the batch order inside each
+            // cluster, so that the centroids can be updated in parallel and
+            // still give the same result as a sequential update
+            std::fill(clusterStart.begin(), clusterStart.end(), 0);
+            for (uint64_t b = 0; b < batchSize; b++) {
+                clusterStart[batchLabels[b] + 1]++;
+            }
+            for (uint64_t c = 0; c < numClusters; c++) {
+                clusterStart[c + 1] += clusterStart[c];
+            }
+            for (uint64_t b = 0; b < batchSize; b++) {
+                byCluster[clusterStart[batchLabels[b]]++] = b;
+            }
+            for (uint64_t c = numClusters; c > 0; c--) {
+                clusterStart[c] = clusterStart[c - 1];
+            }
+            clusterStart[0] = 0;
+
+            threadPool().parallelFor(numClusters, [&](uint64_t c) {
+                double *running = runningCentroids.data() + c * numDims;
+                for (uint64_t k = clusterStart[c]; k < clusterStart[c + 1];
+                     k++) {
+                    const Scalar *point = points.row(batch[byCluster[k]]);
+                    seen[c]++;
+                    double rate = 1.0 / double(seen[c]);
+                    for (uint64_t j = 0; j < numDims; j++) {
+                        running[j] += rate * (double(point[j]) - running[j]);
+                    }
+                }
+                Scalar *centroid = centroids.row(c);
+                for (uint64_t j = 0; j < numDims; j++) {
+                    centroid[j] = Scalar(running[j]);
+                }
+            });
+            step++;
+
+            // Early stopping on the smoothed inertia
+            smoothedInertia = step == 1 ? batchInertia
+                                        : alpha * batchInertia +
+                                              (1 - alpha) * smoothedInertia;
+            if (smoothedInertia < bestInertia * (1 - tolerance)) {
+                bestInertia = smoothedInertia;
+                stepsWithoutProgress = 0;
+            } else if (tolerance > 0 && ++stepsWithoutProgress >= patience) {
+                stopReason = StopReason::NoProgress;
+                break;
+            }
+        }
+        iterationsRun = step;
+        clusterWeights.assign(seen.begin(), seen.end());
+        if (telemetry.active()) {
+            reportFit(fitTimer.lap());
+        }
+
+        assignPointsToCentroids();
+    }
+
+    /**
+     * @brief Resolve Algorithm::Auto to the algorithm used by fit
+     *
+     * @return The assignment algorithm
+     */
+    Algorithm selectAlgorithm() const {
+        if (algorithm != Algorithm::Auto) {
+            return algorithm;
+        }
+        uint64_t elkanBytes = numPoints * numClusters * sizeof(double);
+        if (numClusters >= elkanMinClusters && numDims >= elkanMinDims &&
+            elkanBytes <= elkanMemoryBudget) {
+            return Algorithm::Elkan;
+        }
+        return Algorithm::Hamerly;
+    }
+
+    /**
+     * @brief Check whether a distance that is at least lower is larger than a
+     * distance that is at most upper, with a margin for rounding errors
+     *
+     */
+    static bool clearlyFarther(double lower, double upper) {
+        return lower * (1 - boundMargin) > upper * (1 + boundMargin);
+    }
+
+    /**
+     * @brief Assign the points by computing all the distances, and set the
+     * bounds used by the Hamerly or Elkan algorithm
+     *
+     * @param method Algorithm::Hamerly or Algorithm::Elkan
+     */
+    void initializeBounds(Algorithm method) {
+        upperBounds.resize(numPoints);
+        lowerBounds.resize(method == Algorithm::Elkan ? numPoints * numClusters
+                                                      : numPoints);
+        uint64_t numBlocks = (numPoints + blockSize - 1) / blockSize;
+        threadPool().parallelFor(numBlocks, [&](uint64_t block) {
+            uint64_t end = std::min(numPoints, (block + 1) * blockSize);
+            for (uint64_t i = block * blockSize; i < end; i++) {
+                scanAllCentroids(i, method);
+            }
+        });
+        distanceComputations += numPoints * numClusters;
+    }
+
+    /**
+     * @brief Compute the distance from a point to every centroid, assign the
+     * point to the nearest one and reset its bounds
+     *
+     * @param i Index of the point
+     * @param method Algorithm::Hamerly or Algorithm::Elkan
+     */
+    void scanAllCentroids(uint64_t i, Algorithm method) {
+        const Scalar *point = points.row(i);
+        double minDistance = std::numeric_limits<double>::infinity();
+        double secondDistance = INFINITY;
+        uint64_t cluster = 0;
+        for (uint64_t j = 0; j < numClusters; j++) {
+            double distance =
+                kernel.squaredDistance(point, centroids.row(j), numDims);
+            if (method == Algorithm::Elkan) {
+                lowerBounds[i * numClusters + j] = std::sqrt(distance);
+            }
+            if (distance < minDistance) {
+                secondDistance = std::min(secondDistance, minDistance);
+                minDistance = distance;
+                cluster = j;
+            } else if (distance < secondDistance) {
+                secondDistance = distance;
+            }
+        }
+        points.labels[i] = cluster;
+        upperBounds[i] = std::sqrt(minDistance);
+        if (method == Algorithm::Hamerly) {
+            lowerBounds[i] = std::sqrt(secondDistance);
+        }
+    }
+
+    /**
+     * @brief Assign the points to the nearest centroid, skipping the distances
+     * that the bounds prove cannot change the assignment
+     *
+     * @param method Algorithm::Hamerly or Algorithm::Elkan
+     */
+    void assignPointsWithBounds(Algorithm method) {
+        // Half distances between the centroids: a point closer to its centroid
+        // than half the distance to another centroid cannot move to it
+        centroidDistances.resize(numClusters * numClusters);
+        halfMinDistance.resize(numClusters);
+        threadPool().parallelFor(numClusters, [&](uint64_t a) {
+            double nearest = INFINITY;
+            for (uint64_t b = 0; b < numClusters; b++) {
+                double distance =
+                    a == b ? 0
+                           : 0.5 * std::sqrt(kernel.squaredDistance(
+                                       centroids.row(a), centroids.row(b),
+                                       numDims));
+                centroidDistances[a * numClusters + b] = distance;
+                if (a != b && distance < nearest) {
+                    nearest = distance;
+                }
+            }
+            halfMinDistance[a] = nearest;
+        });
+
+        uint64_t numBlocks = (numPoints + blockSize - 1) / blockSize;
+        blockCounts.assign(numBlocks, 0);
+        threadPool().parallelFor(numBlocks, [&](uint64_t block) {
+            uint64_t end = std::min(numPoints, (block + 1) * blockSize);
+            for (uint64_t i = block * blockSize; i < end; i++) {
+                blockCounts[block] += method == Algorithm::Elkan
+                                          ? assignPointElkan(i)
+                                          : assignPointHamerly(i);
+            }
+        });
+        for (uint64_t block = 0; block < numBlocks; block++) {
+            distanceComputations += blockCounts[block];
+        }
+    }
+
+    /**
+     * @brief Assign one point with the bounds of the Hamerly algorithm
+     *
+     * @param i Index of the point
+     * @return The number of distances computed
+     */
+    uint64_t assignPointHamerly(uint64_t i) {
+        uint64_t cluster = points.labels[i];
+        double bound = std::max(halfMinDistance[cluster], lowerBounds[i]);
+        if (clearlyFarther(bound, upperBounds[i])) {
+            return 0;
+        }
+
+        // Tighten the upper bound and check again
+        upperBounds[i] = std::sqrt(kernel.squaredDistance(
+            points.row(i), centroids.row(cluster), numDims));
+        if (clearlyFarther(bound, upperBounds[i])) {
+            return 1;
+        }
+
+        scanAllCentroids(i, Algorithm::Hamerly);
+        return 1 + numClusters;
+    }
+
+    /**
+     * @brief Assign one point with the bounds of the Elkan algorithm
+     *
+     * @param i Index of the point
+     * @return The number of distances computed
+     */
+    uint64_t assignPointElkan(uint64_t i) {
+        uint64_t cluster = points.labels[i];
+        double upper = upperBounds[i];
+        if (clearlyFarther(halfMinDistance[cluster], upper)) {
+            return 0;
+        }
+
+        const Scalar *point = points.row(i);
+        double *lower = lowerBounds.data() + i * numClusters;
+        uint64_t computed = 0;
+        bool tight = false;  // whether upper is the exact distance
+        double clusterDistance = 0;  // squared distance to cluster when tight
+        for (uint64_t j = 0; j < numClusters; j++) {
+            if (j == cluster) {
+                continue;
+            }
+            double bound =
+                std::max(lower[j], centroidDistances[cluster * numClusters + j]);
+            if (clearlyFarther(bound, upper)) {
+                continue;
+            }
+            if (!tight) {
+                clusterDistance = kernel.squaredDistance(
+                    point, centroids.row(cluster), numDims);
+                upper = std::sqrt(clusterDistance);
+                lower[cluster] = upper;
+                tight = true;
+                computed++;
+                if (clearlyFarther(bound, upper)) {
+                    continue;
+                }
+            }
+            double distance =
+                kernel.squaredDistance(point, centroids.row(j), numDims);
+            lower[j] = std::sqrt(distance);
+            computed++;
+            // Break ties towards the lower index like assignPoint does
+            if (distance < clusterDistance ||
+                (distance == clusterDistance && j < cluster)) {
+                cluster = j;
+                clusterDistance = distance;
+                upper = lower[j];
+            }
+        }
+        points.labels[i] = cluster;
+        upperBounds[i] = upper;
+        return computed;
+    }
+
+    /**
+     * @brief Move the bounds by the distance that the centroids moved in the
+     * last update
+     *
+     * @param method Algorithm::Hamerly or Algorithm::Elkan
+     */
+    void updateBounds(Algorithm method) {
+        // The largest and second largest shifts (Hamerly)
+        uint64_t largest = 0;
+        double secondShift = 0;
+        for (uint64_t j = 1; j < numClusters; j++) {
+            if (centroidShift[j] > centroidShift[largest]) {
+                secondShift = centroidShift[largest];
+                largest = j;
+            } else if (centroidShift[j] > secondShift) {
+                secondShift = centroidShift[j];
+            }
+        }
+
+        uint64_t numBlocks = (numPoints + blockSize - 1) / blockSize;
+        threadPool().parallelFor(numBlocks, [&](uint64_t block) {
+            uint64_t end = std::min(numPoints, (block + 1) * blockSize);
+            for (uint64_t i = block * blockSize; i < end; i++) {
+                uint64_t cluster = points.labels[i];
+                upperBounds[i] += centroidShift[cluster];
+                if (method == Algorithm::Hamerly) {
+                    lowerBounds[i] -= cluster == largest ? secondShift
+                                                         : centroidShift[largest];
+                } else {
+                    double *lower = lowerBounds.data() + i * numClusters;
+                    for (uint64_t j = 0; j < numClusters; j++) {
+                        lower[j] = std::max(0.0, lower[j] - centroidShift[j]);
+                    }
+                }
+            }
+        });
+    }
+
+    /**
+     * @brief Predict the cluster of every point and save the predictions to a
+     * file. The points are assigned predictionChunk at a time, and every
+     * chunk is written while the next one is assigned.
+     *
+     * @param filename The name of the file to save the predictions to
+     * @param options The format of the file and whether distances are saved
+     */
+    void savePredictions(std::string filename,
+                         const PredictionOptions &options = {}) {
+        if (points.numDims != numDims) {
+            throw std::runtime_error(
+                "The dataset does not have the dimensions of the model");
+        }
+        PredictionWriter writer(filename, precisionOf<Scalar>, numPoints,
+                                options, threadPool());
+        std::vector<double> distances(
+            options.distances ? std::min(numPoints, predictionChunk) : 0);
+        for (uint64_t begin = 0; begin < numPoints; begin += predictionChunk) {
+            uint64_t end = std::min(numPoints, begin + predictionChunk);
+            predictRange(points, begin, end, points.labels.data() + begin,
+                         options.distances ? distances.data() : nullptr);
+            writer.write(points.labels.data() + begin, distances.data(),
+                         end - begin);
+        }
+        writer.close();
+    }
+
+    /**
+     * @brief Calculate the inertia of the model (sum of squared distances of
+     * samples to their closest cluster center)
+     *
+     * @return The intertia of the model
+     */
+    double inertia() {
+        uint64_t partitions = numPartitions();
+        std::vector<double> partialInertia(partitions, 0);
+        threadPool().parallelFor(partitions, [&](uint64_t p) {
+            uint64_t end = (p + 1) * numPoints / partitions;
+            for (uint64_t i = p * numPoints / partitions; i < end; i++) {
+                partialInertia[p] += kernel.squaredDistance(
+                    points.row(i), centroids.row(points.labels[i]), numDims);
+            }
+        });
+
+        // Add the partitions in order so that the result does not depend on
+        // the number of threads
+        double inertia = 0;
+        for (uint64_t p = 0; p < partitions; p++) {
+            inertia += partialInertia[p];
+        }
+        return inertia;
+    }
+
+    /**
+     * @brief Calculate the inertia of every cluster (sum of squared distances
+     * of its samples to its center)
+     *
+     * @return The inertia of each cluster
+     */
+    std::vector<double> clusterInertia() {
+        uint64_t partitions = numPartitions();
+        std::vector<double> partialInertia(partitions * numClusters, 0);
+        threadPool().parallelFor(partitions, [&](uint64_t p) {
+            double *partial = partialInertia.data() + p * numClusters;
+            uint64_t end = (p + 1) * numPoints / partitions;
+            for (uint64_t i = p * numPoints / partitions; i < end; i++) {
+                uint64_t cluster = points.labels[i];
+                partial[cluster] += kernel.squaredDistance(
+                    points.row(i), centroids.row(cluster), numDims);
+            }
+        });
+
+        // Add the partitions in order so that the result does not depend on
+        // the number of threads
+        std::vector<double> inertia(numClusters, 0);
+        for (uint64_t p = 0; p < partitions; p++) {
+            for (uint64_t c = 0; c < numClusters; c++) {
+                inertia[c] += partialInertia[p * numClusters + c];
+            }
+        }
+        return inertia;
+    }
+
+    /**
+     * @brief Save the model to a file, and its index (if any) to the file
+     * with ".index" appended. Without an index, an index file left there by
+     * the model being replaced is removed. The file is written under a
+     * temporary name and then renamed, so the model being replaced may still
+     * be mapped.
+     *
+     * @param filename The name of the file to save the model to
+     * @param format Text (readable, with enough digits to read back every
+     * coordinate exactly) or
+     * binary (exact, checksummed and loaded with mmap; see BinaryModelHeader)
+     */
+    void saveModel(std::string filename,
+                   ModelFormat format = ModelFormat::Text) {
+        if (format == ModelFormat::Binary) {
+            writeBinaryModel(filename, centroids, clusterWeights);
+        } else {
+            std::string temporary = filename + ".tmp";
+            std::ofstream file(temporary);
+            writePrecisionHeader(file, precisionOf<Scalar>);
+            // First line is number of clusters, second number of dimensions
+            file << numClusters << std::endl;
+            file << numDims << std::endl;
+            // Next lines are the coordinates of the centroids, with the digits
+            // that read them back exactly
+            file.precision(std::numeric_limits<Scalar>::max_digits10);
+            for (uint64_t i = 0; i < numClusters; i++) {
+                const Scalar *centroid = centroids.row(i);
+                for (uint64_t j = 0; j < numDims; j++) {
+                    file << centroid[j] << " ";
+                }
+                file << std::endl;
+            }
+            // Then the weights of the centroids, if they are known
+            if (clusterWeights.size() == numClusters) {
+                file << "# weights" << std::endl;
+                file.precision(std::numeric_limits<double>::max_digits10);
+                for (uint64_t i = 0; i < numClusters; i++) {
+                    file << clusterWeights[i] << " ";
+                }
+                file << std::endl;
+            }
+            file.close();
+            if (!file ||
+                std::rename(temporary.c_str(), filename.c_str()) != 0) {
+                throw std::runtime_error("Could not write the model");
+            }
+        }
+
+        // The index is kept next to the model
+        if (centroidIndex) {
+            centroidIndex->save(filename + ".index");
+        } else {
+            std::remove((filename + ".index").c_str());
+        }
+    }
+
+    /**
+     * @brief Load the model from a file, text or binary (detected from the
+     * start of the file). A model saved in the other precision is converted
+     * to Scalar.
+     *
+     * @param filename The name of the file to load the model from
+     */
+    void loadModel(std::string filename) {
+        if (isBinaryModel(filename)) {
+            loadBinaryModel(filename);
+            return;
+        }
+        std::ifstream file(filename);
+        if (!file.is_open()) {
+            throw std::runtime_error("Could not open the file");
+        }
+        readPrecisionHeader(file);
+        file >> numClusters;  // First line is number of clusters
+        file >> numDims;      // Second line is number of dimensions
+        this->numClusters = numClusters;
+        this->numDims = numDims;
+        centroids = Dataset(numClusters, numDims);
+        kernel = selectDistanceKernel<Scalar>(numDims);
+        // Next lines are the coordinates of the centroids
+        for (uint64_t i = 0; i < numClusters * numDims; i++) {
+            file >> centroids.coordinates[i];
+        }
+        // The weights of the centroids are optional
+        clusterWeights.clear();
+        std::string line;
+        if (file >> std::ws && std::getline(file, line) &&
+            line == "# weights") {
+            clusterWeights.resize(numClusters);
+            for (uint64_t i = 0; i < numClusters; i++) {
+                if (!(file >> clusterWeights[i])) {
+                    throw std::runtime_error("Could not read the weights");
+                }
+            }
+        }
+        file.close();
+    }
+
+    /**
+     * @brief Load a binary model. If it stores Scalar, the centroids are used
+     * where the file is mapped: nothing is parsed or copied. The mapping is
+     * private, so training the loaded model never changes the file.
+     *
+     * @param filename The name of the file to load the model from
+     */
+    void loadBinaryModel(const std::string &filename) {
+        BinaryModelFile model = openBinaryModel(filename);
+        const BinaryModelHeader &header = model.header;
+        this->numClusters = header.numClusters;
+        this->numDims = header.numDims;
+        kernel = selectDistanceKernel<Scalar>(numDims);
+        const char *data = model.data.get();
+        if (header.dtype == BinaryDatasetHeader::dtypeOf<Scalar>) {
+            std::shared_ptr<Scalar> storage(
+                model.data, reinterpret_cast<Scalar *>(model.data.get() +
+                                                       header.centroidOffset));
+            centroids = Dataset(numClusters, numDims, storage);
+        } else {
+            centroids = Dataset(numClusters, numDims);
+            for (uint64_t i = 0; i < numClusters * numDims; i++) {
+                if (header.dtype == BinaryDatasetHeader::float32) {
+                    float value;
+                    std::memcpy(&value,
+                                data + header.centroidOffset + i * sizeof(value),
+                                sizeof(value));
+                    centroids.coordinates[i] = Scalar(value);
+                } else {
+                    double value;
+                    std::memcpy(&value,
+                                data + header.centroidOffset + i * sizeof(value),
+                                sizeof(value));
+                    centroids.coordinates[i] = Scalar(value);
+                }
+            }
+        }
+        // The weights of the centroids are optional
+        clusterWeights.clear();
+        if (header.weightsOffset != 0) {
+            clusterWeights.resize(numClusters);
+            std::memcpy(clusterWeights.data(), data + header.weightsOffset,
+                        numClusters * sizeof(double));
+        }
+    }
+};
+
+using KMeans = BasicKMeans<double>;
+using FloatKMeans = BasicKMeans<float>;
@@ -9,60 +9,601 @@
  *
  */
 
+#include <fstream>
 #include <iostream>
+#include <memory>
 #include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
 
 #include "blob_generator.hpp"
+#include "distributed.hpp"
 #include "kmeans.hpp"
+#include "serve.hpp"
 #include "utils.hpp"
 
 /**
- * @brief Entry point of the program for the K-means clustering algorithm
+ * @brief What convert reads from its input file
+ */
+enum class ConvertInput {
+    Auto,         // a model if the file is recognized as one, else a dataset
+    DatasetFile,  // a dataset, written in the binary format
+    ModelFile     // a model (a text model may lack the precision line of
+                  // the current format), written in the format of
+                  // --model-format
+};
+
+/**
+ * @brief Options that can be given anywhere on the command line in the form
+ * --name=value
+ */
+struct Options {
+    uint64_t numThreads = 1;  // number of threads used to train and predict
+    Algorithm algorithm = Algorithm::Lloyd;  // assignment algorithm of fit
+    InitMethod initMethod = InitMethod::Random;  // initialization of fit
+    uint64_t seed = 0;  // seed of the random number generator
+    uint64_t numInits = 1;  // initializations tried, of which the best is kept
+    EmptyClusterPolicy emptyClusters = EmptyClusterPolicy::Farthest;
+    double inertiaTolerance = 0;  // relative inertia improvement to go on
+    double reassignedTolerance = 0;  // fraction of changed labels to go on
+    uint64_t patience = 10;  // mini-batch steps without progress before stop
+    uint64_t chunkSize = 0;  // points per chunk when streaming (0: no stream)
+    Precision precision = Precision::Float64;  // type of the coordinates
+    bool elbowWarmStart = false;  // warm-start each k of the elbow method
+    uint64_t elbowPatience = 0;  // flat values of k before the elbow stops
+    bool distances = false;  // whether predictions include the distances
+    PredictionFormat predictionFormat = PredictionFormat::Text;  // format of
+                                                                 // predictions
+    bool index = false;  // whether prediction uses an index of the centroids
+    uint64_t indexLists = 0;  // lists of the index (0: sqrt of the clusters)
+    uint64_t probes = 8;  // lists of the index searched for a point
+    std::string resumeFile;  // model whose centroids training starts from
+    ModelFormat modelFormat = ModelFormat::Text;  // format of saved models
+    bool modelFormatGiven = false;  // whether --model-format was given
+    ConvertInput convertInput = ConvertInput::Auto;  // what convert reads
+    bool verifyModel = false;  // whether binary models are checksummed
+    double decay = 1;  // weight kept by the old points of an online update
+    BlobOptions blobs;  // distribution and format of generated blobs
+    std::string telemetryFile;  // JSON lines of the training metrics ("-":
+                                // standard error, empty: none)
+};
+
+/**
+ * @brief Parse the options and remove them from the arguments
  *
  * @param argc number of arguments
  * @param argv array of arguments
+ * @param options The options to fill
+ * @return The arguments that are not options (starting with the program name)
+ */
+std::vector<char *> parseOptions(int argc, char *argv[], Options &options) {
+    std::vector<char *> positional;
+    for (int i = 0; i < argc; i++) {
+        std::string arg = argv[i];
+        if (i == 0 || arg.rfind("--", 0) != 0) {
+            positional.push_back(argv[i]);
+            continue;
+        }
+        std::string::size_type equals = arg.find('=');
+        if (equals == std::string::npos) {
+            throw std::runtime_error("Option " + arg +
+                                     " should be given as " + arg + "=value");
+        }
+        std::string name = arg.substr(2, equals - 2);
+        std::string value = arg.substr(equals + 1);
+        if (name == "threads") {
+            options.numThreads = std::stoul(value);
+        } else if (name == "algorithm") {
+            if (value == "lloyd") {
+                options.algorithm = Algorithm::Lloyd;
+            } else if (value == "hamerly") {
+                options.algorithm = Algorithm::Hamerly;
+            } else if (value == "elkan") {
+                options.algorithm = Algorithm::Elkan;
+            } else if (value == "gemm") {
+                options.algorithm = Algorithm::Gemm;
+            } else if (value == "auto") {
+                options.algorithm = Algorithm::Auto;
+            } else {
+                throw std::runtime_error("Unknown algorithm " + value);
+            }
+        } else if (name == "init") {
+            if (value == "random") {
+                options.initMethod = InitMethod::Random;
+            } else if (value == "kmeans++") {
+                options.initMethod = InitMethod::KMeansPlusPlus;
+            } else if (value == "kmeans||") {
+                options.initMethod = InitMethod::KMeansParallel;
+            } else {
+                throw std::runtime_error("Unknown initialization " + value);
+            }
+        } else if (name == "seed") {
+            options.seed = std::stoul(value);
+        } else if (name == "n-init") {
+            options.numInits = std::stoul(value);
+            if (options.numInits == 0) {
+                throw std::runtime_error("Option --n-init should be at least 1");
+            }
+        } else if (name == "empty-clusters") {
+            if (value == "farthest") {
+                options.emptyClusters = EmptyClusterPolicy::Farthest;
+            } else if (value == "split") {
+                options.emptyClusters = EmptyClusterPolicy::SplitLargest;
+            } else if (value == "keep") {
+                options.emptyClusters = EmptyClusterPolicy::Keep;
+            } else {
+                throw std::runtime_error("Unknown empty cluster policy " +
+                                         value);
+            }
+        } else if (name == "inertia-tolerance") {
+            options.inertiaTolerance = std::stod(value);
+        } else if (name == "reassigned-tolerance") {
+            options.reassignedTolerance = std::stod(value);
+        } else if (name == "patience") {
+            options.patience = std::stoul(value);
+        } else if (name == "chunk-size") {
+            options.chunkSize = std::stoul(value);
+        } else if (name == "precision") {
+            options.precision = parsePrecision(value);
+        } else if (name == "elbow") {
+            if (value == "parallel") {
+                options.elbowWarmStart = false;
+            } else if (value == "warm") {
+                options.elbowWarmStart = true;
+            } else {
+                throw std::runtime_error("Unknown elbow search " + value);
+            }
+        } else if (name == "elbow-patience") {
+            options.elbowPatience = std::stoul(value);
+        } else if (name == "index") {
+            if (value == "ivf") {
+                options.index = true;
+            } else if (value == "none") {
+                options.index = false;
+            } else {
+                throw std::runtime_error("Unknown index " + value);
+            }
+        } else if (name == "index-lists") {
+            options.indexLists = std::stoul(value);
+        } else if (name == "probes") {
+            options.probes = std::stoul(value);
+        } else if (name == "resume") {
+            options.resumeFile = value;
+        } else if (name == "decay") {
+            options.decay = std::stod(value);
+        } else if (name == "blob-shape") {
+            if (value == "uniform") {
+                options.blobs.shape = BlobShape::Uniform;
+            } else if (value == "gaussian") {
+                options.blobs.shape = BlobShape::Gaussian;
+            } else {
+                throw std::runtime_error("Unknown blob shape " + value);
+            }
+        } else if (name == "spread") {
+            options.blobs.spread = std::stod(value);
+        } else if (name == "imbalance") {
+            options.blobs.imbalance = std::stod(value);
+        } else if (name == "format") {
+            if (value == "text") {
+                options.blobs.binary = false;
+            } else if (value == "binary") {
+                options.blobs.binary = true;
+            } else {
+                throw std::runtime_error("Unknown format " + value);
+            }
+        } else if (name == "model-format") {
+            if (value == "text") {
+                options.modelFormat = ModelFormat::Text;
+            } else if (value == "binary") {
+                options.modelFormat = ModelFormat::Binary;
+            } else {
+                throw std::runtime_error("Unknown model format " + value);
+            }
+            options.modelFormatGiven = true;
+        } else if (name == "convert") {
+            if (value == "auto") {
+                options.convertInput = ConvertInput::Auto;
+            } else if (value == "dataset") {
+                options.convertInput = ConvertInput::DatasetFile;
+            } else if (value == "model") {
+                options.convertInput = ConvertInput::ModelFile;
+            } else {
+                throw std::runtime_error("Unknown convert input " + value);
+            }
+        } else if (name == "telemetry") {
+            options.telemetryFile = value;
+        } else if (name == "prediction-format") {
+            if (value == "text") {
+                options.predictionFormat = PredictionFormat::Text;
+            } else if (value == "binary") {
+                options.predictionFormat = PredictionFormat::Binary;
+            } else {
+                throw std::runtime_error("Unknown prediction format " + value);
+            }
+        } else if (name == "distances") {
+            if (value == "yes") {
+                options.distances = true;
+            } else if (value == "no") {
+                options.distances = false;
+            } else {
+                throw std::runtime_error("Option --distances should be yes or "
+                                         "no");
+            }
+        } else if (name == "verify-model") {
+            if (value == "yes") {
+                options.verifyModel = true;
+            } else if (value == "no") {
+                options.verifyModel = false;
+            } else {
+                throw std::runtime_error("Option --verify-model should be yes "
+                                         "or no");
+            }
+        } else {
+            throw std::runtime_error("Unknown option --" + name);
+        }
+    }
+    return positional;
+}
+
+/**
+ * @brief Apply the training options to a model
+ *
+ * @param kmeans The model
+ * @param options The options
+ */
+template <typename Scalar>
+void configure(BasicKMeans<Scalar> &kmeans, const Options &options) {
+    kmeans.setNumThreads(options.numThreads);
+    kmeans.algorithm = options.algorithm;
+    kmeans.initMethod = options.initMethod;
+    kmeans.setSeed(options.seed);
+    kmeans.numInits = options.numInits;
+    kmeans.emptyClusterPolicy = options.emptyClusters;
+    kmeans.inertiaTolerance = options.inertiaTolerance;
+    kmeans.reassignedTolerance = options.reassignedTolerance;
+    if (options.telemetryFile.empty()) {
+        return;
+    }
+    if (!telemetryEnabled) {
+        throw std::runtime_error(
+            "The program was compiled without telemetry (KMEANS_TELEMETRY=0)");
+    }
+    std::shared_ptr<std::ostream> out;
+    if (options.telemetryFile == "-") {
+        // Not owned: std::cerr outlives the model
+        out = std::shared_ptr<std::ostream>(&std::cerr, [](std::ostream *) {});
+    } else {
+        out = std::make_shared<std::ofstream>(options.telemetryFile);
+        if (!*out) {
+            throw std::runtime_error("Could not open the file");
+        }
+    }
+    kmeans.telemetry = jsonLinesTelemetry(out);
+}
+
+/**
+ * @brief Save a trained model, with the index of its centroids built and
+ * saved next to it if --index was given
+ *
+ * @param kmeans The trained model
+ * @param filename The name of the model file
+ * @param options The options
+ */
+template <typename Scalar>
+void saveTrainedModel(BasicKMeans<Scalar> &kmeans, const std::string &filename,
+                      const Options &options) {
+    if (options.index) {
+        kmeans.buildIndex(options.indexLists, options.probes);
+    }
+    kmeans.saveModel(filename, options.modelFormat);
+}
+
+/**
+ * @brief Check whether a file is a model rather than a dataset: a binary
+ * model, or a text model (which starts with its precision line)
+ *
+ * @param filename The name of the file
+ * @return Whether the file is a model
+ */
+bool isModelFile(const std::string &filename) {
+    if (isBinaryModel(filename)) {
+        return true;
+    }
+    std::ifstream file(filename);
+    return file.is_open() && (file >> std::ws).peek() == '#';
+}
+
+/**
+ * @brief Verify the checksum of the binary models a command loads, if
+ * --verify-model was given
+ *
+ * @param command The command
+ * @param argc number of arguments
+ * @param argv array of arguments
+ * @param options The options
+ */
+void verifyModels(const std::string &command, int argc, char *argv[],
+                  const Options &options) {
+    if (!options.verifyModel) {
+        return;
+    }
+    std::vector<std::string> models;
+    if (!options.resumeFile.empty()) {
+        models.push_back(options.resumeFile);
+    }
+    if (command == "serve" || command == "update" || command == "convert" ||
+        (command != "minibatch" && argc == 4)) {
+        models.push_back(argv[2]);
+    }
+    for (const std::string &model : models) {
+        if (isBinaryModel(model)) {
+            verifyBinaryModel(model);
+        }
+    }
+}
+
+/**
+ * @brief Decide whether convert reads a model or a dataset. Without
+ * --convert, the input is a model if it is a binary model or a text model
+ * with its precision line, or if --model-format was given (a text model in
+ * the format without the precision line looks like a text dataset). A text
+ * file converted as a dataset for lack of either is noted on standard error,
+ * so that such a model is not silently converted as a dataset.
+ *
+ * @param input The name of the input file
+ * @param options The options
+ * @return Whether the input is a model
+ */
+bool convertsModel(const std::string &input, const Options &options) {
+    bool model = isModelFile(input);
+    if (options.convertInput == ConvertInput::ModelFile) {
+        if (isBinaryDataset(input)) {
+            throw std::runtime_error(input + " is a dataset, not a model");
+        }
+        return true;
+    }
+    if (options.convertInput == ConvertInput::DatasetFile) {
+        if (model) {
+            throw std::runtime_error(input + " is a model, not a dataset");
+        }
+        return false;
+    }
+    if (model || options.modelFormatGiven) {
+        if (isBinaryDataset(input)) {
+            throw std::runtime_error(input + " is a dataset, not a model");
+        }
+        return true;
+    }
+    if (!isBinaryDataset(input)) {
+        std::cerr << "Note: " << input
+                  << " is converted as a dataset; give --convert=model to "
+                     "convert a text model without a precision line"
+                  << std::endl;
+    }
+    return false;
+}
+
+/**
+ * @brief Save a model again in the format given by --model-format, in its
+ * own precision
+ *
+ * @param input The name of the model file
+ * @param output The name of the converted model file
+ * @param options The options
+ */
+template <typename Scalar>
+void convertModel(const std::string &input, const std::string &output,
+                  const Options &options) {
+    BasicKMeans<Scalar> kmeans(0, BasicDataset<Scalar>(), input);
+    kmeans.saveModel(output, options.modelFormat);
+}
+
+/**
+ * @brief Check that a model loaded with --resume has the number of clusters
+ * asked for and the dimensions of the dataset
+ *
+ * @param kmeans The loaded model
+ * @param numClusters The number of clusters given on the command line
+ * @param numDims The number of dimensions of the dataset
+ */
+template <typename Scalar>
+void checkResumedModel(const BasicKMeans<Scalar> &kmeans, uint64_t numClusters,
+                       uint64_t numDims) {
+    if (kmeans.numClusters != numClusters) {
+        throw std::runtime_error(
+            "The model to resume from does not have " +
+            std::to_string(numClusters) + " clusters");
+    }
+    if (kmeans.numDims != numDims) {
+        throw std::runtime_error(
+            "The model to resume from does not have the dimensions of the "
+            "dataset");
+    }
+}
+
+/**
+ * @brief Use the index of the centroids of a loaded model if --index was
+ * given: it is loaded from the file next to the model, or built and saved
+ * there if there is none or it was built for other centroids
+ *
+ * @param kmeans The loaded model
+ * @param filename The name of the model file
+ * @param options The options
+ */
+template <typename Scalar>
+void useIndex(BasicKMeans<Scalar> &kmeans, const std::string &filename,
+              const Options &options) {
+    if (!options.index) {
+        return;
+    }
+    std::string indexFile = filename + ".index";
+    if (!std::ifstream(indexFile).good() ||
+        !kmeans.loadIndex(indexFile, options.probes)) {
+        kmeans.buildIndex(options.indexLists, options.probes);
+        kmeans.centroidIndex->save(indexFile);
+    }
+}
+
+/**
+ * @brief Train or predict with the coordinates stored as Scalar
+ *
+ * @param argc number of arguments (without the options)
+ * @param argv array of arguments (without the options)
+ * @param options The options
  * @return int exit code
  */
-int main(int argc, char *argv[]) {
-    /*
-    Usage:
-        - Train:
-            - With a predefined number of clusters:
-                ./kmeans <input_file> <num_clusters> <max_iters> <threshold>
-    <model_output_file>
-            - Automatically find the best number of clusters:
-                ./kmeans <input_file> <min_k> <max_k> <max_iters> <threshold>
-    <model_output_file>
-        - Prediction:
-            ./kmeans <input_file> <model_file> <output_file>
-        - Generate blob dataset:
-            ./kmeans generate <file_address> <num_points> <num_dimensions>
-    <num_clusters> <radius>
-    */
+template <typename Scalar>
+int run(int argc, char *argv[], const Options &options) {
+    // Answer prediction requests with the model kept in memory
+    if (std::string(argv[1]) == "serve") {
+        try {
+            BasicKMeans<Scalar> kmeans(0, BasicDataset<Scalar>(), argv[2]);
+            kmeans.setNumThreads(options.numThreads);
+            useIndex(kmeans, argv[2], options);
+            PredictionServer<Scalar> server(kmeans);
+            server.withDistances = options.distances;
+            if (argc == 4) {
+                server.serveSocket(argv[3]);
+            } else {
+                server.serveStream(STDIN_FILENO, STDOUT_FILENO);
+            }
+        } catch (const std::exception &e) {
+            std::cout << "Error: " << e.what() << std::endl;
+            return 1;
+        }
+    }
+    // Fold new points into a saved model
+    else if (std::string(argv[1]) == "update") {
+        char *modelFile = argv[2];
+        char *inputFile = argv[3];
+        char *modelOutputFile = argv[4];
 
-    // Check if the number of arguments is correct
-    if (argc != 4 && argc != 6 && argc != 7) {
-        std::cout << "Error: Invalid number of arguments";
-        return 1;
+        try {
+            BasicKMeans<Scalar> kmeans(0, BasicDataset<Scalar>(), modelFile);
+            kmeans.setNumThreads(options.numThreads);
+            if (options.chunkSize > 0 && !isBinaryDataset(inputFile)) {
+                // The decay is applied once for the whole file: the later
+                // chunks are folded in without decay, each assigned to the
+                // centroids moved by the chunks before it
+                ChunkReader reader(inputFile, options.chunkSize);
+                forEachChunk<Scalar>(
+                    reader, [&](BasicDataset<Scalar> &chunk, uint64_t offset) {
+                        kmeans.updateOnline(chunk,
+                                            offset == 0 ? options.decay : 1);
+                    });
+            } else {
+                uint64_t numPoints, numDimensions;
+                BasicDataset<Scalar> points;
+                readDataset(points, inputFile, numPoints, numDimensions,
+                            options.numThreads);
+                kmeans.updateOnline(points, options.decay);
+            }
+            saveTrainedModel(kmeans, modelOutputFile, options);
+        } catch (const std::exception &e) {
+            std::cout << "Error: " << e.what() << std::endl;
+            return 1;
+        }
     }
+    // Coordinate the training of workers that own shards of the dataset
+    else if (std::string(argv[1]) == "coordinator") {
+        uint64_t numShards = std::stoul(argv[2]);
+        uint64_t numClusters = std::stoul(argv[3]);
+        uint64_t maxIters = std::stoul(argv[4]);
+        double_t threshold = std::stod(argv[5]);
+        char *modelOutputFile = argv[6];
+        char *socketPath = argv[7];
 
-    // Generate blob dataset
-    if (argc == 7 && std::string(argv[1]) == "generate") {
-        char *fileAddress = argv[2];
-        uint64_t numPoints = std::stoul(argv[3]);
-        uint64_t numDimensions = std::stoul(argv[4]);
-        uint64_t numClusters = std::stoul(argv[5]);
-        double_t radius = std::stod(argv[6]);
+        try {
+            if (options.resumeFile.empty() &&
+                options.initMethod != InitMethod::Random) {
+                throw std::runtime_error(
+                    "Distributed training only initializes the centroids "
+                    "with --init=random (or starts from --resume)");
+            }
+
+            // Wait for every worker
+            UnixSocketListener listener(socketPath);
+            DistributedCoordinator<Scalar> coordinator(
+                numClusters, acceptWorkers(listener, numShards));
+            coordinator.model.setNumThreads(options.numThreads);
+            coordinator.model.emptyClusterPolicy = options.emptyClusters;
+            coordinator.model.inertiaTolerance = options.inertiaTolerance;
+            coordinator.model.reassignedTolerance = options.reassignedTolerance;
+            if (!coordinator.aligned) {
+                std::cerr << "Note: the shards do not start at partition "
+                             "boundaries, so the model may differ in the last "
+                             "bits from single-process training (see the "
+                             "shard command)"
+                          << std::endl;
+            }
+
+            // Train, from the centroids of a saved model with --resume
+            if (!options.resumeFile.empty()) {
+                BasicKMeans<Scalar> resumed(0, BasicDataset<Scalar>(),
+                                            options.resumeFile);
+                checkResumedModel(resumed, numClusters,
+                                  coordinator.model.numDims);
+                coordinator.model.centroids = resumed.centroids;
+            } else {
+                coordinator.initializeRandom(options.seed);
+            }
+            coordinator.fit(maxIters, threshold);
+            saveTrainedModel(coordinator.model, modelOutputFile, options);
+        } catch (const std::exception &e) {
+            std::cout << "Error: " << e.what() << std::endl;
+            return 1;
+        }
+    }
+    // Serve a shard of the dataset to a coordinator
+    else if (std::string(argv[1]) == "worker") {
+        char *shardFile = argv[2];
+        uint64_t shardIndex = std::stoul(argv[3]);
+        char *socketPath = argv[4];
 
         try {
-            // Generate dataset
-            generateBlob(fileAddress, numPoints, numDimensions, numClusters,
-                         radius);
+            uint64_t numPoints, numDimensions;
+            BasicDataset<Scalar> shard;
+            readDataset(shard, shardFile, numPoints, numDimensions,
+                        options.numThreads);
+            std::unique_ptr<Transport> transport =
+                connectUnixSocket(socketPath);
+            runWorker(*transport, shardIndex, std::move(shard),
+                      options.numThreads);
         } catch (const std::exception &e) {
             std::cout << "Error: " << e.what() << std::endl;
             return 1;
         }
+    }
+    // Train with mini-batches
+    else if (std::string(argv[1]) == "minibatch") {
+        char *inputFile = argv[2];
+        uint64_t numClusters = std::stoul(argv[3]);
+        uint64_t batchSize = std::stoul(argv[4]);
+        uint64_t maxSteps = std::stoul(argv[5]);
+        double_t tolerance = std::stod(argv[6]);
+        char *modelOutputFile = argv[7];
 
+        try {
+            // Read dataset
+            uint64_t numPoints, numDimensions;
+            BasicDataset<Scalar> points;
+            readDataset(points, inputFile, numPoints, numDimensions,
+                        options.numThreads);
+
+            // Train
+            BasicKMeans<Scalar> kmeans(numClusters, numDimensions, numPoints,
+                                       std::move(points));
+            configure(kmeans, options);
+            kmeans.fitMiniBatch(batchSize, maxSteps, tolerance,
+                                options.patience);
+
+            // Save model
+            saveTrainedModel(kmeans, modelOutputFile, options);
+        } catch (const std::exception &e) {
+            std::cout << "Error: " << e.what() << std::endl;
+            return 1;
+        }
     }
     // Train
     else if (argc == 6 || argc == 7) {
@@ -75,17 +616,55 @@ int main(int argc, char *argv[]) {
             char *modelOutputFile = argv[5];
 
             try {
+                // Binary datasets are memory-mapped, which already keeps
+                // only the pages in use in memory
+                if (options.chunkSize > 0 && !isBinaryDataset(inputFile)) {
+                    // Train over the file read in chunks
+                    ChunkReader reader(inputFile, options.chunkSize);
+                    if (!options.resumeFile.empty()) {
+                        BasicKMeans<Scalar> kmeans(
+                            0, BasicDataset<Scalar>(),
+                            options.resumeFile);
+                        checkResumedModel(kmeans, numClusters,
+                                          reader.numDims);
+                        configure(kmeans, options);
+                        kmeans.fitStreamingFromCentroids(reader, maxIters,
+                                                         threshold);
+                        saveTrainedModel(kmeans, modelOutputFile, options);
+                        return 0;
+                    }
+                    BasicKMeans<Scalar> kmeans(numClusters, reader.numDims, 0,
+                                               BasicDataset<Scalar>());
+                    configure(kmeans, options);
+                    kmeans.fitStreaming(reader, maxIters, threshold);
+                    saveTrainedModel(kmeans, modelOutputFile, options);
+                    return 0;
+                }
+
                 // Read dataset
                 uint64_t numPoints, numDimensions;
-                std::vector<Point> points;
-                readDataset(points, inputFile, numPoints, numDimensions);
+                BasicDataset<Scalar> points;
+                readDataset(points, inputFile, numPoints, numDimensions,
+                            options.numThreads);
 
-                // Train
-                KMeans kmeans(numClusters, numDimensions, numPoints, points);
+                // Train, from the centroids of a saved model with --resume
+                if (!options.resumeFile.empty()) {
+                    BasicKMeans<Scalar> kmeans(numPoints, std::move(points),
+                                               options.resumeFile);
+                    checkResumedModel(kmeans, numClusters,
+                                      numDimensions);
+                    configure(kmeans, options);
+                    kmeans.fitFromCentroids(maxIters, threshold);
+                    saveTrainedModel(kmeans, modelOutputFile, options);
+                    return 0;
+                }
+                BasicKMeans<Scalar> kmeans(numClusters, numDimensions,
+                                           numPoints, std::move(points));
+                configure(kmeans, options);
                 kmeans.fit(maxIters, threshold);
 
                 // Save model
-                kmeans.saveModel(modelOutputFile);
+                saveTrainedModel(kmeans, modelOutputFile, options);
             } catch (const std::exception &e) {
                 std::cout << "Error: " << e.what() << std::endl;
                 return 1;
@@ -104,19 +683,25 @@ int main(int argc, char *argv[]) {
             try {
                 // Read dataset
                 uint64_t numPoints, numDimensions;
-                std::vector<Point> points;
-                readDataset(points, inputFile, numPoints, numDimensions);
+                BasicDataset<Scalar> points;
+                readDataset(points, inputFile, numPoints, numDimensions,
+                            options.numThreads);
 
                 // Find the number of clusters
                 uint64_t numClusters =
-                    elbowMethod(numPoints, numDimensions, points, minK, maxK);
+                    elbowMethod(numPoints, numDimensions, points, minK, maxK,
+                                options.numThreads, options.algorithm,
+                                options.initMethod, options.seed,
+                                options.elbowWarmStart, options.elbowPatience);
 
                 // Train
-                KMeans kmeans(numClusters, numDimensions, numPoints, points);
+                BasicKMeans<Scalar> kmeans(numClusters, numDimensions,
+                                           numPoints, std::move(points));
+                configure(kmeans, options);
                 kmeans.fit(maxIters, threshold);
 
                 // Save model
-                kmeans.saveModel(modelOutputFile);
+                saveTrainedModel(kmeans, modelOutputFile, options);
             } catch (const std::exception &e) {
                 std::cout << "Error: " << e.what() << std::endl;
                 return 1;
@@ -128,22 +713,275 @@ int main(int argc, char *argv[]) {
         char *inputFile = argv[1];
         char *modelFile = argv[2];
         char *outputFile = argv[3];
+        PredictionOptions predictionOptions;
+        predictionOptions.format = options.predictionFormat;
+        predictionOptions.distances = options.distances;
 
         try {
+            if (options.chunkSize > 0 && !isBinaryDataset(inputFile)) {
+                // Predict over the file read in chunks
+                ChunkReader reader(inputFile, options.chunkSize);
+                BasicKMeans<Scalar> kmeans(0, BasicDataset<Scalar>(),
+                                           modelFile);
+                kmeans.setNumThreads(options.numThreads);
+                useIndex(kmeans, modelFile, options);
+                kmeans.savePredictionsStreaming(reader, outputFile,
+                                                predictionOptions);
+                return 0;
+            }
+
             // Read dataset
             uint64_t numPoints, numDimensions;
-            std::vector<Point> points;
-            readDataset(points, inputFile, numPoints, numDimensions);
+            BasicDataset<Scalar> points;
+            readDataset(points, inputFile, numPoints, numDimensions,
+                        options.numThreads);
 
             // Load model
-            KMeans kmeans(numPoints, points, modelFile);
+            BasicKMeans<Scalar> kmeans(numPoints, std::move(points),
+                                       modelFile);
+            kmeans.setNumThreads(options.numThreads);
+            useIndex(kmeans, modelFile, options);
 
             // Predict
-            kmeans.savePredictions(outputFile);
+            kmeans.savePredictions(outputFile, predictionOptions);
+        } catch (const std::exception &e) {
+            std::cout << "Error: " << e.what() << std::endl;
+            return 1;
+        }
+    }
+    return 0;
+}
+
+/**
+ * @brief Entry point of the program for the K-means clustering algorithm
+ *
+ * @param argc number of arguments
+ * @param argv array of arguments
+ * @return int exit code
+ */
+int main(int argc, char *argv[]) {
+    /*
+    Usage:
+        - Train:
+            - With a predefined number of clusters:
+                ./kmeans <input_file> <num_clusters> <max_iters> <threshold>
+    <model_output_file>
+            - Automatically find the best number of clusters:
+                ./kmeans <input_file> <min_k> <max_k> <max_iters> <threshold>
+    <model_output_file>
+            - With mini-batches:
+                ./kmeans minibatch <input_file> <num_clusters> <batch_size>
+    <max_steps> <tolerance> <model_output_file>
+        - Prediction:
+            ./kmeans <input_file> <model_file> <output_file>
+        - Generate blob dataset:
+            ./kmeans generate <file_address> <num_points> <num_dimensions>
+    <num_clusters> <radius>
+        - Convert a text dataset to the binary format, or a model to the
+    format given by --model-format:
+            ./kmeans convert <input_file> <output_file>
+        - Split a dataset into shards for distributed training:
+            ./kmeans shard <input_file> <num_clusters> <num_shards>
+    <output_prefix>
+        - Distributed training (a coordinator and one worker per shard):
+            ./kmeans coordinator <num_shards> <num_clusters> <max_iters>
+    <threshold> <model_output_file> <socket_path>
+            ./kmeans worker <shard_file> <shard_index> <socket_path>
+        - Fold new points into a saved model (online update):
+            ./kmeans update <model_file> <input_file> <model_output_file>
+        - Serve predictions of points read from stdin, or from the clients
+    of a Unix domain socket, one point per line:
+            ./kmeans serve <model_file> [socket_path]
+    Options:
+        --threads=<n>   number of threads used to train and predict
+        --algorithm=<lloyd|hamerly|elkan|gemm|auto>   assignment algorithm
+    used to train
+        --init=<random|kmeans++|kmeans||>   initialization of the centroids
+        --seed=<n>   seed of the random number generator
+        --n-init=<n>   train from n initializations and keep the model of
+    lowest inertia (full-batch training from scratch in memory only)
+        --empty-clusters=<farthest|split|keep>   where a cluster that lost
+    all its points is moved (full-batch training in memory and
+    distributed training)
+        --inertia-tolerance=<f>   stop when the inertia improves by less than
+    this fraction (full-batch training in memory and distributed training)
+        --reassigned-tolerance=<f>   stop when fewer than this fraction of
+    the points change cluster (full-batch training in memory and
+    distributed training)
+        --patience=<n>   mini-batch steps without progress before stopping
+        --chunk-size=<n>   stream the input file in chunks of n points
+    (training with a predefined number of clusters, updating and prediction
+    only)
+        --precision=<float64|float32>   type of the coordinates used to
+    train (prediction uses the precision of the model), to convert and to
+    shard
+        --elbow=<parallel|warm>   train the values of k concurrently from
+    scratch, or one after the other starting from the k - 1 model
+        --elbow-patience=<n>   flat values of k in a row after which the
+    elbow method stops (0: try every value of k)
+        --distances=<no|yes>   whether predictions and serve replies
+    include the distance to the centroid
+        --prediction-format=<text|binary>   format of the prediction file
+        --index=<none|ivf>   build an index of the centroids with the model
+    (training), or use it (prediction and serve; built if missing)
+        --index-lists=<n>   lists of the index (default: sqrt of clusters)
+        --probes=<n>   lists of the index searched for a point
+        --resume=<model_file>   train from the centroids of a saved model
+    instead of initializing them (predefined number of clusters and
+    coordinator only)
+        --decay=<f>   weight kept by the points already in the model when
+    updating it, in (0, 1]
+        --blob-shape=<uniform|gaussian>   distribution of generated blobs
+        --spread=<f>   radii of generated blobs vary from radius / f to
+    radius * f
+        --imbalance=<f>   the largest generated blob has f times the points
+    of the smallest
+        --format=<text|binary>   format of the generated dataset (binary
+    uses --precision)
+        --model-format=<text|binary>   format of the saved models (binary
+    is exact and loaded with mmap; models of either format are loaded)
+        --convert=<auto|dataset|model>   what convert reads: a dataset, or a
+    model (auto: a model if it is recognized as one or --model-format is
+    given)
+        --verify-model=<no|yes>   check the checksum of the binary models
+    loaded (reads the whole model before it is used)
+        --telemetry=<file>   write the metrics of every training iteration
+    as JSON lines to the file ("-": standard error)
+    */
+
+    Options options;
+    std::vector<char *> args;
+    try {
+        args = parseOptions(argc, argv, options);
+    } catch (const std::exception &e) {
+        std::cout << "Error: " << e.what() << std::endl;
+        return 1;
+    }
+    argc = int(args.size());
+    argv = args.data();
+
+    // Check if the number of arguments is correct
+    std::string command = argc > 1 ? std::string(argv[1]) : "";
+    bool validArguments = argc == 4 || argc == 6 || argc == 7;
+    if (command == "generate") {
+        validArguments = argc == 7;
+    } else if (command == "minibatch") {
+        validArguments = argc == 8;
+    } else if (command == "convert") {
+        validArguments = argc == 4;
+    } else if (command == "serve") {
+        validArguments = argc == 3 || argc == 4;
+    } else if (command == "update" || command == "worker") {
+        validArguments = argc == 5;
+    } else if (command == "shard") {
+        validArguments = argc == 6;
+    } else if (command == "coordinator") {
+        validArguments = argc == 8;
+    }
+    if (!validArguments) {
+        std::cout << "Error: Invalid number of arguments";
+        return 1;
+    }
+    if (options.chunkSize > 0 &&
+        (command == "generate" || command == "minibatch" ||
+         command == "convert" || command == "serve" || command == "shard" ||
+         command == "coordinator" || command == "worker" || argc == 7)) {
+        std::cout << "Error: Streaming is only supported for training with a "
+                     "predefined number of clusters, updating and prediction"
+                  << std::endl;
+        return 1;
+    }
+
+    if (options.numInits > 1 &&
+        (command == "minibatch" || command == "coordinator" ||
+         options.chunkSize > 0 || !options.resumeFile.empty())) {
+        std::cout << "Error: Several initializations are only supported for "
+                     "full-batch training from scratch in memory"
+                  << std::endl;
+        return 1;
+    }
+
+    // Generate blob dataset
+    if (command == "generate") {
+        char *fileAddress = argv[2];
+        uint64_t numPoints = std::stoul(argv[3]);
+        uint64_t numDimensions = std::stoul(argv[4]);
+        uint64_t numClusters = std::stoul(argv[5]);
+        double_t radius = std::stod(argv[6]);
+
+        try {
+            // Generate dataset
+            BlobOptions blobs = options.blobs;
+            blobs.seed = options.seed;
+            blobs.numThreads = options.numThreads;
+            blobs.precision = options.precision;
+            generateBlob(fileAddress, numPoints, numDimensions, numClusters,
+                         radius, blobs);
         } catch (const std::exception &e) {
             std::cout << "Error: " << e.what() << std::endl;
             return 1;
         }
+
+    }
+    // Convert a text dataset to the binary format, or a model to the format
+    // given by --model-format
+    else if (command == "convert") {
+        try {
+            verifyModels(command, argc, argv, options);
+            if (convertsModel(argv[2], options)) {
+                if (readModelPrecision(argv[2]) == Precision::Float32) {
+                    convertModel<float>(argv[2], argv[3], options);
+                } else {
+                    convertModel<double>(argv[2], argv[3], options);
+                }
+            } else if (options.precision == Precision::Float32) {
+                convertToBinaryDataset<float>(argv[2], argv[3]);
+            } else {
+                convertToBinaryDataset<double>(argv[2], argv[3]);
+            }
+        } catch (const std::exception &e) {
+            std::cout << "Error: " << e.what() << std::endl;
+            return 1;
+        }
+    }
+    // Split a dataset into shards for distributed training
+    else if (command == "shard") {
+        try {
+            uint64_t numClusters = std::stoul(argv[3]);
+            uint64_t numShards = std::stoul(argv[4]);
+            if (options.precision == Precision::Float32) {
+                writeShards<float>(argv[2], numClusters, numShards, argv[5]);
+            } else {
+                writeShards<double>(argv[2], numClusters, numShards, argv[5]);
+            }
+        } catch (const std::exception &e) {
+            std::cout << "Error: " << e.what() << std::endl;
+            return 1;
+        }
+    }
+    // Train in the precision given by --precision, and predict, serve and
+    // update in the precision of the model
+    else {
+        Precision precision = options.precision;
+        if (command == "serve" || command == "update" ||
+            (command != "minibatch" && argc == 4)) {
+            try {
+                precision = readModelPrecision(argv[2]);
+            } catch (const std::exception &e) {
+                std::cout << "Error: " << e.what() << std::endl;
+                return 1;
+            }
+        }
+        try {
+            verifyModels(command, argc, argv, options);
+        } catch (const std::exception &e) {
+            std::cout << "Error: " << e.what() << std::endl;
+            return 1;
+        }
+        if (precision == Precision::Float32) {
+            return run<float>(argc, argv, options);
+        }
+        return run<double>(argc, argv, options);
     }
     return 0;
 }
\ No newline at end of file
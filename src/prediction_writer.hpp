@@ -0,0 +1,232 @@
+/**
+ * @file prediction_writer.hpp
+ * @author Reza Namazi (namazir@mcmaster.ca)
+ * @brief A header file for the writer of prediction files, which formats the
+ * predictions in parallel and writes them on a thread of its own
+ * @version 1.0
+ * @date 2026-10-16
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <charconv>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <future>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "dataset.hpp"
+#include "thread_pool.hpp"
+
+/**
+ * @brief Formats of a prediction file
+ */
+enum class PredictionFormat {
+    Text,   // one line per point, after the precision line
+    Binary  // a header and one fixed-size record per point
+            // (see BinaryPredictionHeader)
+};
+
+/**
+ * @brief What a prediction file holds
+ */
+struct PredictionOptions {
+    PredictionFormat format = PredictionFormat::Text;  // format of the file
+    bool distances = false;  // whether the distance of every point to the
+                             // centroid of its cluster is written too
+};
+
+/**
+ * @brief Header at the start of a binary prediction file. All fields are
+ * stored little-endian. One record per point follows, in the order of the
+ * points: its cluster as a 64-bit unsigned integer and, with distances, the
+ * distance to the centroid as a 64-bit float.
+ */
+struct BinaryPredictionHeader {
+    char magic[8];         // "KMEANSPR"
+    uint32_t version;      // version of the format
+    uint32_t flags;        // hasDistances if the records hold the distances
+    uint64_t numPoints;    // number of records
+    uint64_t recordBytes;  // size of a record
+    uint64_t reserved[4];  // zero
+
+    static constexpr char expectedMagic[8] = {'K', 'M', 'E', 'A',
+                                              'N', 'S', 'P', 'R'};
+    static constexpr uint32_t currentVersion = 1;
+    static constexpr uint32_t hasDistances = 1;
+};
+
+static_assert(sizeof(BinaryPredictionHeader) == 64,
+              "The binary prediction header should be 64 bytes");
+
+/**
+ * @brief A writer of prediction files. Every call to write formats its
+ * predictions into one buffer per block of points, in parallel, and hands the
+ * buffers to a thread that writes them in order while the caller assigns the
+ * next points. Nothing is flushed before the file is closed.
+ */
+class PredictionWriter {
+   public:
+    static constexpr uint64_t formatBlock = 16384;  // points formatted by
+                                                    // one task
+
+    /**
+     * @brief Create the prediction file and write its header
+     *
+     * @param filename Name of the file
+     * @param precision Precision of the model (recorded by the text format)
+     * @param numPoints Number of points that will be written
+     * @param predictionOptions The format and whether distances are written
+     * @param threads Threads that format the predictions
+     */
+    PredictionWriter(const std::string &filename, Precision precision,
+                     uint64_t numPoints,
+                     const PredictionOptions &predictionOptions,
+                     ThreadPool &threads)
+        : options(predictionOptions), pool(threads) {
+        file.open(filename, std::ios::binary);
+        if (!file.is_open()) {
+            throw std::runtime_error("Could not open the file");
+        }
+        if (options.format == PredictionFormat::Binary) {
+            BinaryPredictionHeader header{};
+            std::memcpy(header.magic, BinaryPredictionHeader::expectedMagic,
+                        sizeof(header.magic));
+            header.version = BinaryPredictionHeader::currentVersion;
+            header.flags =
+                options.distances ? BinaryPredictionHeader::hasDistances : 0;
+            header.numPoints = numPoints;
+            header.recordBytes = recordBytes();
+            file.write(reinterpret_cast<const char *>(&header), sizeof(header));
+        } else {
+            writePrecisionHeader(file, precision);
+        }
+    }
+
+    /**
+     * @brief Wait for the last buffers to be written. Call close to know
+     * whether writing succeeded.
+     *
+     */
+    ~PredictionWriter() {
+        if (pending.valid()) {
+            pending.wait();
+        }
+    }
+
+    /**
+     * @brief Write the predictions of the next points
+     *
+     * @param labels Cluster of every point
+     * @param distances Squared distance of every point to the centroid of its
+     * cluster (only read when distances are written)
+     * @param count Number of points
+     */
+    void write(const uint64_t *labels, const double *distances,
+               uint64_t count) {
+        std::vector<std::string> &buffers = blocks[current];
+        uint64_t numBlocks = (count + formatBlock - 1) / formatBlock;
+        // The thread writing the buffers from before does not use these
+        buffers.resize(std::max<uint64_t>(buffers.size(), numBlocks));
+        pool.parallelFor(numBlocks, [&](uint64_t block) {
+            uint64_t begin = block * formatBlock;
+            uint64_t end = std::min(count, begin + formatBlock);
+            format(labels, distances, begin, end, buffers[block]);
+        });
+
+        finishWriting();
+        pending = std::async(std::launch::async, [this, &buffers, numBlocks] {
+            for (uint64_t block = 0; block < numBlocks; block++) {
+                file.write(buffers[block].data(),
+                           std::streamsize(buffers[block].size()));
+            }
+        });
+        current = 1 - current;
+    }
+
+    /**
+     * @brief Write what is left and close the file
+     *
+     */
+    void close() {
+        finishWriting();
+        file.close();
+        if (!file) {
+            throw std::runtime_error("Could not write the predictions");
+        }
+    }
+
+   private:
+    PredictionOptions options;  // the format and whether distances are written
+    ThreadPool &pool;           // threads that format the predictions
+    std::ofstream file;         // the prediction file
+    std::vector<std::string> blocks[2];  // formatted blocks, in turn
+    uint64_t current = 0;       // blocks formatted by the next write
+    std::future<void> pending;  // the thread writing the other blocks
+
+    /**
+     * @brief Size of a record of the binary format
+     *
+     */
+    uint64_t recordBytes() const {
+        return sizeof(uint64_t) + (options.distances ? sizeof(double) : 0);
+    }
+
+    /**
+     * @brief Wait until the buffers handed to the writing thread are written
+     *
+     */
+    void finishWriting() {
+        if (pending.valid()) {
+            pending.get();
+        }
+        if (!file) {
+            throw std::runtime_error("Could not write the predictions");
+        }
+    }
+
+    /**
+     * @brief Format the predictions of the points [begin, end)
+     *
+     */
+    void format(const uint64_t *labels, const double *distances,
+                uint64_t begin, uint64_t end, std::string &buffer) const {
+        buffer.clear();
+        if (options.format == PredictionFormat::Binary) {
+            buffer.resize((end - begin) * recordBytes());
+            char *record = buffer.data();
+            for (uint64_t i = begin; i < end; i++) {
+                std::memcpy(record, &labels[i], sizeof(uint64_t));
+                record += sizeof(uint64_t);
+                if (options.distances) {
+                    double distance = std::sqrt(distances[i]);
+                    std::memcpy(record, &distance, sizeof(double));
+                    record += sizeof(double);
+                }
+            }
+            return;
+        }
+        char number[32];
+        for (uint64_t i = begin; i < end; i++) {
+            char *last =
+                std::to_chars(number, number + sizeof(number), labels[i]).ptr;
+            buffer.append(number, last);
+            if (options.distances) {
+                last = std::to_chars(number, number + sizeof(number),
+                                     std::sqrt(distances[i]))
+                           .ptr;
+                buffer += ' ';
+                buffer.append(number, last);
+            }
+            buffer += '\n';
+        }
+    }
+};
@@ -0,0 +1,43 @@
+/**
+ * @file random.hpp
+ * @author Reza Namazi (namazir@mcmaster.ca)
+ * @brief A header file for counter-based random numbers
+ * @version 1.0
+ * @date 2026-10-16
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+
+#pragma once
+
+#include <cstdint>
+
+/**
+ * @brief Mix a 64-bit value into a pseudo-random 64-bit value (the finalizer
+ * of the SplitMix64 generator)
+ *
+ * @param x The value to mix
+ * @return The mixed value
+ */
+inline uint64_t splitMix64(uint64_t x) {
+    x += 0x9e3779b97f4a7c15ULL;
+    x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    x = (x ^ (x >> 27)) * 0x94d049bb133111ebULL;
+    return x ^ (x >> 31);
+}
+
+/**
+ * @brief A random number in [0, 1) that only depends on a key and a counter.
+ * Parallel loops use it to draw one number per element so that the result
+ * does not depend on which thread handles which element.
+ *
+ * @param key The key of the stream (e.g. drawn once from a seeded generator)
+ * @param counter The index of the number in the stream
+ * @return The random number
+ */
+inline double counterUniform(uint64_t key, uint64_t counter) {
+    uint64_t bits = splitMix64(key ^ splitMix64(counter));
+    // The 53 high bits fill the mantissa of a double
+    return double(bits >> 11) * 0x1.0p-53;
+}
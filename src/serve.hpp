@@ -0,0 +1,428 @@
+/**
+ * @file serve.hpp
+ * @author Reza Namazi (namazir@mcmaster.ca)
+ * @brief A header file for the prediction server that keeps a model in memory
+ * and assigns points sent over stdin or a Unix domain socket
+ * @version 1.0
+ * @date 2026-10-16
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+
+#pragma once
+
+#include <atomic>
+#include <cerrno>
+#include <charconv>
+#include <cmath>
+#include <condition_variable>
+#include <cstdint>
+#include <cstring>
+#include <deque>
+#include <mutex>
+#include <set>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include "kmeans.hpp"
+#include "text_dataset.hpp"
+
+/**
+ * @brief A server that answers prediction requests with a model loaded once.
+ *
+ * The protocol is line-based text: every line a client sends holds the
+ * numDims coordinates of one point, and the server replies with one line per
+ * point holding its cluster (followed by the distance to the centroid of the
+ * cluster when distances are enabled), in the order of the points. A line
+ * that is not a point gets an "error <message>" reply instead, and blank lines
+ * are ignored.
+ *
+ * Everything a client sends in one read is one batch. The batches of all
+ * clients are queued for a single scoring thread, which assigns everything
+ * queued at once with the thread pool of the model, so that the cost of a
+ * parallel loop is shared by all the points that arrived meanwhile. Points
+ * are assigned like prediction does, through the index of the model if it
+ * has one.
+ */
+template <typename Scalar>
+class PredictionServer {
+   public:
+    static constexpr uint64_t readBytes = 1 << 16;  // bytes read at a time
+    // Points assigned by one task of the parallel scoring loop
+    static constexpr uint64_t scoreBlock = 1024;
+
+    bool withDistances = false;  // whether replies include the distance
+
+    /**
+     * @brief Construct a new server over a model
+     *
+     * @param kmeans The model, with its centroids loaded. Its thread pool is
+     * used to assign the points, and only by the scoring thread.
+     */
+    PredictionServer(BasicKMeans<Scalar> &kmeans) : model(kmeans) {}
+
+    /**
+     * @brief Stop the server and wait for its threads
+     *
+     */
+    ~PredictionServer() { stop(); }
+
+    /**
+     * @brief Answer the requests read from one file descriptor until its end
+     * (e.g. stdin and stdout)
+     *
+     * @param input The file descriptor the points are read from
+     * @param output The file descriptor the replies are written to
+     */
+    void serveStream(int input, int output) {
+        startScoring();
+        handleClient(input, output, false);
+    }
+
+    /**
+     * @brief Listen on a Unix domain socket and answer every client that
+     * connects, each on its own thread, until stop is called. A stale socket
+     * file at the path is replaced.
+     *
+     * @param path The path of the socket
+     */
+    void serveSocket(const std::string &path) {
+        sockaddr_un address{};
+        if (path.size() >= sizeof(address.sun_path)) {
+            throw std::runtime_error("The socket path is too long");
+        }
+        address.sun_family = AF_UNIX;
+        std::memcpy(address.sun_path, path.c_str(), path.size() + 1);
+        struct stat status;
+        if (stat(path.c_str(), &status) == 0 && S_ISSOCK(status.st_mode)) {
+            unlink(path.c_str());
+        }
+
+        int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+        if (fd < 0) {
+            throw std::runtime_error("Could not create the socket");
+        }
+        if (bind(fd, reinterpret_cast<sockaddr *>(&address), sizeof(address)) <
+                0 ||
+            listen(fd, SOMAXCONN) < 0) {
+            close(fd);
+            throw std::runtime_error("Could not listen on " + path);
+        }
+        listener = fd;
+        startScoring();
+
+        while (!stopping) {
+            int client = accept(fd, nullptr, nullptr);
+            if (client < 0) {
+                if (errno == EINTR) {
+                    continue;
+                }
+                break;
+            }
+            std::lock_guard<std::mutex> lock(clientsMutex);
+            if (stopping) {
+                close(client);
+                break;
+            }
+            clients.insert(client);
+            // Detached so that a long-running server does not keep the
+            // threads of the clients that left; stop waits for the others
+            std::thread([this, client] {
+                handleClient(client, client, true);
+                std::lock_guard<std::mutex> clientsLock(clientsMutex);
+                clients.erase(client);
+                close(client);
+                clientLeft.notify_all();
+            }).detach();
+        }
+        unlink(path.c_str());
+    }
+
+    /**
+     * @brief Stop accepting clients, disconnect the connected ones and wait
+     * for all threads. Safe to call from another thread than the one serving.
+     *
+     */
+    void stop() {
+        {
+            std::lock_guard<std::mutex> lock(clientsMutex);
+            if (stopping.exchange(true)) {
+                return;
+            }
+            if (listener >= 0) {
+                shutdown(listener, SHUT_RDWR);
+            }
+            for (int client : clients) {
+                shutdown(client, SHUT_RDWR);
+            }
+        }
+        {
+            std::unique_lock<std::mutex> lock(clientsMutex);
+            clientLeft.wait(lock, [this] { return clients.empty(); });
+        }
+        {
+            std::lock_guard<std::mutex> lock(queueMutex);
+            scoringDone = true;
+        }
+        wakeUp.notify_all();
+        if (scorer.joinable()) {
+            scorer.join();
+        }
+        if (listener >= 0) {
+            close(listener);
+        }
+    }
+
+   private:
+    /**
+     * @brief The points of one batch of a client and their assignments
+     *
+     */
+    struct Batch {
+        std::vector<Scalar> points;      // row-major coordinates
+        uint64_t numPoints = 0;          // number of points in the batch
+        std::vector<uint64_t> labels;    // cluster of every point
+        std::vector<double> distances;   // distance to the cluster centroid
+        bool done = false;               // set when the batch is assigned
+    };
+
+    BasicKMeans<Scalar> &model;       // the model that assigns the points
+    std::atomic<bool> stopping{false};  // set by stop
+    int listener = -1;                // listening socket, if any
+
+    std::mutex clientsMutex;             // protects the members below
+    std::set<int> clients;               // sockets of connected clients
+    std::condition_variable clientLeft;  // signals a client disconnecting
+
+    std::mutex queueMutex;               // protects the members below
+    std::condition_variable wakeUp;      // signals a batch or stopping
+    std::condition_variable assigned;    // signals assigned batches
+    std::deque<Batch *> queue;           // batches waiting to be assigned
+    bool scoringDone = false;            // stops the scoring thread
+    std::thread scorer;                  // the scoring thread
+
+    /**
+     * @brief Start the scoring thread if it is not running
+     *
+     */
+    void startScoring() {
+        if (!scorer.joinable()) {
+            scorer = std::thread([this] { scoringLoop(); });
+        }
+    }
+
+    /**
+     * @brief Assign every queued batch at once until the server stops
+     *
+     */
+    void scoringLoop() {
+        std::vector<Batch *> batches;
+        std::vector<std::pair<Batch *, uint64_t>> tasks;  // batch, first point
+        while (true) {
+            {
+                std::unique_lock<std::mutex> lock(queueMutex);
+                wakeUp.wait(lock, [this] { return scoringDone || !queue.empty(); });
+                if (queue.empty()) {
+                    return;
+                }
+                batches.assign(queue.begin(), queue.end());
+                queue.clear();
+            }
+
+            tasks.clear();
+            for (Batch *batch : batches) {
+                for (uint64_t i = 0; i < batch->numPoints; i += scoreBlock) {
+                    tasks.emplace_back(batch, i);
+                }
+            }
+            model.threadPool().parallelFor(tasks.size(), [&](uint64_t t) {
+                Batch &batch = *tasks[t].first;
+                uint64_t end =
+                    std::min(batch.numPoints, tasks[t].second + scoreBlock);
+                for (uint64_t i = tasks[t].second; i < end; i++) {
+                    double minDistance;
+                    batch.labels[i] = model.predictPoint(
+                        batch.points.data() + i * model.numDims, minDistance);
+                    batch.distances[i] = std::sqrt(minDistance);
+                }
+            });
+
+            {
+                std::lock_guard<std::mutex> lock(queueMutex);
+                for (Batch *batch : batches) {
+                    batch->done = true;
+                }
+            }
+            assigned.notify_all();
+        }
+    }
+
+    /**
+     * @brief Queue a batch for the scoring thread and wait until it is
+     * assigned
+     *
+     */
+    void score(Batch &batch) {
+        std::unique_lock<std::mutex> lock(queueMutex);
+        batch.done = false;
+        queue.push_back(&batch);
+        wakeUp.notify_one();
+        assigned.wait(lock, [&batch] { return batch.done; });
+    }
+
+    /**
+     * @brief Read points from a client and write the replies until the input
+     * ends or the server stops
+     *
+     * @param input The file descriptor the points are read from
+     * @param output The file descriptor the replies are written to
+     * @param isSocket Whether output is a socket (written without SIGPIPE)
+     */
+    void handleClient(int input, int output, bool isSocket) {
+        std::vector<char> buffer;  // unprocessed input
+        std::vector<std::string> errors;  // error of every line ("" if none)
+        std::string reply;
+        Batch batch;
+        bool atEnd = false;
+        while (!atEnd && !stopping) {
+            uint64_t size = buffer.size();
+            buffer.resize(size + readBytes);
+            ssize_t count = read(input, buffer.data() + size, readBytes);
+            if (count < 0 && errno == EINTR) {
+                buffer.resize(size);
+                continue;
+            }
+            atEnd = count <= 0;
+            buffer.resize(size + uint64_t(count > 0 ? count : 0));
+
+            // Process the complete lines (and the last one at the end)
+            uint64_t end = buffer.size();
+            while (!atEnd && end > 0 && buffer[end - 1] != '\n') {
+                end--;
+            }
+            if (end == 0) {
+                continue;
+            }
+            parseLines(buffer.data(), buffer.data() + end, batch, errors);
+            buffer.erase(buffer.begin(), buffer.begin() + long(end));
+            if (batch.numPoints > 0) {
+                score(batch);
+            }
+            formatReplies(batch, errors, reply);
+            if (!writeAll(output, reply, isSocket)) {
+                return;
+            }
+        }
+    }
+
+    /**
+     * @brief Parse lines of points into a batch
+     *
+     * @param begin Start of the text
+     * @param end End of the text
+     * @param batch Receives the points
+     * @param errors Receives the error of every non-blank line ("" if the line
+     * is a point)
+     */
+    void parseLines(const char *begin, const char *end, Batch &batch,
+                    std::vector<std::string> &errors) {
+        uint64_t numDims = model.numDims;
+        batch.numPoints = 0;
+        errors.clear();
+        for (const char *line = begin; line < end;) {
+            const char *lineEnd =
+                static_cast<const char *>(std::memchr(line, '\n', uint64_t(end - line)));
+            if (lineEnd == nullptr) {
+                lineEnd = end;
+            }
+            uint64_t numValues = TextDatasetParser::countValues(line, lineEnd);
+            if (numValues > 0) {
+                if (numValues != numDims) {
+                    errors.push_back("expected " + std::to_string(numDims) +
+                                     " coordinates");
+                } else {
+                    batch.points.resize((batch.numPoints + 1) * numDims);
+                    try {
+                        TextDatasetParser::parseValues(
+                            line, lineEnd,
+                            batch.points.data() + batch.numPoints * numDims,
+                            numDims);
+                        errors.emplace_back();
+                        batch.numPoints++;
+                    } catch (const std::exception &e) {
+                        errors.push_back(e.what());
+                    }
+                }
+            }
+            line = lineEnd + 1;
+        }
+        batch.labels.resize(batch.numPoints);
+        batch.distances.resize(batch.numPoints);
+    }
+
+    /**
+     * @brief Format the replies of the lines of a batch
+     *
+     * @param batch The assigned batch
+     * @param errors The error of every line ("" if the line is a point)
+     * @param reply Receives the replies
+     */
+    void formatReplies(const Batch &batch,
+                       const std::vector<std::string> &errors,
+                       std::string &reply) const {
+        reply.clear();
+        char number[32];
+        uint64_t point = 0;
+        for (const std::string &error : errors) {
+            if (!error.empty()) {
+                reply += "error " + error + '\n';
+                continue;
+            }
+            char *end = std::to_chars(number, number + sizeof(number),
+                                      batch.labels[point])
+                            .ptr;
+            reply.append(number, end);
+            if (withDistances) {
+                end = std::to_chars(number, number + sizeof(number),
+                                    batch.distances[point])
+                          .ptr;
+                reply += ' ';
+                reply.append(number, end);
+            }
+            reply += '\n';
+            point++;
+        }
+    }
+
+    /**
+     * @brief Write a whole string to a file descriptor
+     *
+     * @return Whether everything was written (false once the reader is gone)
+     */
+    static bool writeAll(int fd, const std::string &data, bool isSocket) {
+        uint64_t written = 0;
+        while (written < data.size()) {
+            ssize_t count =
+                isSocket ? send(fd, data.data() + written,
+                                data.size() - written, MSG_NOSIGNAL)
+                         : write(fd, data.data() + written,
+                                 data.size() - written);
+            if (count < 0 && errno == EINTR) {
+                continue;
+            }
+            if (count <= 0) {
+                return false;
+            }
+            written += uint64_t(count);
+        }
+        return true;
+    }
+};
@@ -0,0 +1,191 @@
+/**
+ * @file stream.hpp
+ * @author Reza Namazi (namazir@mcmaster.ca)
+ * @brief A header file for reading a dataset file in chunks of points
+ * @version 1.0
+ * @date 2026-10-16
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <fstream>
+#include <future>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "dataset.hpp"
+#include "text_dataset.hpp"
+
+/**
+ * @brief A class to read a dataset file (same format as readDataset) a fixed
+ * number of points at a time, so that files larger than the memory can be
+ * processed. The file is read in large blocks and the values are parsed with
+ * std::from_chars, like TextDatasetParser does.
+ */
+class ChunkReader {
+   public:
+    static constexpr uint64_t readBytes = 1 << 20;  // bytes read at a time
+
+    uint64_t numPoints;  // number of points in the file
+    uint64_t numDims;    // number of dimensions
+    uint64_t chunkSize;  // maximum number of points in a chunk
+
+    /**
+     * @brief Open a dataset file and read its header
+     *
+     * @param filename Name of the file containing the dataset
+     * @param pointsPerChunk Maximum number of points in a chunk
+     */
+    ChunkReader(std::string filename, uint64_t pointsPerChunk) {
+        if (pointsPerChunk == 0) {
+            throw std::runtime_error("The chunk size should be greater than 0");
+        }
+        this->chunkSize = pointsPerChunk;
+        file.open(filename);
+        if (!file.is_open()) {
+            throw std::runtime_error("Could not open the file");
+        }
+        if (!(file >> numPoints)) {
+            throw std::runtime_error("Could not read the number of points");
+        }
+        if (!(file >> numDims)) {
+            throw std::runtime_error("Could not read the number of dimensions");
+        }
+        dataStart = file.tellg();
+    }
+
+    /**
+     * @brief Go back to the first point of the file
+     *
+     */
+    void rewind() {
+        file.clear();
+        file.seekg(dataStart);
+        pointsRead = 0;
+        buffer.clear();
+        position = 0;
+        atEnd = false;
+    }
+
+    /**
+     * @brief Allocate a buffer that can hold one chunk
+     *
+     * @return The buffer
+     */
+    template <typename Scalar = double>
+    BasicDataset<Scalar> makeChunk() const {
+        BasicDataset<Scalar> chunk(chunkSize, numDims);
+        chunk.labels.reserve(chunkSize);
+        return chunk;
+    }
+
+    /**
+     * @brief Read the next chunk of points. The buffer keeps its memory; its
+     * numPoints is set to the number of points read (0 at the end of the file)
+     *
+     * @param chunk A buffer from makeChunk
+     */
+    template <typename Scalar>
+    void read(BasicDataset<Scalar> &chunk) {
+        uint64_t count = std::min(chunkSize, numPoints - pointsRead);
+        for (uint64_t i = 0; i < count * numDims; i++) {
+            readValue(chunk.coordinates[i]);
+        }
+        chunk.numPoints = count;
+        chunk.labels.resize(count);
+        pointsRead += count;
+    }
+
+   private:
+    std::ifstream file;            // the dataset file
+    std::streampos dataStart;      // position of the first coordinate
+    uint64_t pointsRead = 0;       // points read since the last rewind
+    std::vector<char> buffer;      // bytes read from the file
+    uint64_t position = 0;         // first byte of the buffer not parsed
+    bool atEnd = false;            // whether the file is read to its end
+
+    /**
+     * @brief Parse the next value, reading more of the file when the buffer
+     * ends before the value does
+     *
+     * @param value Receives the value
+     */
+    template <typename Scalar>
+    void readValue(Scalar &value) {
+        while (true) {
+            const char *end = buffer.data() + buffer.size();
+            const char *c = buffer.data() + position;
+            while (c < end && TextDatasetParser::isSpace(*c)) {
+                c++;
+            }
+            const char *valueEnd = c;
+            while (valueEnd < end && !TextDatasetParser::isSpace(*valueEnd)) {
+                valueEnd++;
+            }
+            if (valueEnd == end && !atEnd) {
+                // The value may go on in the next block
+                position = uint64_t(c - buffer.data());
+                refill();
+                continue;
+            }
+            if (c == valueEnd) {
+                throw std::runtime_error("Could not read the coordinates");
+            }
+            TextDatasetParser::parseValues(c, valueEnd, &value, 1);
+            position = uint64_t(valueEnd - buffer.data());
+            return;
+        }
+    }
+
+    /**
+     * @brief Drop the parsed bytes from the buffer and read the next block
+     *
+     */
+    void refill() {
+        buffer.erase(buffer.begin(), buffer.begin() + long(position));
+        position = 0;
+        uint64_t size = buffer.size();
+        buffer.resize(size + readBytes);
+        file.read(buffer.data() + size, std::streamsize(readBytes));
+        buffer.resize(size + uint64_t(file.gcount()));
+        atEnd = uint64_t(file.gcount()) < readBytes;
+    }
+};
+
+/**
+ * @brief Run a function on every chunk of a file, in order. The next chunk is
+ * read on another thread while the function processes the current one, so at
+ * most two chunks are in memory at a time.
+ *
+ * @param reader The reader of the file
+ * @param process The function, called with the chunk (a BasicDataset<Scalar>)
+ * and the index of its first point in the file
+ */
+template <typename Scalar = double, typename Function>
+void forEachChunk(ChunkReader &reader, Function process) {
+    reader.rewind();
+    BasicDataset<Scalar> current = reader.makeChunk<Scalar>();
+    BasicDataset<Scalar> next = reader.makeChunk<Scalar>();
+    reader.read(current);
+    uint64_t offset = 0;
+    while (current.numPoints > 0) {
+        std::future<void> pending =
+            std::async(std::launch::async, [&] { reader.read(next); });
+        try {
+            process(current, offset);
+        } catch (...) {
+            pending.wait();
+            throw;
+        }
+        pending.get();
+        offset += current.numPoints;
+        std::swap(current, next);
+    }
+}
@@ -0,0 +1,175 @@
+/**
+ * @file telemetry.hpp
+ * @author Reza Namazi (namazir@mcmaster.ca)
+ * @brief A header file for the per-iteration telemetry of training
+ * @version 1.0
+ * @date 2026-10-16
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+
+#pragma once
+
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <functional>
+#include <limits>
+#include <memory>
+#include <ostream>
+#include <string>
+
+// Compile with -DKMEANS_TELEMETRY=0 to remove the telemetry from the training
+// loops: the callbacks are then never called and no clock is read
+#ifndef KMEANS_TELEMETRY
+#define KMEANS_TELEMETRY 1
+#endif
+
+/**
+ * @brief Whether the telemetry is compiled in
+ */
+inline constexpr bool telemetryEnabled = KMEANS_TELEMETRY != 0;
+
+/**
+ * @brief Reasons why training stops
+ */
+enum class StopReason {
+    Threshold,      // the centroids moved less than the threshold
+    MaxIterations,   // the maximum number of iterations (or steps) ran
+    NoProgress,      // mini-batch: the inertia stopped improving
+    InertiaPlateau,  // the inertia improved by less than inertiaTolerance
+    FewReassigned    // fewer points than reassignedTolerance changed cluster
+};
+
+/**
+ * @brief Name of a stop reason, as written in the JSON lines
+ *
+ * @param reason The stop reason
+ * @return "threshold", "max_iterations", "no_progress", "inertia" or
+ * "reassigned"
+ */
+inline std::string stopReasonName(StopReason reason) {
+    if (reason == StopReason::Threshold) {
+        return "threshold";
+    }
+    if (reason == StopReason::InertiaPlateau) {
+        return "inertia";
+    }
+    if (reason == StopReason::FewReassigned) {
+        return "reassigned";
+    }
+    return reason == StopReason::MaxIterations ? "max_iterations"
+                                               : "no_progress";
+}
+
+/**
+ * @brief Metrics of one iteration of fit
+ */
+struct IterationStats {
+    uint64_t iteration = 0;  // number of the iteration, starting from 1
+    double inertia = 0;  // sum of squared distances of the points to the
+                         // centroids they were assigned to
+    uint64_t reassigned = 0;  // points whose cluster changed (every point on
+                              // the first iteration)
+    double maxSquaredShift = 0;  // largest squared distance moved by a
+                                 // centroid, compared with the threshold
+    uint64_t distanceComputations = 0;  // distances computed by the assignment
+    uint64_t reseeded = 0;  // empty clusters given a point by the update
+    double assignSeconds = 0;  // time spent assigning the points
+    double updateSeconds = 0;  // time spent moving the centroids
+};
+
+/**
+ * @brief Summary of a whole training run
+ */
+struct FitStats {
+    uint64_t iterations = 0;  // iterations (mini-batch: steps) that ran
+    StopReason stopReason = StopReason::MaxIterations;  // why training stopped
+    double seconds = 0;  // time spent in the iterations
+};
+
+/**
+ * @brief Callbacks called by training. Either can be left empty; when both
+ * are, training does not collect the metrics at all.
+ */
+struct Telemetry {
+    std::function<void(const IterationStats &)> onIteration;
+    std::function<void(const FitStats &)> onFit;
+
+    /**
+     * @brief Whether the metrics have to be collected
+     *
+     */
+    bool active() const {
+        return telemetryEnabled && (onIteration || onFit);
+    }
+};
+
+/**
+ * @brief A stopwatch for the phases of an iteration. Constructing it does not
+ * read the clock: the first lap starts it.
+ */
+class PhaseTimer {
+   public:
+    /**
+     * @brief Restart the timer and get the seconds since it was last started
+     *
+     * @return The elapsed time in seconds
+     */
+    double lap() {
+        auto now = std::chrono::steady_clock::now();
+        std::chrono::duration<double> elapsed = now - start;
+        start = now;
+        return elapsed.count();
+    }
+
+   private:
+    std::chrono::steady_clock::time_point start;
+};
+
+/**
+ * @brief Write a number as a JSON value (null if it is not finite, which JSON
+ * cannot represent)
+ *
+ * @param out The stream
+ * @param value The number
+ */
+inline void writeJsonNumber(std::ostream &out, double value) {
+    if (std::isfinite(value)) {
+        out << value;
+    } else {
+        out << "null";
+    }
+}
+
+/**
+ * @brief Telemetry that writes one JSON object per line to a stream: an
+ * "iteration" event per iteration and a "fit" event at the end of training
+ *
+ * @param out The stream, shared by the callbacks
+ * @return The telemetry
+ */
+inline Telemetry jsonLinesTelemetry(std::shared_ptr<std::ostream> out) {
+    out->precision(std::numeric_limits<double>::max_digits10);
+    Telemetry telemetry;
+    telemetry.onIteration = [out](const IterationStats &stats) {
+        *out << "{\"event\":\"iteration\",\"iteration\":" << stats.iteration
+             << ",\"inertia\":";
+        writeJsonNumber(*out, stats.inertia);
+        *out << ",\"reassigned\":" << stats.reassigned
+             << ",\"max_squared_shift\":";
+        writeJsonNumber(*out, stats.maxSquaredShift);
+        *out << ",\"distance_computations\":" << stats.distanceComputations
+             << ",\"reseeded\":" << stats.reseeded
+             << ",\"assign_seconds\":" << stats.assignSeconds
+             << ",\"update_seconds\":" << stats.updateSeconds << "}\n";
+    };
+    telemetry.onFit = [out](const FitStats &stats) {
+        *out << "{\"event\":\"fit\",\"iterations\":" << stats.iterations
+             << ",\"stop_reason\":\"" << stopReasonName(stats.stopReason)
+             << "\",\"seconds\":" << stats.seconds << "}\n";
+        out->flush();
+    };
+    return telemetry;
+}
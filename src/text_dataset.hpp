@@ -0,0 +1,223 @@
+/**
+ * @file text_dataset.hpp
+ * @author Reza Namazi (namazir@mcmaster.ca)
+ * @brief A header file for the parallel parser of text datasets
+ * @version 1.0
+ * @date 2026-10-16
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <charconv>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+#include <string>
+#include <system_error>
+#include <vector>
+
+#include "dataset.hpp"
+#include "thread_pool.hpp"
+
+/**
+ * @brief A parser of the text dataset format (number of points, number of
+ * dimensions, then the coordinates separated by whitespace). The file is read
+ * in large blocks; every block is split on line boundaries into segments that
+ * are parsed in parallel with std::from_chars.
+ *
+ * Each block is processed in two passes: the first counts the values in every
+ * segment, so that the second knows where in the dataset each segment starts
+ * and can write its values in place.
+ */
+class TextDatasetParser {
+   public:
+    static constexpr uint64_t blockBytes = 1 << 26;       // bytes read at a time
+    static constexpr uint64_t minSegmentBytes = 1 << 16;  // smallest segment
+    static constexpr uint64_t segmentsPerThread = 4;      // for load balance
+
+    /**
+     * @brief Construct a new parser
+     *
+     * @param threads Threads used to parse the blocks
+     */
+    TextDatasetParser(ThreadPool &threads) : pool(threads) {}
+
+    /**
+     * @brief Parse a text dataset. The errors are the same as the ones of
+     * readDataset: a missing file, a missing or malformed header, and missing
+     * or malformed coordinates are all reported with a std::runtime_error.
+     * Anything after the last coordinate is ignored.
+     *
+     * @param filename Name of the file containing the dataset
+     * @return The dataset, with coordinates of type Scalar
+     */
+    template <typename Scalar = double>
+    BasicDataset<Scalar> parse(const std::string &filename) {
+        std::ifstream file(filename, std::ios::binary);
+        if (!file.is_open()) {
+            throw std::runtime_error("Could not open the file");
+        }
+
+        // The header is two numbers; read it the same way as readDataset
+        uint64_t numPoints, numDims;
+        if (!(file >> numPoints)) {
+            throw std::runtime_error("Could not read the number of points");
+        }
+        if (!(file >> numDims)) {
+            throw std::runtime_error("Could not read the number of dimensions");
+        }
+        BasicDataset<Scalar> points(numPoints, numDims);
+
+        uint64_t total = numPoints * numDims;
+        uint64_t parsed = 0;
+        uint64_t carried = 0;  // bytes of a value cut by the previous block
+        std::vector<char> buffer;
+        while (parsed < total) {
+            buffer.resize(carried + blockBytes);
+            file.read(buffer.data() + carried, std::streamsize(blockBytes));
+            uint64_t size = carried + uint64_t(file.gcount());
+            bool atEnd = uint64_t(file.gcount()) < blockBytes;
+
+            // Keep a value cut at the end of the block for the next block
+            uint64_t end = size;
+            if (!atEnd) {
+                while (end > 0 && !isSpace(buffer[end - 1])) {
+                    end--;
+                }
+                if (end == 0) {
+                    carried = size;
+                    continue;
+                }
+            }
+
+            parsed += parseBlock(buffer.data(), end, points.coordinates + parsed,
+                                 total - parsed);
+            std::memmove(buffer.data(), buffer.data() + end, size - end);
+            carried = size - end;
+            if (atEnd) {
+                break;
+            }
+        }
+        if (parsed < total) {
+            throw std::runtime_error("Could not read the coordinates");
+        }
+        return points;
+    }
+
+    /**
+     * @brief Whether a character separates values (same set as std::isspace
+     * in the C locale)
+     *
+     */
+    static bool isSpace(char c) {
+        return c == ' ' || c == '\n' || c == '\t' || c == '\r' || c == '\v' ||
+               c == '\f';
+    }
+
+    /**
+     * @brief Count the values in a piece of text
+     *
+     */
+    static uint64_t countValues(const char *begin, const char *end) {
+        uint64_t count = 0;
+        bool inValue = false;
+        for (const char *c = begin; c < end; c++) {
+            bool space = isSpace(*c);
+            count += !space && !inValue;
+            inValue = !space;
+        }
+        return count;
+    }
+
+    /**
+     * @brief Parse the values in a piece of text
+     *
+     * @param begin Start of the text
+     * @param end End of the text
+     * @param values Where to store the values
+     * @param maxValues Number of values to parse; the rest are ignored
+     * @return The end of the last value parsed
+     */
+    template <typename Scalar>
+    static const char *parseValues(const char *begin, const char *end,
+                                   Scalar *values, uint64_t maxValues) {
+        const char *c = begin;
+        for (uint64_t i = 0; i < maxValues; i++) {
+            while (c < end && isSpace(*c)) {
+                c++;
+            }
+            const char *valueEnd = c;
+            while (valueEnd < end && !isSpace(*valueEnd)) {
+                valueEnd++;
+            }
+            // std::from_chars does not accept the leading '+' that >> does
+            if (c < valueEnd && *c == '+' && valueEnd - c > 1 && c[1] != '-') {
+                c++;
+            }
+            std::from_chars_result result = std::from_chars(c, valueEnd, values[i]);
+            if (result.ec != std::errc() || result.ptr != valueEnd) {
+                throw std::runtime_error("Could not read the coordinates");
+            }
+            c = valueEnd;
+        }
+        return c;
+    }
+
+   private:
+    ThreadPool &pool;  // threads used to parse the blocks
+
+    /**
+     * @brief Parse a block of text that ends on a value boundary
+     *
+     * @param text Start of the block
+     * @param length Number of bytes in the block
+     * @param values Where to store the values
+     * @param maxValues Maximum number of values to store
+     * @return Number of values stored
+     */
+    template <typename Scalar>
+    uint64_t parseBlock(const char *text, uint64_t length, Scalar *values,
+                        uint64_t maxValues) {
+        // Split the block into segments that end at a newline (or at the end
+        // of the block)
+        uint64_t numSegments = std::max<uint64_t>(
+            1, std::min(pool.size() * segmentsPerThread,
+                        length / minSegmentBytes));
+        std::vector<uint64_t> bounds(numSegments + 1, length);
+        bounds[0] = 0;
+        for (uint64_t s = 1; s < numSegments; s++) {
+            uint64_t cut = std::max(length * s / numSegments, bounds[s - 1]);
+            const void *newline =
+                std::memchr(text + cut, '\n', length - cut);
+            bounds[s] = newline == nullptr
+                            ? length
+                            : uint64_t(static_cast<const char *>(newline) -
+                                       text) + 1;
+        }
+
+        // First pass: count the values of every segment
+        std::vector<uint64_t> offsets(numSegments + 1, 0);
+        pool.parallelFor(numSegments, [&](uint64_t s) {
+            offsets[s + 1] = countValues(text + bounds[s], text + bounds[s + 1]);
+        });
+        for (uint64_t s = 0; s < numSegments; s++) {
+            offsets[s + 1] += offsets[s];
+        }
+
+        // Second pass: parse every segment into its place
+        pool.parallelFor(numSegments, [&](uint64_t s) {
+            if (offsets[s] >= maxValues) {
+                return;
+            }
+            uint64_t count = std::min(offsets[s + 1], maxValues) - offsets[s];
+            parseValues(text + bounds[s], text + bounds[s + 1],
+                        values + offsets[s], count);
+        });
+        return std::min(offsets[numSegments], maxValues);
+    }
+};
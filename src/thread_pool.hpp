@@ -0,0 +1,168 @@
+/**
+ * @file thread_pool.hpp
+ * @author Reza Namazi (namazir@mcmaster.ca)
+ * @brief A header file for a fixed-size pool of worker threads
+ * @version 1.0
+ * @date 2026-10-16
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/**
+ * @brief A pool of threads that runs parallel loops. The thread calling
+ * parallelFor takes part in the loop, so a pool of size n starts n - 1 worker
+ * threads and a pool of size 1 runs everything on the calling thread.
+ */
+class ThreadPool {
+   public:
+    /**
+     * @brief Construct a new ThreadPool object
+     *
+     * @param n The number of threads that run a loop (including the caller)
+     */
+    ThreadPool(uint64_t n) {
+        this->numThreads = n < 1 ? 1 : n;
+        for (uint64_t i = 1; i < numThreads; i++) {
+            workers.emplace_back([this] { workerLoop(); });
+        }
+    }
+
+    ThreadPool(const ThreadPool &) = delete;
+    ThreadPool &operator=(const ThreadPool &) = delete;
+
+    /**
+     * @brief Stop and join the worker threads
+     *
+     */
+    ~ThreadPool() {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stopping = true;
+        }
+        wakeUp.notify_all();
+        for (std::thread &worker : workers) {
+            worker.join();
+        }
+    }
+
+    /**
+     * @brief Number of threads that run a loop
+     *
+     */
+    uint64_t size() const { return numThreads; }
+
+    /**
+     * @brief Run task(i) for every i in [0, numTasks) and wait for all of them
+     * to finish. Tasks are handed out dynamically, so which thread runs a task
+     * is not deterministic; tasks must only write to state owned by their
+     * index. The first exception thrown by a task is rethrown here.
+     *
+     * @param numTasks The number of tasks
+     * @param task The function to run for each task index
+     */
+    template <typename Task>
+    void parallelFor(uint64_t numTasks, const Task &task) {
+        if (numThreads == 1 || numTasks <= 1) {
+            for (uint64_t i = 0; i < numTasks; i++) {
+                task(i);
+            }
+            return;
+        }
+
+        // A std::function holding a reference never allocates, however much
+        // the task captures, so a loop does no heap allocation
+        std::function<void(uint64_t)> function = std::cref(task);
+        std::unique_lock<std::mutex> lock(mutex);
+        this->currentTask = &function;
+        this->totalTasks = numTasks;
+        this->nextTask = 0;
+        this->activeWorkers = workers.size();
+        this->error = nullptr;
+        generation++;
+        lock.unlock();
+        wakeUp.notify_all();
+
+        runTasks();
+
+        lock.lock();
+        done.wait(lock, [this] { return activeWorkers == 0; });
+        this->currentTask = nullptr;
+        if (error) {
+            std::rethrow_exception(error);
+        }
+    }
+
+   private:
+    uint64_t numThreads;                // number of threads including caller
+    std::vector<std::thread> workers;   // worker threads
+    std::mutex mutex;                   // protects the state below
+    std::condition_variable wakeUp;     // signals a new loop or stopping
+    std::condition_variable done;       // signals that a worker finished
+    const std::function<void(uint64_t)> *currentTask = nullptr;
+    uint64_t totalTasks = 0;            // number of tasks in current loop
+    std::atomic<uint64_t> nextTask{0};  // next task index to hand out
+    uint64_t activeWorkers = 0;         // workers still in the current loop
+    uint64_t generation = 0;            // incremented for every loop
+    bool stopping = false;              // set when the pool is destroyed
+    std::exception_ptr error;           // first exception thrown by a task
+
+    /**
+     * @brief Run tasks of the current loop until none are left
+     *
+     */
+    void runTasks() {
+        while (true) {
+            uint64_t i = nextTask.fetch_add(1);
+            if (i >= totalTasks) {
+                return;
+            }
+            try {
+                (*currentTask)(i);
+            } catch (...) {
+                std::lock_guard<std::mutex> lock(mutex);
+                if (!error) {
+                    error = std::current_exception();
+                }
+            }
+        }
+    }
+
+    /**
+     * @brief Main loop of a worker thread
+     *
+     */
+    void workerLoop() {
+        uint64_t seen = 0;
+        while (true) {
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                wakeUp.wait(lock,
+                            [&] { return stopping || generation != seen; });
+                if (stopping) {
+                    return;
+                }
+                seen = generation;
+            }
+
+            runTasks();
+
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                activeWorkers--;
+            }
+            done.notify_one();
+        }
+    }
+};
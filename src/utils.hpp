@@ -12,90 +12,106 @@
 
 #pragma once
 
+#include <algorithm>
 #include <cmath>
 #include <fstream>
 #include <iostream>
+#include <memory>
 #include <stdexcept>
 #include <vector>
 
+#include "binary_dataset.hpp"
 #include "kmeans.hpp"
+#include "text_dataset.hpp"
 
 /**
- * @brief Read the dataset from a file and stores it in a vector of points
+ * @brief Read the dataset from a file and stores it in a contiguous dataset.
+ * Binary datasets (see binary_dataset.hpp) are detected and memory-mapped
+ * instead of parsed; text datasets are parsed in parallel (see
+ * text_dataset.hpp).
  *
- * @param points An empty vector of points to store the dataset
+ * @param points An empty dataset to store the points in, in its own precision
  * @param filename Name of the file containing the dataset
  * @param numPoints Number of points in the dataset
  * @param numDimensions Number of dimensions (coordinates) that each point has
+ * @param numThreads Number of threads used to parse a text dataset
  */
-void readDataset(std::vector<Point> &points, char *filename,
-                 uint64_t &numPoints, uint64_t &numDimensions) {
-    // Open the file
-    std::ifstream file(filename);
-    if (!file.is_open()) {
-        throw std::runtime_error("Could not open the file");
+template <typename Scalar>
+void readDataset(BasicDataset<Scalar> &points, char *filename,
+                 uint64_t &numPoints, uint64_t &numDimensions,
+                 uint64_t numThreads = 1) {
+    if (isBinaryDataset(filename)) {
+        points = loadBinaryDataset<Scalar>(filename);
+        numPoints = points.numPoints;
+        numDimensions = points.numDims;
+        return;
     }
 
-    // Check if the file follows the correct format:
-    // First line contains the number of points in the dataset
-    // Second line contains the number of dimensions
-    // From the third line, each line contains the coordinates of a point
-
-    // Read the number of points in the dataset
-    if (!(file >> numPoints)) {
-        throw std::runtime_error("Could not read the number of points");
-    }
-    points.resize(numPoints);
-
-    // Read the number of dimensions
-    if (!(file >> numDimensions)) {
-        throw std::runtime_error("Could not read the number of dimensions");
-    }
-
-    // Read the points
-    for (uint64_t i = 0; i < numPoints; i++) {
-        points[i] = Point(numDimensions);
-        for (uint64_t j = 0; j < numDimensions; j++) {
-            if (!(file >> points[i].coordinates[j])) {
-                throw std::runtime_error("Could not read the coordinates");
-            }
-        }
-    }
-
-    // Close the file
-    file.close();
+    ThreadPool pool(numThreads);
+    points = TextDatasetParser(pool).parse<Scalar>(filename);
+    numPoints = points.numPoints;
+    numDimensions = points.numDims;
 }
 
 /**
  * @brief Print the dataset
  *
- * @param points A vector of points containing the dataset
+ * @param points The dataset
  * @param numPoints Number of points in the dataset
  * @param numDimensions Number of dimensions (coordinates) that each point has
  */
-void printDataset(std::vector<Point> &points, uint64_t numPoints,
+template <typename Scalar>
+void printDataset(BasicDataset<Scalar> &points, uint64_t numPoints,
                   uint64_t numDimensions) {
     for (uint64_t i = 0; i < numPoints; i++) {
+        const Scalar *point = points.row(i);
         for (uint64_t j = 0; j < numDimensions; j++) {
-            std::cout << points[i].coordinates[j] << " ";
+            std::cout << point[j] << " ";
         }
         std::cout << std::endl;
     }
 }
 
+// A value of k is flat when it lowers the inertia by less than this fraction
+// of the inertia of the smallest k
+constexpr double elbowFlatTolerance = 0.01;
+
 /**
  * @brief Find the optimal value of k using the elbow method
  *
+ * The models of the values of k are trained either concurrently from scratch
+ * (each with its share of the threads, over the one shared dataset), or one
+ * after the other with each k warm-started from the k - 1 model by splitting
+ * its cluster of largest inertia (see KMeans::initializeBySplitting), which
+ * usually converges in a few iterations. With a patience, the sweep stops
+ * once that many values of k in a row were flat; the values trained past
+ * that point are not used, so the result does not depend on the number of
+ * threads.
+ *
  * @param numPoints Number of points in the dataset
  * @param numDimensions Number of dimensions (coordinates) that each point has
- * @param points A vector of points containing the dataset
+ * @param points The dataset
  * @param minK Minimum value of k (clusters) to try
  * @param maxK Maximum value of k (clusters) to try
+ * @param numThreads Number of threads shared by the models
+ * @param algorithm Assignment algorithm used to train each model
+ * @param initMethod Initialization used to train each model (the first one
+ * only when warm-starting)
+ * @param seed Seed of the random number generator of each model
+ * @param warmStart Whether to warm-start each k from the k - 1 model
+ * @param patience Number of flat values of k in a row after which the sweep
+ * stops (0: try every value of k)
  * @return Optimal value of the number of clusters (k) found using the elbow
  * method
  */
+template <typename Scalar>
 uint64_t elbowMethod(uint64_t numPoints, uint64_t numDimensions,
-                     std::vector<Point> points, uint64_t minK, uint64_t maxK) {
+                     const BasicDataset<Scalar> &points, uint64_t minK,
+                     uint64_t maxK, uint64_t numThreads = 1,
+                     Algorithm algorithm = Algorithm::Lloyd,
+                     InitMethod initMethod = InitMethod::Random,
+                     uint64_t seed = 0, bool warmStart = false,
+                     uint64_t patience = 0) {
     // Check if minK is less than 1
     if (minK < 1) {
         throw std::runtime_error("Minimum value of k should be greater than 0");
@@ -108,13 +124,73 @@ uint64_t elbowMethod(uint64_t numPoints, uint64_t numDimensions,
     }
 
     // Store all inertia values
-    std::vector<double_t> inertia;
-
-    // Run k-means for all values of k
-    for (uint64_t k = minK; k <= maxK; k++) {
-        KMeans kmeans(k, numDimensions, numPoints, points);
-        kmeans.fit(100, 1e-6);
-        inertia.push_back(kmeans.inertia());
+    uint64_t numK = maxK - minK + 1;
+    std::vector<double_t> inertia(numK, 0);
+
+    // Number of values of k kept when the first computed ones end with
+    // patience flat values of k in a row (0 if they do not)
+    auto clearLength = [&](uint64_t computed) -> uint64_t {
+        uint64_t flat = 0;
+        for (uint64_t i = 1; i < computed && patience > 0; i++) {
+            bool isFlat =
+                inertia[i - 1] - inertia[i] < elbowFlatTolerance * inertia[0];
+            flat = isFlat ? flat + 1 : 0;
+            if (flat == patience) {
+                return i + 1;
+            }
+        }
+        return 0;
+    };
+    uint64_t length = 0;
+
+    if (warmStart) {
+        // Train one k at a time with all the threads
+        std::shared_ptr<ThreadPool> pool =
+            std::make_shared<ThreadPool>(numThreads);
+        std::unique_ptr<BasicKMeans<Scalar>> previous;
+        for (uint64_t i = 0; i < numK && length == 0; i++) {
+            auto kmeans = std::make_unique<BasicKMeans<Scalar>>(
+                minK + i, numDimensions, numPoints, points);
+            kmeans->pool = pool;
+            kmeans->algorithm = algorithm;
+            kmeans->initMethod = initMethod;
+            kmeans->setSeed(seed);
+            if (previous) {
+                kmeans->initializeBySplitting(*previous);
+                kmeans->fitFromCentroids(100, 1e-6);
+            } else {
+                kmeans->fit(100, 1e-6);
+            }
+            inertia[i] = kmeans->inertia();
+            previous = std::move(kmeans);
+            length = clearLength(i + 1);
+        }
+    } else {
+        // Train as many values of k at a time as there are threads. A thread
+        // pool runs one loop at a time, so every model gets its own pool.
+        // Without a patience all of them are handed out at once; with one,
+        // they are trained in waves so that the sweep can stop.
+        uint64_t concurrent = std::max<uint64_t>(1, std::min(numThreads, numK));
+        uint64_t threadsPerModel = std::max<uint64_t>(1, numThreads / concurrent);
+        uint64_t wave = patience > 0 ? concurrent : numK;
+        ThreadPool models(concurrent);
+        for (uint64_t first = 0; first < numK && length == 0; first += wave) {
+            uint64_t count = std::min(wave, numK - first);
+            models.parallelFor(count, [&](uint64_t t) {
+                BasicKMeans<Scalar> kmeans(minK + first + t, numDimensions,
+                                           numPoints, points);
+                kmeans.setNumThreads(threadsPerModel);
+                kmeans.algorithm = algorithm;
+                kmeans.initMethod = initMethod;
+                kmeans.setSeed(seed);
+                kmeans.fit(100, 1e-6);
+                inertia[first + t] = kmeans.inertia();
+            });
+            length = clearLength(first + count);
+        }
+    }
+    if (length > 0) {
+        inertia.resize(length);
     }
 
     // Connect a line between the first and last point and find the point
@@ -123,14 +199,15 @@ uint64_t elbowMethod(uint64_t numPoints, uint64_t numDimensions,
     // The equation of the line is y = mx + b
 
     // m = (y2 - y1) / (x2 - x1)
-    double m = (inertia[inertia.size() - 1] - inertia[0]) / double(maxK - minK);
+    double m = (inertia[inertia.size() - 1] - inertia[0]) /
+               double(inertia.size() - 1);
 
     // b = y - mx
     double b = inertia[0] - m * double(minK);
 
     // Find the point which is farthest from the line
     double maxDistance = 0;
-    uint64_t elbowPoint = 0;
+    uint64_t elbowPoint = minK;
     for (uint64_t i = 0; i < uint64_t(inertia.size()); i++) {
         // Distance of a point from a line is given by
         // d = |mx + b - y| / sqrt(m^2 + (-1)^2)